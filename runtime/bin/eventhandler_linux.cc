@@ -16,6 +16,7 @@
 #include "bin/dartutils.h"
 #include "bin/fdutils.h"
 #include "bin/hashmap.h"
+#include "bin/platform.h"
 #include "platform/thread.h"
 #include "platform/utils.h"
 
@@ -95,7 +96,7 @@ static void UpdateEpollInstance(intptr_t epoll_fd_, SocketData* sd) {
 }
 
 
-EventHandlerImplementation::EventHandlerImplementation()
+EventLoop::EventLoop()
     : socket_map_(&HashMap::SamePointerValue, 16) {
   intptr_t result;
   result = TEMP_FAILURE_RETRY(pipe(interrupt_fds_));
@@ -126,13 +127,13 @@ EventHandlerImplementation::EventHandlerImplementation()
 }
 
 
-EventHandlerImplementation::~EventHandlerImplementation() {
+EventLoop::~EventLoop() {
   TEMP_FAILURE_RETRY(close(interrupt_fds_[0]));
   TEMP_FAILURE_RETRY(close(interrupt_fds_[1]));
 }
 
 
-SocketData* EventHandlerImplementation::GetSocketData(intptr_t fd) {
+SocketData* EventLoop::GetSocketData(intptr_t fd) {
   ASSERT(fd >= 0);
   HashMap::Entry* entry = socket_map_.Lookup(
       GetHashmapKeyFromFd(fd), GetHashmapHashFromFd(fd), true);
@@ -149,9 +150,9 @@ SocketData* EventHandlerImplementation::GetSocketData(intptr_t fd) {
 }
 
 
-void EventHandlerImplementation::WakeupHandler(intptr_t id,
-                                               Dart_Port dart_port,
-                                               int64_t data) {
+void EventLoop::WakeupHandler(intptr_t id,
+                              Dart_Port dart_port,
+                              int64_t data) {
   InterruptMessage msg;
   msg.id = id;
   msg.dart_port = dart_port;
@@ -167,7 +168,7 @@ void EventHandlerImplementation::WakeupHandler(intptr_t id,
 }
 
 
-bool EventHandlerImplementation::GetInterruptMessage(InterruptMessage* msg) {
+bool EventLoop::GetInterruptMessage(InterruptMessage* msg) {
   char* dst = reinterpret_cast<char*>(msg);
   int total_read = 0;
   int bytes_read =
@@ -187,7 +188,7 @@ bool EventHandlerImplementation::GetInterruptMessage(InterruptMessage* msg) {
   return (total_read == kInterruptMessageSize) ? true : false;
 }
 
-void EventHandlerImplementation::HandleInterruptFd() {
+void EventLoop::HandleInterruptFd() {
   InterruptMessage msg;
   while (GetInterruptMessage(&msg)) {
     if (msg.id == kTimerId) {
@@ -243,8 +244,8 @@ static void PrintEventMask(intptr_t fd, intptr_t events) {
 }
 #endif
 
-intptr_t EventHandlerImplementation::GetPollEvents(intptr_t events,
-                                                   SocketData* sd) {
+intptr_t EventLoop::GetPollEvents(intptr_t events,
+                                  SocketData* sd) {
 #ifdef DEBUG_POLL
   PrintEventMask(sd->fd(), events);
 #endif
@@ -325,8 +326,8 @@ intptr_t EventHandlerImplementation::GetPollEvents(intptr_t events,
 }
 
 
-void EventHandlerImplementation::HandleEvents(struct epoll_event* events,
-                                              int size) {
+void EventLoop::HandleEvents(struct epoll_event* events,
+                             int size) {
   for (int i = 0; i < size; i++) {
     if (events[i].data.ptr != NULL) {
       SocketData* sd = reinterpret_cast<SocketData*>(events[i].data.ptr);
@@ -346,7 +347,7 @@ void EventHandlerImplementation::HandleEvents(struct epoll_event* events,
 }
 
 
-intptr_t EventHandlerImplementation::GetTimeout() {
+intptr_t EventLoop::GetTimeout() {
   if (timeout_ == kInfinityTimeout) {
     return kInfinityTimeout;
   }
@@ -355,7 +356,7 @@ intptr_t EventHandlerImplementation::GetTimeout() {
 }
 
 
-void EventHandlerImplementation::HandleTimeout() {
+void EventLoop::HandleTimeout() {
   if (timeout_ != kInfinityTimeout) {
     intptr_t millis = timeout_ - GetCurrentTimeMilliseconds();
     if (millis <= 0) {
@@ -367,11 +368,10 @@ void EventHandlerImplementation::HandleTimeout() {
 }
 
 
-void EventHandlerImplementation::Poll(uword args) {
-  static const intptr_t kMaxEvents = 16;
+void EventLoop::Poll(uword args) {
+  static const intptr_t kMaxEvents = 64;
   struct epoll_event events[kMaxEvents];
-  EventHandlerImplementation* handler =
-      reinterpret_cast<EventHandlerImplementation*>(args);
+  EventLoop* handler = reinterpret_cast<EventLoop*>(args);
   ASSERT(handler != NULL);
   while (1) {
     intptr_t millis = handler->GetTimeout();
@@ -392,8 +392,8 @@ void EventHandlerImplementation::Poll(uword args) {
 }
 
 
-void EventHandlerImplementation::StartEventHandler() {
-  int result = dart::Thread::Start(&EventHandlerImplementation::Poll,
+void EventLoop::Start() {
+  int result = dart::Thread::Start(&EventLoop::Poll,
                                    reinterpret_cast<uword>(this));
   if (result != 0) {
     FATAL1("Failed to start event handler thread %d", result);
@@ -401,20 +401,66 @@ void EventHandlerImplementation::StartEventHandler() {
 }
 
 
-void EventHandlerImplementation::SendData(intptr_t id,
-                                          Dart_Port dart_port,
-                                          intptr_t data) {
+void EventLoop::SendData(intptr_t id,
+                         Dart_Port dart_port,
+                         intptr_t data) {
   WakeupHandler(id, dart_port, data);
 }
 
 
-void* EventHandlerImplementation::GetHashmapKeyFromFd(intptr_t fd) {
+void* EventLoop::GetHashmapKeyFromFd(intptr_t fd) {
   // The hashmap does not support keys with value 0.
   return reinterpret_cast<void*>(fd + 1);
 }
 
 
-uint32_t EventHandlerImplementation::GetHashmapHashFromFd(intptr_t fd) {
+uint32_t EventLoop::GetHashmapHashFromFd(intptr_t fd) {
   // The hashmap does not support keys with value 0.
   return dart::Utils::WordHash(fd + 1);
 }
+
+
+EventHandlerImplementation::EventHandlerImplementation() {
+  num_loops_ = Platform::NumberOfProcessors();
+  if (num_loops_ < 1) {
+    num_loops_ = 1;
+  } else if (num_loops_ > kMaxEventLoops) {
+    num_loops_ = kMaxEventLoops;
+  }
+  loops_ = new EventLoop[num_loops_];
+}
+
+
+EventHandlerImplementation::EventHandlerImplementation(intptr_t num_loops)
+    : num_loops_(num_loops) {
+  ASSERT((num_loops_ >= 1) && (num_loops_ <= kMaxEventLoops));
+  loops_ = new EventLoop[num_loops_];
+}
+
+
+EventHandlerImplementation::~EventHandlerImplementation() {
+  delete[] loops_;
+}
+
+
+EventLoop* EventHandlerImplementation::LoopFor(intptr_t id) {
+  if (id == kTimerId) {
+    return &loops_[0];
+  }
+  ASSERT(id >= 0);
+  return &loops_[id % num_loops_];
+}
+
+
+void EventHandlerImplementation::StartEventHandler() {
+  for (intptr_t i = 0; i < num_loops_; i++) {
+    loops_[i].Start();
+  }
+}
+
+
+void EventHandlerImplementation::SendData(intptr_t id,
+                                          Dart_Port dart_port,
+                                          intptr_t data) {
+  LoopFor(id)->SendData(id, dart_port, data);
+}
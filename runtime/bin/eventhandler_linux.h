@@ -84,16 +84,18 @@ class SocketData {
 };
 
 
-class EventHandlerImplementation {
+// An epoll instance with its own thread, interrupt pipe and sockets. The
+// event handler shards the file descriptors over several event loops.
+class EventLoop {
  public:
-  EventHandlerImplementation();
-  ~EventHandlerImplementation();
+  EventLoop();
+  ~EventLoop();
 
   // Gets the socket data structure for a given file
   // descriptor. Creates a new one if one is not found.
   SocketData* GetSocketData(intptr_t fd);
   void SendData(intptr_t id, Dart_Port dart_port, intptr_t data);
-  void StartEventHandler();
+  void Start();
 
  private:
   intptr_t GetTimeout();
@@ -116,4 +118,26 @@ class EventHandlerImplementation {
 };
 
 
+class EventHandlerImplementation {
+ public:
+  EventHandlerImplementation();
+  // Uses the given number of event loops instead of one per processor.
+  explicit EventHandlerImplementation(intptr_t num_loops);
+  ~EventHandlerImplementation();
+
+  void SendData(intptr_t id, Dart_Port dart_port, intptr_t data);
+  void StartEventHandler();
+
+ private:
+  static const intptr_t kMaxEventLoops = 8;
+
+  // Timers are handled by the first event loop, file descriptors by the
+  // loop selected by the descriptor.
+  EventLoop* LoopFor(intptr_t id);
+
+  intptr_t num_loops_;
+  EventLoop* loops_;
+};
+
+
 #endif  // BIN_EVENTHANDLER_LINUX_H_
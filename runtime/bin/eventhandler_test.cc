@@ -0,0 +1,166 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "bin/eventhandler.h"
+#include "bin/socket.h"
+#include "bin/thread.h"
+#include "platform/assert.h"
+#include "platform/globals.h"
+#include "vm/unit_test.h"
+
+// Only the Linux event handler is sharded over several event loops.
+#if defined(TARGET_OS_LINUX)
+
+static const intptr_t kNumEventLoops = 4;
+// The socket ids are consecutive file descriptors, more connections than
+// there are event loops are spread over all of them.
+static const intptr_t kNumConnections = 16;
+
+static dart::Monitor event_monitor;
+static Dart_Port event_ports[kNumConnections];
+static intptr_t event_masks[kNumConnections];
+
+
+// Records the event mask posted by the event handler to one of the ports.
+static void HandleEvent(Dart_Port dest_port_id,
+                        Dart_Port reply_port_id,
+                        Dart_CObject* message) {
+  MonitorLocker ml(&event_monitor);
+  EXPECT_EQ(Dart_CObject::kInt32, message->type);
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    if (event_ports[i] == dest_port_id) {
+      event_masks[i] = message->value.as_int32;
+    }
+  }
+  ml.Notify();
+}
+
+
+// Registers all sockets for the events in mask at the same time and waits
+// until each of them has been notified. The i'th socket is notified on the
+// i'th port.
+static void WaitForEvents(EventHandlerImplementation* event_handler,
+                          intptr_t* sockets,
+                          intptr_t num_sockets,
+                          intptr_t mask,
+                          intptr_t expected_mask) {
+  MonitorLocker ml(&event_monitor);
+  for (intptr_t i = 0; i < num_sockets; i++) {
+    event_masks[i] = 0;
+    event_handler->SendData(sockets[i], event_ports[i], mask);
+  }
+  for (intptr_t i = 0; i < num_sockets; i++) {
+    while (event_masks[i] == 0) {
+      ml.Wait();
+    }
+    EXPECT_EQ(expected_mask, event_masks[i]);
+  }
+}
+
+
+// Writes the index of each socket to it.
+static void WriteBytes(intptr_t* sockets) {
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    uint8_t byte = i;
+    EXPECT_EQ(1, Socket::Write(sockets[i], &byte, 1));
+  }
+}
+
+
+// Reads the single byte available on each socket and checks that it is the
+// index of the socket.
+static void ReadBytes(intptr_t* sockets) {
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    uint8_t byte = kNumConnections;
+    EXPECT_EQ(1, Socket::Read(sockets[i], &byte, 1));
+    EXPECT_EQ(i, byte);
+  }
+}
+
+
+// Writes the single byte available on each socket back to it.
+static void EchoBytes(intptr_t* sockets) {
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    uint8_t byte = 0;
+    EXPECT_EQ(1, Socket::Read(sockets[i], &byte, 1));
+    EXPECT_EQ(1, Socket::Write(sockets[i], &byte, 1));
+  }
+}
+
+
+UNIT_TEST_CASE(EventHandlerSocketRoundTrip) {
+  EventHandlerImplementation* event_handler =
+      new EventHandlerImplementation(kNumEventLoops);
+  event_handler->StartEventHandler();
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    event_ports[i] =
+        Dart_NewNativePort("EventHandlerTest", HandleEvent, false);
+    EXPECT(event_ports[i] != kIllegalPort);
+  }
+  intptr_t server = ServerSocket::CreateBindListen("127.0.0.1", 0, 128);
+  EXPECT(server >= 0);
+  intptr_t port = Socket::GetPort(server);
+
+  intptr_t clients[kNumConnections];
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    clients[i] = Socket::CreateConnect("127.0.0.1", port);
+    EXPECT(clients[i] >= 0);
+  }
+  intptr_t connections[kNumConnections];
+  intptr_t num_accepted = 0;
+  while (num_accepted < kNumConnections) {
+    WaitForEvents(event_handler,
+                  &server,
+                  1,
+                  (1 << kInEvent) | (1 << kListeningSocket),
+                  1 << kInEvent);
+    intptr_t connection = ServerSocket::Accept(server);
+    while ((connection >= 0) && (num_accepted < kNumConnections)) {
+      connections[num_accepted++] = connection;
+      connection = ServerSocket::Accept(server);
+    }
+    EXPECT(connection == ServerSocket::kTemporaryFailure);
+  }
+  WaitForEvents(event_handler,
+                clients,
+                kNumConnections,
+                1 << kOutEvent,
+                1 << kOutEvent);
+
+  // Each client sends a byte which the server side echoes. The reads on all
+  // connections are pending at the same time, on different event loops. The
+  // connections need not have been accepted in the order of the clients.
+  WriteBytes(clients);
+  WaitForEvents(event_handler,
+                connections,
+                kNumConnections,
+                1 << kInEvent,
+                1 << kInEvent);
+  EchoBytes(connections);
+  WaitForEvents(event_handler,
+                clients,
+                kNumConnections,
+                1 << kInEvent,
+                1 << kInEvent);
+  ReadBytes(clients);
+
+  // Closing a client is seen by its connection.
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    event_handler->SendData(clients[i], event_ports[i], 1 << kCloseCommand);
+  }
+  WaitForEvents(event_handler,
+                connections,
+                kNumConnections,
+                1 << kInEvent,
+                1 << kCloseEvent);
+  for (intptr_t i = 0; i < kNumConnections; i++) {
+    event_handler->SendData(connections[i],
+                            event_ports[i],
+                            1 << kCloseCommand);
+    EXPECT(Dart_CloseNativePort(event_ports[i]));
+  }
+  event_handler->SendData(server, event_ports[0], 1 << kCloseCommand);
+}
+
+#endif  // defined(TARGET_OS_LINUX)
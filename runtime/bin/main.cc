@@ -39,6 +39,13 @@ static CommandLineOptions* import_map_options = NULL;
 static const char* generate_pprof_symbols_filename = NULL;
 
 
+// Global state that stores the file name and format of the CPU profile.
+// NULL if the program is not profiled.
+static const char* profile_filename = NULL;
+static Dart_ProfileFormat profile_format = kPprofProfileFormat;
+static const intptr_t kProfilePeriodMicros = 1000;
+
+
 // Global state that stores a file name for flow graph debugging output.
 // NULL if no output is generated.
 static File* flow_graph_file = NULL;
@@ -133,6 +140,20 @@ static void ProcessPprofOption(const char* filename) {
 }
 
 
+static void ProcessPprofProfileOption(const char* filename) {
+  ASSERT(filename != NULL);
+  profile_filename = filename;
+  profile_format = kPprofProfileFormat;
+}
+
+
+static void ProcessFlameGraphOption(const char* filename) {
+  ASSERT(filename != NULL);
+  profile_filename = filename;
+  profile_format = kFlameGraphProfileFormat;
+}
+
+
 static void ProcessFlowGraphOption(const char* flowgraph_option) {
   ASSERT(flowgraph_option != NULL);
   flow_graph_file = File::Open("flowgraph.cfg", File::kWriteTruncate);
@@ -154,6 +175,8 @@ static struct {
   { "--compile_all", ProcessCompileAllOption },
   { "--debug", ProcessDebugOption },
   { "--generate_pprof_symbols=", ProcessPprofOption },
+  { "--generate_pprof_profile=", ProcessPprofProfileOption },
+  { "--generate_flame_graph=", ProcessFlameGraphOption },
   { "--import_map=", ProcessImportMapOption },
   { "--package-root=", ProcessPackageRootOption },
   { "--generate_flow_graph", ProcessFlowGraphOption },
@@ -334,6 +357,31 @@ static void DumpPprofSymbolInfo() {
 
 
 
+static void WriteToProfileFile(const void* data,
+                               intptr_t length,
+                               void* stream) {
+  File* profile_file = reinterpret_cast<File*>(stream);
+  profile_file->WriteFully(data, length);
+}
+
+
+static void DumpProfile() {
+  if (profile_filename != NULL) {
+    Dart_StopProfiling();
+    Dart_EnterScope();
+    File* profile_file = File::Open(profile_filename, File::kWriteTruncate);
+    ASSERT(profile_file != NULL);
+    Dart_Handle result =
+        Dart_WriteProfile(profile_format, WriteToProfileFile, profile_file);
+    if (Dart_IsError(result)) {
+      fprintf(stderr, "%s\n", Dart_GetError(result));
+    }
+    delete profile_file;  // Closes the file.
+    Dart_ExitScope();
+  }
+}
+
+
 static Dart_Handle ResolveScriptUri(Dart_Handle script_uri,
                                     Dart_Handle builtin_lib) {
   const int kNumArgs = 3;
@@ -722,6 +770,12 @@ int main(int argc, char** argv) {
   // Initialize the Dart VM.
   Dart_Initialize(CreateIsolateAndSetup, NULL);
 
+  if ((profile_filename != NULL) &&
+      !Dart_StartProfiling(kProfilePeriodMicros)) {
+    fprintf(stderr, "CPU profiling is not supported on this platform\n");
+    profile_filename = NULL;
+  }
+
   original_working_directory = Directory::Current();
 
   // Call CreateIsolateAndSetup which creates an isolate and loads up
@@ -794,8 +848,9 @@ int main(int argc, char** argv) {
   }
 
   Dart_ExitScope();
-  // Dump symbol information for the profiler.
+  // Dump symbol information and the samples for the profiler.
   DumpPprofSymbolInfo();
+  DumpProfile();
   // Shutdown the isolate.
   Dart_ShutdownIsolate();
   // Terminate process exit-code handler.
@@ -2373,6 +2373,56 @@ DART_EXPORT Dart_Handle Dart_SetNativeResolver(
 DART_EXPORT void Dart_InitPprofSupport();
 DART_EXPORT void Dart_GetPprofSymbolInfo(void** buffer, int* buffer_size);
 
+/**
+ * A callback invoked by the CPU profiler to write a profile.
+ */
+typedef void (*Dart_ProfileWriteCallback)(const void* data,
+                                          intptr_t length,
+                                          void* stream);
+
+typedef enum {
+  // Binary CPU profile in the format of pprof, followed by the memory map
+  // of the process. The symbols of Dart code can be provided to pprof with
+  // Dart_GetPprofSymbolInfo.
+  kPprofProfileFormat = 0,
+  // One line per distinct stack of Dart functions, outermost function
+  // first and separated by ';', followed by the number of samples. This is
+  // the input of flamegraph.pl.
+  kFlameGraphProfileFormat
+} Dart_ProfileFormat;
+
+/**
+ * Starts the sampling CPU profiler. The stack of the running thread is
+ * sampled every period_micros microseconds of CPU time. The samples of a
+ * previous run are discarded.
+ *
+ * eturn True if the profiler was started, false if it is already running
+ *   or if it is not supported on this platform.
+ */
+DART_EXPORT bool Dart_StartProfiling(intptr_t period_micros);
+
+/**
+ * Stops the sampling CPU profiler. The samples are kept until the profiler
+ * is started again.
+ */
+DART_EXPORT void Dart_StopProfiling();
+
+/**
+ * Writes the samples taken by the CPU profiler. The flame graph format only
+ * includes the samples of the current isolate, as the addresses of other
+ * isolates cannot be resolved to Dart functions.
+ *
+ * \param format The format of the profile.
+ * \param callback A function pointer that will be repeatedly invoked
+ *   with profile data.
+ * \param stream A pointer that will be passed to the callback.
+ *
+ * eturn Success if the profile was written.
+ */
+DART_EXPORT Dart_Handle Dart_WriteProfile(Dart_ProfileFormat format,
+                                          Dart_ProfileWriteCallback callback,
+                                          void* stream);
+
 // Support for generating flow graph compiler debugging output into a file.
 typedef void (*FileWriterFunction)(const char* buffer, int64_t num_bytes);
 DART_EXPORT void Dart_InitFlowGraphPrinting(FileWriterFunction function);
@@ -38,6 +38,10 @@ class Thread {
   }
   static void SetThreadLocal(ThreadLocalKey key, uword value);
   static intptr_t GetMaxStackSize();
+
+  // Sets lower and upper to the bounds of the stack of the calling thread.
+  // Returns false if they cannot be determined.
+  static bool GetStackBounds(uword* lower, uword* upper);
 };
 
 
@@ -135,6 +135,24 @@ intptr_t Thread::GetMaxStackSize() {
 }
 
 
+bool Thread::GetStackBounds(uword* lower, uword* upper) {
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+    return false;
+  }
+  void* base;
+  size_t size;
+  int result = pthread_attr_getstack(&attr, &base, &size);
+  pthread_attr_destroy(&attr);
+  if (result != 0) {
+    return false;
+  }
+  *lower = reinterpret_cast<uword>(base);
+  *upper = *lower + size;
+  return true;
+}
+
+
 Mutex::Mutex() {
   pthread_mutexattr_t attr;
   int result = pthread_mutexattr_init(&attr);
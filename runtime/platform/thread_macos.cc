@@ -119,6 +119,15 @@ intptr_t Thread::GetMaxStackSize() {
 }
 
 
+bool Thread::GetStackBounds(uword* lower, uword* upper) {
+  // The stack address of a thread is the upper end of its stack.
+  pthread_t self = pthread_self();
+  *upper = reinterpret_cast<uword>(pthread_get_stackaddr_np(self));
+  *lower = *upper - pthread_get_stacksize_np(self);
+  return true;
+}
+
+
 Mutex::Mutex() {
   pthread_mutexattr_t attr;
   int result = pthread_mutexattr_init(&attr);
@@ -89,6 +89,15 @@ intptr_t Thread::GetMaxStackSize() {
 }
 
 
+bool Thread::GetStackBounds(uword* lower, uword* upper) {
+  // The stack limit is the lower end of the committed part of the stack.
+  NT_TIB* tib = reinterpret_cast<NT_TIB*>(NtCurrentTeb());
+  *lower = reinterpret_cast<uword>(tib->StackLimit);
+  *upper = reinterpret_cast<uword>(tib->StackBase);
+  return true;
+}
+
+
 void Thread::SetThreadLocal(ThreadLocalKey key, uword value) {
   ASSERT(key != kUnsetThreadLocalKey);
   BOOL result = TlsSetValue(key, reinterpret_cast<void*>(value));
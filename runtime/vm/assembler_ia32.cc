@@ -13,8 +13,6 @@
 
 namespace dart {
 
-DECLARE_RUNTIME_ENTRY(StoreBuffer);
-
 DEFINE_FLAG(bool, print_stop_message, true, "Print stop message.");
 DEFINE_FLAG(bool, code_comments, false,
             "Include comments into code and disassembly");
@@ -1386,28 +1384,47 @@ void Assembler::CompareObject(Register reg, const Object& object) {
 }
 
 
+void Assembler::StoreIntoObjectFilter(Register object,
+                                      Register value,
+                                      Label* no_update) {
+  // Storing a smi does not require a barrier.
+  testl(value, Immediate(kHeapObjectTag));
+  j(ZERO, no_update, Assembler::kNearJump);
+  // Storing into a new object does not require a barrier.
+  testl(object, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, no_update, Assembler::kNearJump);
+  // Storing a new object requires a store buffer update.
+  Label update;
+  testl(value, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, &update, Assembler::kNearJump);
+  // Storing an old object only requires marking it while its page is being
+  // marked incrementally. There is no scratch register, the value register
+  // is restored without affecting the flags.
+  pushl(value);
+  andl(value, Immediate(~(PageSpace::kPageAlignment - 1)));
+  cmpl(Address(value, HeapPage::marking_offset()), Immediate(0));
+  popl(value);
+  j(EQUAL, no_update, Assembler::kNearJump);
+  Bind(&update);
+}
+
+
 void Assembler::StoreIntoObject(Register object,
                                 const FieldAddress& dest,
                                 Register value) {
   movl(dest, value);
   Label done;
-  // Check that 'value' is a new object.  Store buffer updates are not
-  // required when storing a smi or an old object.
-  testl(value, Immediate(kNewObjectAlignmentOffset | kHeapObjectTag));
-  j(PARITY_ODD, &done, Assembler::kNearJump);
-  // Check that 'object' is an old object.  A store buffer update is
-  // not required when storing into a new object.
-  testl(object, Immediate(kNewObjectAlignmentOffset));
-  j(NOT_ZERO, &done, Assembler::kNearJump);
-  // A store buffer update is required.
-  pushal();
-  movl(EBP, ESP);
-  ReserveAlignedFrameSpace(kWordSize);
-  movl(EAX, dest);
-  movl(Address(ESP, 0), EAX);  // Push argument
-  CallRuntime(kStoreBufferRuntimeEntry);
-  movl(ESP, EBP);
-  popal();
+  StoreIntoObjectFilter(object, value, &done);
+  // A store buffer update or marking is required. Pass the object and the
+  // address of the slot to the stub, which preserves all registers.
+  pushl(EAX);
+  pushl(object);
+  leal(EAX, dest);
+  pushl(EAX);
+  call(&StubCode::UpdateStoreBufferLabel());
+  popl(EAX);  // Discard the arguments.
+  popl(EAX);
+  popl(EAX);
   Bind(&done);
 }
 
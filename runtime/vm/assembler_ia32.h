@@ -597,6 +597,12 @@ class Assembler : public ValueObject {
   const Code::Comments& GetCodeComments() const;
 
  private:
+  // Jumps to 'no_update' if storing 'value' into 'object' neither requires
+  // the slot to be recorded in the store buffer nor the value to be marked.
+  void StoreIntoObjectFilter(Register object,
+                             Register value,
+                             Label* no_update);
+
   AssemblerBuffer buffer_;
   int prolog_offset_;
 
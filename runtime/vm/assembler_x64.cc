@@ -1402,11 +1402,44 @@ void Assembler::CompareObject(Register reg, const Object& object) {
 }
 
 
+void Assembler::StoreIntoObjectFilter(Register object,
+                                      Register value,
+                                      Label* no_update) {
+  // Storing a smi does not require a barrier.
+  testq(value, Immediate(kHeapObjectTag));
+  j(ZERO, no_update, Assembler::kNearJump);
+  // Storing into a new object does not require a barrier.
+  testq(object, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, no_update, Assembler::kNearJump);
+  // Storing a new object requires a store buffer update.
+  Label update;
+  testq(value, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, &update, Assembler::kNearJump);
+  // Storing an old object only requires marking it while its page is being
+  // marked incrementally.
+  movq(TMP, value);
+  andq(TMP, Immediate(~(PageSpace::kPageAlignment - 1)));
+  cmpq(Address(TMP, HeapPage::marking_offset()), Immediate(0));
+  j(EQUAL, no_update, Assembler::kNearJump);
+  Bind(&update);
+}
+
+
 void Assembler::StoreIntoObject(Register object,
                                 const FieldAddress& dest,
                                 Register value) {
-  // TODO(iposva): Add write barrier.
   movq(dest, value);
+  Label done;
+  StoreIntoObjectFilter(object, value, &done);
+  // A store buffer update or marking is required. Pass the object and the
+  // address of the slot to the stub, which preserves all registers except TMP.
+  pushq(object);
+  leaq(TMP, dest);
+  pushq(TMP);
+  call(&StubCode::UpdateStoreBufferLabel());
+  popq(TMP);  // Discard the arguments.
+  popq(TMP);
+  Bind(&done);
 }
 
 
@@ -0,0 +1,38 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_ATOMIC_H_
+#define VM_ATOMIC_H_
+
+#include "platform/globals.h"
+
+#include "vm/allocation.h"
+
+namespace dart {
+
+class AtomicOperations : public AllStatic {
+ public:
+  // Atomically compare *ptr to old_value, and if equal, store new_value.
+  // Returns the original value at ptr. Acts as a full memory barrier.
+  static uword CompareAndSwapWord(uword* ptr, uword old_value, uword new_value);
+
+  // Atomically add value to *ptr and return the new value.
+  static intptr_t FetchAndAddWord(intptr_t* ptr, intptr_t value);
+};
+
+}  // namespace dart
+
+// We need to use the platform specific implementations of the atomic
+// operations. They are defined inline in the following headers.
+#if defined(TARGET_OS_LINUX)
+#include "vm/atomic_linux.h"
+#elif defined(TARGET_OS_MACOS)
+#include "vm/atomic_macos.h"
+#elif defined(TARGET_OS_WINDOWS)
+#include "vm/atomic_win.h"
+#else
+#error Unknown target os.
+#endif
+
+#endif  // VM_ATOMIC_H_
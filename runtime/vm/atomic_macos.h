@@ -0,0 +1,28 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_ATOMIC_MACOS_H_
+#define VM_ATOMIC_MACOS_H_
+
+#if !defined(VM_ATOMIC_H_)
+#error Do not include atomic_macos.h directly. Use atomic.h instead.
+#endif
+
+namespace dart {
+
+inline uword AtomicOperations::CompareAndSwapWord(uword* ptr,
+                                                  uword old_value,
+                                                  uword new_value) {
+  return __sync_val_compare_and_swap(ptr, old_value, new_value);
+}
+
+
+inline intptr_t AtomicOperations::FetchAndAddWord(intptr_t* ptr,
+                                                  intptr_t value) {
+  return __sync_add_and_fetch(ptr, value);
+}
+
+}  // namespace dart
+
+#endif  // VM_ATOMIC_MACOS_H_
@@ -0,0 +1,50 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_ATOMIC_WIN_H_
+#define VM_ATOMIC_WIN_H_
+
+#if !defined(VM_ATOMIC_H_)
+#error Do not include atomic_win.h directly. Use atomic.h instead.
+#endif
+
+namespace dart {
+
+inline uword AtomicOperations::CompareAndSwapWord(uword* ptr,
+                                                  uword old_value,
+                                                  uword new_value) {
+#if defined(TARGET_ARCH_X64)
+  return static_cast<uword>(
+      InterlockedCompareExchange64(reinterpret_cast<LONGLONG*>(ptr),
+                                   static_cast<LONGLONG>(new_value),
+                                   static_cast<LONGLONG>(old_value)));
+#elif defined(TARGET_ARCH_IA32)
+  return static_cast<uword>(
+      InterlockedCompareExchange(reinterpret_cast<LONG*>(ptr),
+                                 static_cast<LONG>(new_value),
+                                 static_cast<LONG>(old_value)));
+#else
+#error Unsupported host architecture.
+#endif
+}
+
+
+inline intptr_t AtomicOperations::FetchAndAddWord(intptr_t* ptr,
+                                                  intptr_t value) {
+#if defined(TARGET_ARCH_X64)
+  return static_cast<intptr_t>(
+      InterlockedExchangeAdd64(reinterpret_cast<LONGLONG*>(ptr),
+                               static_cast<LONGLONG>(value))) + value;
+#elif defined(TARGET_ARCH_IA32)
+  return static_cast<intptr_t>(
+      InterlockedExchangeAdd(reinterpret_cast<LONG*>(ptr),
+                             static_cast<LONG>(value))) + value;
+#else
+#error Unsupported host architecture.
+#endif
+}
+
+}  // namespace dart
+
+#endif  // VM_ATOMIC_WIN_H_
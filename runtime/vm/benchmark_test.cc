@@ -9,7 +9,10 @@
 #include "platform/assert.h"
 
 #include "vm/dart_api_impl.h"
+#include "vm/message_handler.h"
+#include "vm/port.h"
 #include "vm/stack_frame.h"
+#include "vm/thread.h"
 #include "vm/unit_test.h"
 
 namespace dart {
@@ -274,6 +277,8 @@ static void StackFrame_accessFrame(Dart_NativeArguments args) {
       } else if (frame->IsDartFrame()) {
         code ^= frame->LookupDartCode();
         EXPECT(code.function() != Function::null());
+        // Stack traces and the debugger only know the pc of a frame.
+        EXPECT(Code::LookupCode(frame->pc()) == code.raw());
       }
       frame = frames.NextFrame();
     }
@@ -342,4 +347,79 @@ BENCHMARK(FrameLookup) {
   benchmark->set_score(elapsed_time);
 }
 
+
+//
+// Measure posting messages from several threads to a single port.
+//
+class BenchmarkMessageHandler : public MessageHandler {
+ public:
+  BenchmarkMessageHandler() : message_count_(0) { }
+
+  bool HandleMessage(Message* message) {
+    delete message;
+    message_count_++;
+    return true;
+  }
+
+  intptr_t message_count() const { return message_count_; }
+
+ private:
+  intptr_t message_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(BenchmarkMessageHandler);
+};
+
+
+struct PostMessagesInfo {
+  Dart_Port port;
+  intptr_t count;
+  Monitor* monitor;
+  intptr_t* num_running;
+};
+
+
+static void PostMessages(uword param) {
+  PostMessagesInfo* info = reinterpret_cast<PostMessagesInfo*>(param);
+  for (intptr_t i = 0; i < info->count; i++) {
+    PortMap::PostMessage(
+        new Message(info->port, 0, NULL, Message::kNormalPriority));
+  }
+  MonitorLocker ml(info->monitor);
+  (*info->num_running)--;
+  ml.Notify();
+}
+
+
+BENCHMARK(PostMessageContention) {
+  const intptr_t kNumThreads = 4;
+  const intptr_t kNumMessages = 100000;
+  BenchmarkMessageHandler handler;
+  Dart_Port port = PortMap::CreatePort(&handler);
+  Monitor monitor;
+  intptr_t num_running = kNumThreads;
+  PostMessagesInfo infos[kNumThreads];
+  Timer timer(true, "PostMessageContention benchmark");
+  timer.Start();
+  for (intptr_t i = 0; i < kNumThreads; i++) {
+    infos[i].port = port;
+    infos[i].count = kNumMessages;
+    infos[i].monitor = &monitor;
+    infos[i].num_running = &num_running;
+    Thread::Start(PostMessages, reinterpret_cast<uword>(&infos[i]));
+  }
+  while (handler.message_count() < kNumThreads * kNumMessages) {
+    handler.HandleNextMessage();
+  }
+  timer.Stop();
+  {
+    MonitorLocker ml(&monitor);
+    while (num_running > 0) {
+      ml.Wait();
+    }
+  }
+  PortMap::ClosePort(port);
+  int64_t elapsed_time = timer.TotalElapsedTime();
+  benchmark->set_score(elapsed_time);
+}
+
 }  // namespace dart
@@ -48,6 +48,8 @@ class ClassTable {
 
   RawClass** table_;
 
+  friend class HeapImage;
+
   DISALLOW_COPY_AND_ASSIGN(ClassTable);
 };
 
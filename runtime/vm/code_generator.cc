@@ -14,6 +14,7 @@
 #include "vm/object_store.h"
 #include "vm/message.h"
 #include "vm/message_handler.h"
+#include "vm/optimization_queue.h"
 #include "vm/resolver.h"
 #include "vm/runtime_entry.h"
 #include "vm/stack_frame.h"
@@ -28,10 +29,17 @@ DEFINE_FLAG(bool, trace_patching, false, "Trace patching of code.");
 DEFINE_FLAG(bool, trace_runtime_calls, false, "Trace runtime calls.");
 DEFINE_FLAG(int, optimization_counter_threshold, 2000,
     "function's usage-counter value before it is optimized, -1 means never.");
+DEFINE_FLAG(bool, use_osr, true,
+    "Continue hot loops of unoptimized frames in optimized code.");
+DEFINE_FLAG(int, max_polymorphic_checks, 8,
+    "Number of receiver classes recorded at an instance call before it "
+    "dispatches through the functions cache of the receiver's class.");
 DECLARE_FLAG(bool, enable_type_checks);
 DECLARE_FLAG(bool, trace_type_checks);
 DECLARE_FLAG(bool, report_usage_count);
 DECLARE_FLAG(int, deoptimization_counter_threshold);
+DECLARE_FLAG(bool, trace_compiler);
+DECLARE_FLAG(bool, use_new_compiler);
 DEFINE_FLAG(charp, optimization_filter, NULL, "Optimize only named function");
 
 
@@ -939,6 +947,16 @@ static RawFunction* InlineCacheMissHandler(
   ASSERT(caller_frame != NULL);
   ICData& ic_data = ICData::Handle(
       CodePatcher::GetInstanceCallIcDataAt(caller_frame->pc()));
+  if (ic_data.NumberOfChecks() >= FLAG_max_polymorphic_checks) {
+    // The call is megamorphic, the IC stub jumps to the megamorphic lookup
+    // instead of calling this handler for receivers it does not record.
+    if (FLAG_trace_ic) {
+      OS::Print("InlineCacheMissHandler megamorphic call at 0x%x -> <%s>\n",
+          caller_frame->pc(),
+          target_function.ToCString());
+    }
+    return target_function.raw();
+  }
 #if defined(DEBUG)
   for (intptr_t i = 0; i < ic_data.NumberOfChecks(); i++) {
     GrowableArray<intptr_t> class_ids;
@@ -1286,6 +1304,114 @@ DEFINE_RUNTIME_ENTRY(ClosureArgumentMismatch, 0) {
 }
 
 
+// Returns the pc following the stack check with the given node id in
+// 'code', or 0 if there is none.
+static uword GetStackCheckPcAtNodeId(const Code& code, intptr_t node_id) {
+  const PcDescriptors& descriptors =
+      PcDescriptors::Handle(code.pc_descriptors());
+  for (intptr_t i = 0; i < descriptors.Length(); i++) {
+    if ((descriptors.NodeId(i) == node_id) &&
+        (descriptors.DescriptorKind(i) == PcDescriptors::kOther)) {
+      return descriptors.PC(i);
+    }
+  }
+  return 0;
+}
+
+
+// Returns true if the top Dart frame runs the unoptimized code of 'function'.
+static bool IsRunningUnoptimizedCode(const Function& function) {
+  DartFrameIterator iterator;
+  StackFrame* caller_frame = iterator.NextFrame();
+  ASSERT(caller_frame != NULL);
+  const Code& code = Code::Handle(caller_frame->LookupDartCode());
+  return !code.is_optimized() && (code.function() == function.raw());
+}
+
+
+// On-stack replacement. The top Dart frame is unoptimized code that called
+// the runtime from the stack check of a loop because the usage counter of
+// its function reached the optimization threshold. Optimize the function if
+// needed and continue the frame in the optimized code, after the same stack
+// check. As for deoptimization, both versions of the code have the same frame
+// layout and the expression stack is empty at loop stack checks, so only the
+// return pc and the saved pc marker of the frame need to be patched.
+static void AttemptOnStackReplacement(Isolate* isolate) {
+  const intptr_t kLowInvocationCount = -100000000;
+  DartFrameIterator iterator;
+  StackFrame* caller_frame = iterator.NextFrame();
+  ASSERT(caller_frame != NULL);
+  const Code& unoptimized_code = Code::Handle(caller_frame->LookupDartCode());
+  if (unoptimized_code.is_optimized()) {
+    return;
+  }
+  const Function& function = Function::Handle(unoptimized_code.function());
+  if (function.usage_counter() <= FLAG_optimization_counter_threshold) {
+    // Interrupt, or the stack check at function entry.
+    return;
+  }
+  const PcDescriptors& descriptors =
+      PcDescriptors::Handle(unoptimized_code.pc_descriptors());
+  intptr_t node_id = AstNode::kNoId;
+  for (intptr_t i = 0; i < descriptors.Length(); i++) {
+    if (static_cast<uword>(descriptors.PC(i)) == caller_frame->pc()) {
+      node_id = descriptors.NodeId(i);
+      break;
+    }
+  }
+  if (node_id == AstNode::kNoId) {
+    return;
+  }
+  if (isolate->debugger()->IsActive() ||
+      (function.deoptimization_counter() >=
+          FLAG_deoptimization_counter_threshold) ||
+      !function.is_optimizable()) {
+    function.set_usage_counter(kLowInvocationCount);
+    return;
+  }
+  if ((FLAG_optimization_filter != NULL) &&
+      (strncmp(function.ToFullyQualifiedCString(),
+               FLAG_optimization_filter,
+               strlen(FLAG_optimization_filter)) != 0)) {
+    function.set_usage_counter(kLowInvocationCount);
+    return;
+  }
+  if (!function.HasOptimizedCode()) {
+    // Compilation patches the entry of unoptimized code.
+    const Error& error =
+        Error::Handle(Compiler::CompileOptimizedFunction(function));
+    if (!error.IsNull()) {
+      Exceptions::PropagateError(error);
+    }
+    if (!function.HasOptimizedCode()) {
+      // The optimizing compiler bailed out.
+      function.set_usage_counter(kLowInvocationCount);
+      return;
+    }
+  }
+  const Code& optimized_code = Code::Handle(function.CurrentCode());
+  ASSERT(optimized_code.is_optimized());
+  const uword continue_at_pc =
+      GetStackCheckPcAtNodeId(optimized_code, node_id);
+  if (continue_at_pc == 0) {
+    // The optimized code has no matching stack check.
+    function.set_usage_counter(kLowInvocationCount);
+    return;
+  }
+  if (FLAG_trace_compiler) {
+    OS::Print("On-stack replacement of '%s' at id %d: 0x%x -> 0x%x\n",
+              function.ToFullyQualifiedCString(),
+              node_id,
+              caller_frame->pc(),
+              continue_at_pc);
+  }
+  caller_frame->set_pc(continue_at_pc);
+  caller_frame->SetEntrypointMarker(
+      optimized_code.EntryPoint() +
+      AssemblerMacros::kOffsetOfSavedPCfromEntrypoint);
+}
+
+
 DEFINE_RUNTIME_ENTRY(StackOverflow, 0) {
   ASSERT(arguments.Count() ==
          kStackOverflowRuntimeEntry.argument_count());
@@ -1306,6 +1432,9 @@ DEFINE_RUNTIME_ENTRY(StackOverflow, 0) {
   if (interrupt_bits & Isolate::kMessageInterrupt) {
     isolate->message_handler()->HandleOOBMessages();
   }
+  if (interrupt_bits & Isolate::kOptimizeInterrupt) {
+    isolate->optimization_queue()->OptimizeNext();
+  }
   if (interrupt_bits & Isolate::kApiInterrupt) {
     Dart_IsolateInterruptCallback callback = isolate->InterruptCallback();
     if (callback) {
@@ -1317,6 +1446,10 @@ DEFINE_RUNTIME_ENTRY(StackOverflow, 0) {
       }
     }
   }
+
+  if (FLAG_use_osr && FLAG_use_new_compiler && CodeGenerator::CanOptimize()) {
+    AttemptOnStackReplacement(isolate);
+  }
 }
 
 
@@ -1346,6 +1479,13 @@ DEFINE_RUNTIME_ENTRY(OptimizeInvokedFunction, 1) {
     // a loop. Maybe test if the code has been optimized before calling.
     // If this happens from optimized code, then it means that the optimized
     // code needs to be reoptimized.
+    if (FLAG_use_osr && FLAG_use_new_compiler &&
+        IsRunningUnoptimizedCode(function)) {
+      // The function was optimized while this frame runs a loop. The usage
+      // counter stays above the threshold until the stack check of the loop
+      // continues the frame in the optimized code.
+      return;
+    }
     function.set_usage_counter(kLowInvocationCount);
     return;
   }
@@ -1356,7 +1496,12 @@ DEFINE_RUNTIME_ENTRY(OptimizeInvokedFunction, 1) {
     function.set_usage_counter(kLowInvocationCount);
     return;
   }
-  if (function.is_optimizable()) {
+  if (function.is_optimizable() && FLAG_queue_optimizations) {
+    // Keep running the unoptimized code until the queued function gets
+    // optimized at a later stack check.
+    isolate->optimization_queue()->Add(function);
+    function.set_usage_counter(kLowInvocationCount);
+  } else if (function.is_optimizable()) {
     ASSERT(!function.HasOptimizedCode());
     const Code& unoptimized_code = Code::Handle(function.unoptimized_code());
     // Compilation patches the entry of unoptimized code.
@@ -1522,37 +1667,91 @@ void FunctionsCache::EnterFunctionAt(int i,
 }
 
 
+intptr_t FunctionsCache::FindEntry(const Array& cache,
+                                   const String& function_name,
+                                   int num_arguments,
+                                   int num_named_arguments) {
+  const intptr_t capacity = cache.Length() / kNumEntries;
+  ASSERT(Utils::IsPowerOfTwo(capacity));
+  const intptr_t mask = capacity - 1;
+  String& test_name = String::Handle();
+  Smi& smi = Smi::Handle();
+  intptr_t index = function_name.Hash() & mask;
+  while (true) {
+    const intptr_t i = index * kNumEntries;
+    test_name ^= cache.At(i + kFunctionName);
+    if (test_name.IsNull()) {
+      return i;
+    }
+    if (function_name.Equals(test_name)) {
+      smi ^= cache.At(i + kArgCount);
+      if (num_arguments == smi.Value()) {
+        smi ^= cache.At(i + kNamedArgCount);
+        if (num_named_arguments == smi.Value()) {
+          return i;
+        }
+      }
+    }
+    index = (index + 1) & mask;
+  }
+  UNREACHABLE();
+  return -1;
+}
+
+
+void FunctionsCache::Grow(const Array& cache) {
+  const Array& new_cache = Array::Handle(
+      Array::New(2 * cache.Length(), Heap::kOld));
+  Function& function = Function::Handle();
+  Smi& num_arguments = Smi::Handle();
+  Smi& num_named_arguments = Smi::Handle();
+  for (intptr_t i = 0; i < cache.Length(); i += kNumEntries) {
+    function ^= cache.At(i + kFunction);
+    if (!function.IsNull()) {
+      num_arguments ^= cache.At(i + kArgCount);
+      num_named_arguments ^= cache.At(i + kNamedArgCount);
+      const String& name = String::Handle(function.name());
+      EnterFunctionAt(FindEntry(new_cache,
+                                name,
+                                num_arguments.Value(),
+                                num_named_arguments.Value()),
+                      new_cache,
+                      function,
+                      num_arguments.Value(),
+                      num_named_arguments.Value());
+    }
+  }
+  class_.set_functions_cache(new_cache);
+}
+
+
 void FunctionsCache::AddCompiledFunction(const Function& function,
                                          int num_arguments,
                                          int num_named_arguments) {
-// TODO(srdjan): Evaluate if populating the function cache is needed.
-// It is turned off currently because we do not populate code objects
-// in snapshot and hence end up in an inconsistent state as function
-// cache is populated but there are no code objects.
-#if 0
   ASSERT(function.HasCode());
   Array& cache = Array::Handle(class_.functions_cache());
-  // Search for first free slot. Last entry is always NULL object.
-  for (intptr_t i = 0; i < (cache.Length() - kNumEntries); i += kNumEntries) {
-    if (Object::Handle(cache.At(i)).IsNull()) {
-      EnterFunctionAt(i,
-                      cache,
-                      function,
-                      num_arguments,
-                      num_named_arguments);
-      return;
+  if (cache.IsNull()) {
+    // Classes read from a snapshot start without a cache.
+    cache = Array::New(kInitialCapacity * kNumEntries, Heap::kOld);
+    class_.set_functions_cache(cache);
+  }
+  intptr_t used = 0;
+  for (intptr_t i = 0; i < cache.Length(); i += kNumEntries) {
+    if (cache.At(i + kFunctionName) != Object::null()) {
+      used++;
     }
   }
-  intptr_t ix = cache.Length() - kNumEntries;
-  // Grow by 8 entries.
-  cache = Array::Grow(cache, cache.Length() + (8 * kNumEntries));
-  class_.set_functions_cache(cache);
-  EnterFunctionAt(ix,
+  // Keep the table at most half full.
+  if (2 * (used + 1) > (cache.Length() / kNumEntries)) {
+    Grow(cache);
+    cache = class_.functions_cache();
+  }
+  const String& name = String::Handle(function.name());
+  EnterFunctionAt(FindEntry(cache, name, num_arguments, num_named_arguments),
                   cache,
                   function,
                   num_arguments,
                   num_named_arguments);
-#endif
 }
 
 
@@ -1561,39 +1760,31 @@ RawCode* FunctionsCache::LookupCode(const String& function_name,
                                     int num_arguments,
                                     int num_named_arguments) {
   const Array& cache = Array::Handle(class_.functions_cache());
-  String& test_name = String::Handle();
-  for (intptr_t i = 0; i < cache.Length(); i += kNumEntries) {
-    test_name ^= cache.At(i + FunctionsCache::kFunctionName);
-    if (test_name.IsNull()) {
-      // Found NULL, no more entries to check, abort lookup.
-      return Code::null();
-    }
-    if (function_name.Equals(test_name)) {
-      Smi& smi = Smi::Handle();
-      smi ^= cache.At(i + FunctionsCache::kArgCount);
-      if (num_arguments == smi.Value()) {
-        smi ^= cache.At(i + FunctionsCache::kNamedArgCount);
-        if (num_named_arguments == smi.Value()) {
-          Function& result = Function::Handle();
-          result ^= cache.At(i + FunctionsCache::kFunction);
-          ASSERT(!result.IsNull());
-          ASSERT(result.HasCode());
-          return result.CurrentCode();
-        }
-      }
-    }
+  if (cache.IsNull()) {
+    return Code::null();
   }
-  // The cache is null terminated, therefore the loop above should never
-  // terminate by itself.
-  UNREACHABLE();
-  return Code::null();
+  const intptr_t i =
+      FindEntry(cache, function_name, num_arguments, num_named_arguments);
+  Function& result = Function::Handle();
+  result ^= cache.At(i + kFunction);
+  if (result.IsNull()) {
+    return Code::null();
+  }
+  ASSERT(result.HasCode());
+  return result.CurrentCode();
 }
 
 
-// Adds a pointer to the store buffer.
+// Adds a pointer to the store buffer if the stored value is a new object,
+// otherwise marks the stored value while the old generation is being marked.
 // ptr: the address of a field being stored into.
 DEFINE_LEAF_RUNTIME_ENTRY(void, StoreBuffer, uword ptr) {
-  Isolate::Current()->store_buffer()->AddPointer(ptr);
+  RawObject* value = *reinterpret_cast<RawObject**>(ptr);
+  if (value->IsNewObject()) {
+    Isolate::Current()->store_buffer()->AddPointer(ptr);
+  } else {
+    Isolate::Current()->heap()->MarkingBarrier(value);
+  }
 }
 END_LEAF_RUNTIME_ENTRY
 
@@ -53,6 +53,8 @@ DECLARE_RUNTIME_ENTRY(Throw);
 DECLARE_RUNTIME_ENTRY(TraceFunctionEntry);
 DECLARE_RUNTIME_ENTRY(TraceFunctionExit);
 
+DECLARE_LEAF_RUNTIME_ENTRY(void, StoreBuffer, uword ptr);
+
 #define DEOPT_REASONS(V) \
   V(DeoptUnknown) \
   V(DeoptIncrLocal) \
@@ -90,17 +92,22 @@ DEOPT_REASONS(DEFINE_ENUM_LIST)
 #undef DEFINE_ENUM_LIST
 };
 
-// This class wraps around the array RawClass::functions_cache_.
-// The structure of that array is specified by FunctionsCache::Entries.
-// The last entry in the array is always NULL, the lookup code can rely on
-// last entry being NULL to terminate its search.
-// The compiled functions are added sequentially (except for the last entry
-// being empty). Names of functions with variable number of arguments
-// can appear several times, once for each valid argument count.
+// This class wraps around the array RawClass::functions_cache_, a hash table
+// of the compiled instance functions invoked on instances of the class. It is
+// probed by the megamorphic lookup stub, keyed on the function name symbol and
+// the argument counts of the call. The structure of an entry is specified by
+// FunctionsCache::Entries.
+// The number of entries is a power of two. Entries are found by linear probing
+// starting at the hash of the name, and the table is kept at most half full so
+// that every probe ends at an empty entry.
+// Names of functions with variable number of arguments can appear several
+// times, once for each valid argument count.
+// The cache refers to functions, whose current code is used at each call,
+// and it is not written to snapshots.
 class FunctionsCache : public ValueObject {
  public:
   // Entries in the RawClass::functions_cache_. The size of initially allocated
-  // functions_cache_ array is (kInitialSize * kNumEntries).
+  // functions_cache_ array is (kInitialCapacity * kNumEntries).
   enum Entries {
     kFunctionName = 0,
     kArgCount = 1,
@@ -109,24 +116,36 @@ class FunctionsCache : public ValueObject {
     kNumEntries = 4
   };
 
+  static const intptr_t kInitialCapacity = 8;
+
   explicit FunctionsCache(const Class& cls) : class_(cls) {}
 
   void AddCompiledFunction(const Function& function,
                            int num_arguments,
                            int num_named_arguments);
 
-  // This is a testing function, the lookup (will) occur inlined in stub code.
+  // The same lookup as the one in the megamorphic lookup stub.
   RawCode* LookupCode(const String& function_name,
                       int num_arguments,
                       int num_named_arguments);
 
  private:
+  // Returns the index of the entry matching the name and argument counts, or
+  // of the empty entry ending the probe.
+  static intptr_t FindEntry(const Array& cache,
+                            const String& function_name,
+                            int num_arguments,
+                            int num_named_arguments);
+
   static void EnterFunctionAt(int i,
                               const Array& cache,
                               const Function& function,
                               int num_arguments,
                               int num_named_arguments);
 
+  // Allocates a table with twice the capacity and reenters all entries.
+  void Grow(const Array& cache);
+
   const Class& class_;
 };
 
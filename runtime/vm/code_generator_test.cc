@@ -11,6 +11,7 @@
 #include "vm/class_finalizer.h"
 #include "vm/code_generator.h"
 #include "vm/compiler.h"
+#include "vm/dart_api_impl.h"
 #include "vm/dart_entry.h"
 #include "vm/native_entry.h"
 #include "vm/native_entry_test.h"
@@ -503,6 +504,98 @@ CODEGEN_TEST_RAW_RUN(AllocateNewObjectCodegen, function) {
   EXPECT_EQ(cls.raw(), result.clazz());
 }
 
+
+TEST_CASE(MegamorphicCall) {
+  // The call 'a.f()' sees more receiver classes than are recorded.
+  const char* kScriptChars =
+      "class A0 { f() => 0; }\n"
+      "class A1 extends A0 { f() => 1; }\n"
+      "class A2 extends A0 { f() => 2; }\n"
+      "class A3 extends A0 { f() => 3; }\n"
+      "class A4 extends A0 { f() => 4; }\n"
+      "class A5 extends A0 { f() => 5; }\n"
+      "class A6 extends A0 { f() => 6; }\n"
+      "class A7 extends A0 { f() => 7; }\n"
+      "class A8 extends A0 { f() => 8; }\n"
+      "class A9 extends A0 { f() => 9; }\n"
+      "class A10 extends A0 { }\n"
+      "main() {\n"
+      "  var list = [new A0(), new A1(), new A2(), new A3(), new A4(),\n"
+      "              new A5(), new A6(), new A7(), new A8(), new A9(),\n"
+      "              new A10()];\n"
+      "  var sum = 0;\n"
+      "  for (var i = 0; i < 3; i++) {\n"
+      "    for (var a in list) {\n"
+      "      sum += a.f();\n"
+      "    }\n"
+      "  }\n"
+      "  return sum;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(135, value);
+
+  // The inherited function is cached in the receiver's class.
+  Library& library = Library::Handle();
+  library ^= Api::UnwrapHandle(lib);
+  const Class& cls = Class::Handle(
+      library.LookupClass(String::Handle(String::NewSymbol("A10"))));
+  EXPECT(!cls.IsNull());
+  FunctionsCache functions_cache(cls);
+  const Code& code = Code::Handle(
+      functions_cache.LookupCode(String::Handle(String::NewSymbol("f")),
+                                 1,
+                                 0));
+  EXPECT(!code.IsNull());
+  EXPECT(Function::Handle(code.function()).owner() ==
+         library.LookupClass(String::Handle(String::NewSymbol("A0"))));
+}
+
+
+
+TEST_CASE(InlineCacheCounts) {
+  // The inline cache stub counts the calls of each receiver class.
+  const char* kScriptChars =
+      "class A { f() => 1; }\n"
+      "class B { f() => 2; }\n"
+      "callF(x) { return x.f(); }\n"
+      "main() {\n"
+      "  var a = new A();\n"
+      "  var b = new B();\n"
+      "  var sum = 0;\n"
+      "  for (var i = 0; i < 2; i++) sum += callF(a);\n"
+      "  for (var i = 0; i < 3; i++) sum += callF(b);\n"
+      "  return sum;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(8, value);
+
+  Library& library = Library::Handle();
+  library ^= Api::UnwrapHandle(lib);
+  const Function& function = Function::Handle(
+      library.LookupLocalFunction(String::Handle(String::NewSymbol("callF"))));
+  EXPECT(!function.IsNull());
+  const Code& code = Code::Handle(function.unoptimized_code());
+  EXPECT(!code.IsNull());
+  GrowableArray<intptr_t> node_ids;
+  const GrowableObjectArray& ic_data_objs =
+      GrowableObjectArray::Handle(GrowableObjectArray::New());
+  code.ExtractIcDataArraysAtCalls(&node_ids, ic_data_objs);
+  EXPECT_EQ(1, ic_data_objs.Length());
+  ICData& ic_data = ICData::Handle();
+  ic_data ^= ic_data_objs.At(0);
+  EXPECT_EQ(2, ic_data.NumberOfChecks());
+  EXPECT_EQ(2, ic_data.GetCountAt(0));
+  EXPECT_EQ(3, ic_data.GetCountAt(1));
+}
+
 }  // namespace dart
 
 #endif  // defined TARGET_ARCH_IA32 || defined(TARGET_ARCH_X64)
@@ -16,6 +16,7 @@
 #include "vm/flow_graph_builder.h"
 #include "vm/flow_graph_compiler.h"
 #include "vm/flow_graph_optimizer.h"
+#include "vm/il_printer.h"
 #include "vm/longjump.h"
 #include "vm/object.h"
 #include "vm/object_store.h"
@@ -40,6 +41,12 @@ DEFINE_FLAG(bool, use_new_compiler, false,
     "Try to use the new compiler backend.");
 #endif
 DEFINE_FLAG(bool, trace_bailout, false, "Print bailout from new compiler.");
+DECLARE_FLAG(bool, common_subexpression_elimination);
+DECLARE_FLAG(bool, constant_propagation);
+DECLARE_FLAG(bool, dead_code_elimination);
+DECLARE_FLAG(bool, loop_invariant_code_motion);
+DECLARE_FLAG(bool, print_flow_graph);
+DECLARE_FLAG(bool, use_ssa);
 
 
 // Compile a function. Should call only if the function has not been compiled.
@@ -198,6 +205,31 @@ static bool CompileWithNewCompiler(
       if (optimized) {
         FlowGraphOptimizer optimizer(block_order);
         optimizer.ApplyICData();
+
+        if (FLAG_use_ssa) {
+          if (FLAG_constant_propagation) {
+            ConstantPropagator propagator(block_order);
+            propagator.Optimize();
+          }
+          if (FLAG_common_subexpression_elimination) {
+            DominatorBasedCSE cse(block_order);
+            cse.Optimize();
+          }
+          if (FLAG_loop_invariant_code_motion) {
+            LICM licm(block_order);
+            licm.Optimize();
+          }
+          if (FLAG_dead_code_elimination) {
+            DeadCodeElimination dce(block_order);
+            dce.Optimize();
+          }
+          if (FLAG_print_flow_graph) {
+            OS::Print("After SSA optimizations:\n");
+            FlowGraphPrinter printer(Function::Handle(), block_order);
+            printer.PrintBlocks();
+          }
+          graph_builder.Bailout("No SSA code generation support.");
+        }
       }
     }
 
@@ -242,6 +274,9 @@ static bool CompileWithNewCompiler(
     Error& bailout_error = Error::Handle(
         isolate->object_store()->sticky_error());
     isolate->object_store()->clear_sticky_error();
+    // The type feedback must not be attached to the graphs of other
+    // functions.
+    isolate->set_ic_data_array(Array::null());
     if (FLAG_trace_bailout) {
       OS::Print("%s\n", bailout_error.ToErrorCString());
     }
@@ -499,13 +534,19 @@ RawError* Compiler::CompileParsedFunction(
 
 
 RawError* Compiler::CompileAllFunctions(const Class& cls) {
-  Error& error = Error::Handle();
-  Array& functions = Array::Handle(cls.functions());
-  Function& func = Function::Handle();
+  Isolate* isolate = Isolate::Current();
+  Error& error = Error::Handle(isolate);
+  Array& functions = Array::Handle(isolate, cls.functions());
+  Function& func = Function::Handle(isolate);
   for (int i = 0; i < functions.Length(); i++) {
     func ^= functions.At(i);
     ASSERT(!func.IsNull());
     if (!func.HasCode() && !func.IsAbstract()) {
+      // The parse tree, flow graph and handles of a function are not needed
+      // once its code is installed, release them before compiling the next
+      // one instead of holding those of the whole program.
+      Zone zone(isolate);
+      HandleScope handle_scope(isolate);
       error = CompileFunction(func);
       if (!error.IsNull()) {
         return error.raw();
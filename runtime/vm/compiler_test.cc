@@ -2,14 +2,20 @@
 // for details. All rights reserved. Use of this source code is governed by a
 // BSD-style license that can be found in the LICENSE file.
 
+#include "include/dart_api.h"
 #include "platform/assert.h"
 #include "vm/class_finalizer.h"
 #include "vm/compiler.h"
+#include "vm/dart_api_impl.h"
 #include "vm/object.h"
 #include "vm/unit_test.h"
 
 namespace dart {
 
+DECLARE_FLAG(int, optimization_counter_threshold);
+DECLARE_FLAG(bool, use_new_compiler);
+DECLARE_FLAG(bool, use_ssa);
+
 // Compiler only implemented on IA32 and X64 now.
 #if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
 
@@ -60,6 +66,147 @@ TEST_CASE(CompileFunction) {
   EXPECT(function_moo.HasCode());
 }
 
+
+static RawFunction* LookupTestFunction(const char* name) {
+  const Library& library = Library::Handle(
+      Library::LookupLibrary(String::Handle(String::New(TestCase::url()))));
+  EXPECT(!library.IsNull());
+  return library.LookupLocalFunction(String::Handle(String::NewSymbol(name)));
+}
+
+
+TEST_CASE(OnStackReplacement) {
+  // On-stack replacement continues frames in code of the flow graph
+  // compiler, which does not generate code from SSA yet.
+  const bool saved_use_new_compiler = FLAG_use_new_compiler;
+  const bool saved_use_ssa = FLAG_use_ssa;
+  FLAG_use_new_compiler = true;
+  FLAG_use_ssa = false;
+  // The loop runs long enough to reach the optimization threshold in its
+  // only invocation.
+  const char* kScriptChars =
+      "loop() {\n"
+      "  var sum = 0;\n"
+      "  for (var i = 0; i < 10000; i++) {\n"
+      "    sum += i;\n"
+      "  }\n"
+      "  return sum;\n"
+      "}\n"
+      "main() {\n"
+      "  return loop();\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(49995000, value);
+
+  // The unoptimized code counts the iterations until the frame is
+  // transferred, the optimized code does not count them.
+  const Function& function = Function::Handle(LookupTestFunction("loop"));
+  EXPECT(function.HasOptimizedCode());
+  EXPECT_LT(FLAG_optimization_counter_threshold, function.usage_counter());
+  EXPECT_GT(10000, function.usage_counter());
+  FLAG_use_new_compiler = saved_use_new_compiler;
+  FLAG_use_ssa = saved_use_ssa;
+}
+
+
+// Optimizes 'loop' while its unoptimized frame runs the loop, and drops the
+// pc descriptors of the optimized code. The optimized code then has no stack
+// check matching the one of the loop.
+static void CompileLoopWithoutStackChecks(Dart_NativeArguments args) {
+  Dart_EnterScope();
+  {
+    Isolate* isolate = Isolate::Current();
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    const Function& function = Function::Handle(LookupTestFunction("loop"));
+    EXPECT(Compiler::CompileOptimizedFunction(function) == Error::null());
+    const Code& code = Code::Handle(function.CurrentCode());
+    EXPECT(code.is_optimized());
+    code.set_pc_descriptors(PcDescriptors::Handle(PcDescriptors::New(0)));
+  }
+  Dart_SetReturnValue(args, Dart_Null());
+  Dart_ExitScope();
+}
+
+
+static Dart_NativeFunction CompileLoopNativeLookup(Dart_Handle name,
+                                                   int argument_count) {
+  return reinterpret_cast<Dart_NativeFunction>(&CompileLoopWithoutStackChecks);
+}
+
+
+TEST_CASE(OnStackReplacementWithoutMatchingStackCheck) {
+  const bool saved_use_new_compiler = FLAG_use_new_compiler;
+  const bool saved_use_ssa = FLAG_use_ssa;
+  FLAG_use_new_compiler = true;
+  FLAG_use_ssa = false;
+  const char* kScriptChars =
+      "class Native {\n"
+      "  static void compileLoop() native 'CompileLoopWithoutStackChecks';\n"
+      "}\n"
+      "loop() {\n"
+      "  var sum = 0;\n"
+      "  for (var i = 0; i < 10000; i++) {\n"
+      "    if (i == 0) Native.compileLoop();\n"
+      "    sum += i;\n"
+      "  }\n"
+      "  return sum;\n"
+      "}\n"
+      "main() {\n"
+      "  return loop();\n"
+      "}\n";
+  Dart_Handle lib =
+      TestCase::LoadTestScript(kScriptChars, CompileLoopNativeLookup);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(49995000, value);
+
+  // The frame stays in the unoptimized code, which stops attempting the
+  // replacement.
+  const Function& function = Function::Handle(LookupTestFunction("loop"));
+  EXPECT(function.HasOptimizedCode());
+  EXPECT_GT(0, function.usage_counter());
+  FLAG_use_new_compiler = saved_use_new_compiler;
+  FLAG_use_ssa = saved_use_ssa;
+}
+
+
+// The parse trees and flow graphs of the compiled functions are freed as
+// each function is done, they do not accumulate in the zone of the caller.
+TEST_CASE(CompileAllFunctionsReleasesZone) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static f0(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "  static f1(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "  static f2(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "  static f3(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "  static f4(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "  static f5(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "  static f6(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "  static f7(a, b) { var c = [a, b]; return c.length + a * b - 1; }\n"
+      "}\n";
+  TestCase::LoadTestScript(kScriptChars, NULL);
+  EXPECT(ClassFinalizer::FinalizePendingClasses());
+  const Library& lib = Library::Handle(
+      Library::LookupLibrary(String::Handle(String::New(TestCase::url()))));
+  const Class& cls = Class::Handle(
+      lib.LookupClass(String::Handle(String::NewSymbol("A"))));
+  EXPECT(!cls.IsNull());
+  Zone* zone = Isolate::Current()->current_zone();
+  const intptr_t size_before = zone->SizeInBytes();
+  EXPECT(Compiler::CompileAllFunctions(cls) == Error::null());
+  EXPECT_EQ(size_before, zone->SizeInBytes());
+  const Function& function = Function::Handle(
+      cls.LookupStaticFunction(String::Handle(String::NewSymbol("f7"))));
+  EXPECT(function.HasCode());
+}
+
 #endif  // TARGET_ARCH_IA32 || TARGET_ARCH_X64
 
 }  // namespace dart
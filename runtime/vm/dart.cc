@@ -9,10 +9,12 @@
 #include "vm/freelist.h"
 #include "vm/handles.h"
 #include "vm/heap.h"
+#include "vm/heap_image.h"
 #include "vm/isolate.h"
 #include "vm/object.h"
 #include "vm/object_store.h"
 #include "vm/port.h"
+#include "vm/profiler.h"
 #include "vm/snapshot.h"
 #include "vm/stub_code.h"
 #include "vm/thread_pool.h"
@@ -23,6 +25,9 @@ namespace dart {
 
 DECLARE_FLAG(bool, print_class_table);
 DECLARE_FLAG(bool, trace_isolates);
+DEFINE_FLAG(bool, use_heap_image, true,
+    "Initialize isolates by copying the heap of the first isolate which was "
+    "read from the same snapshot.");
 
 Isolate* Dart::vm_isolate_ = NULL;
 ThreadPool* Dart::thread_pool_ = NULL;
@@ -42,6 +47,8 @@ bool Dart::InitOnce(Dart_IsolateCreateCallback create,
   PortMap::InitOnce();
   FreeListElement::InitOnce();
   Api::InitOnce();
+  HeapImage::InitOnce();
+  Profiler::InitOnce();
   // Create the VM isolate and finish the VM initialization.
   ASSERT(thread_pool_ == NULL);
   thread_pool_ = new ThreadPool();
@@ -88,15 +95,27 @@ RawError* Dart::InitializeIsolate(const uint8_t* snapshot_buffer, void* data) {
       return error.raw();
     }
   } else {
-    // Initialize from snapshot (this should replicate the functionality
-    // of Object::Init(..) in a regular isolate creation path.
-    Object::InitFromSnapshot(isolate);
     const Snapshot* snapshot = Snapshot::SetupFromBuffer(snapshot_buffer);
     if (FLAG_trace_isolates) {
       OS::Print("Size of isolate snapshot = %ld\n", snapshot->length());
     }
-    SnapshotReader reader(snapshot, isolate);
-    reader.ReadFullSnapshot();
+    const HeapImage* image =
+        FLAG_use_heap_image ? HeapImage::Lookup(snapshot) : NULL;
+    if (image != NULL) {
+      image->Restore();
+      if (FLAG_trace_isolates) {
+        OS::Print("Restored heap image (%dk)\n", (image->size() / KB));
+      }
+    } else {
+      // Initialize from snapshot (this should replicate the functionality
+      // of Object::Init(..) in a regular isolate creation path.
+      Object::InitFromSnapshot(isolate);
+      SnapshotReader reader(snapshot, isolate);
+      reader.ReadFullSnapshot();
+      if (FLAG_use_heap_image) {
+        HeapImage::Capture(snapshot);
+      }
+    }
     if (FLAG_trace_isolates) {
       isolate->heap()->PrintSizes();
     }
@@ -22,6 +22,7 @@
 #include "vm/object.h"
 #include "vm/object_store.h"
 #include "vm/port.h"
+#include "vm/profiler.h"
 #include "vm/resolver.h"
 #include "vm/stack_frame.h"
 #include "vm/timer.h"
@@ -986,11 +987,15 @@ DART_EXPORT bool Dart_Post(Dart_Port port_id, Dart_Handle handle) {
   DARTSCOPE_NOCHECKS(isolate);
   const Object& object = Object::Handle(isolate, Api::UnwrapHandle(handle));
   uint8_t* data = NULL;
-  SnapshotWriter writer(Snapshot::kMessage, &data, &allocator);
+  MessageBuffers* buffers = new MessageBuffers();
+  SnapshotWriter writer(Snapshot::kMessage, &data, &allocator, buffers);
   writer.WriteObject(object.raw());
   writer.FinalizeBuffer();
-  return PortMap::PostMessage(new Message(
-      port_id, Message::kIllegalPort, data, Message::kNormalPriority));
+  return PortMap::PostMessage(new Message(port_id,
+                                          Message::kIllegalPort,
+                                          data,
+                                          buffers,
+                                          Message::kNormalPriority));
 }
 
 
@@ -3650,6 +3655,43 @@ DART_EXPORT void Dart_GetPprofSymbolInfo(void** buffer, int* buffer_size) {
 }
 
 
+DART_EXPORT bool Dart_StartProfiling(intptr_t period_micros) {
+  if (period_micros <= 0) {
+    return false;
+  }
+  return Profiler::Start(period_micros);
+}
+
+
+DART_EXPORT void Dart_StopProfiling() {
+  Profiler::Stop();
+}
+
+
+DART_EXPORT Dart_Handle Dart_WriteProfile(Dart_ProfileFormat format,
+                                          Dart_ProfileWriteCallback callback,
+                                          void* stream) {
+  Isolate* isolate = Isolate::Current();
+  CHECK_ISOLATE(isolate);
+  if (callback == NULL) {
+    return Api::NewError("%s expects argument 'callback' to be non-null.",
+                         CURRENT_FUNC);
+  }
+  switch (format) {
+    case kPprofProfileFormat:
+      Profiler::WritePprof(callback, stream);
+      break;
+    case kFlameGraphProfileFormat:
+      Profiler::WriteFlameGraph(callback, stream);
+      break;
+    default:
+      return Api::NewError("%s expects argument 'format' to be a valid "
+                           "Dart_ProfileFormat.", CURRENT_FUNC);
+  }
+  return Api::Success(isolate);
+}
+
+
 DART_EXPORT void Dart_InitFlowGraphPrinting(FileWriterFunction function) {
   Dart::set_flow_graph_writer(function);
 }
@@ -3,6 +3,7 @@
 // BSD-style license that can be found in the LICENSE file.
 
 #include "vm/dart_api_message.h"
+#include "vm/message.h"
 #include "vm/object.h"
 #include "vm/object_store.h"
 
@@ -18,9 +19,11 @@ static const int kNumInitialReferences = 4;
 
 ApiMessageReader::ApiMessageReader(const uint8_t* buffer,
                                    intptr_t length,
-                                   ReAlloc alloc)
+                                   ReAlloc alloc,
+                                   MessageBuffers* buffers)
     : BaseReader(buffer, length),
       alloc_(alloc),
+      buffers_(buffers),
       backward_references_(kNumInitialReferences) {
   Init();
 }
@@ -358,6 +361,18 @@ Dart_CObject* ApiMessageReader::ReadInternalVMObject(intptr_t class_id,
       }
       return object;
     }
+    case ObjectStore::kExternalUint8ArrayClass: {
+      // The contents were sent as an out-of-band buffer of the message.
+      ASSERT(buffers_ != NULL);
+      intptr_t len = ReadSmiValue();
+      intptr_t index = ReadIntptrValue();
+      ASSERT(buffers_->SizeAt(index) == len);
+      Dart_CObject* object = AllocateDartCObject(Dart_CObject::kUint8Array);
+      object->value.as_byte_array.length = len;
+      object->value.as_byte_array.values = buffers_->DataAt(index);
+      AddBackRef(object_id, object, kIsDeserialized);
+      return object;
+    }
     default:
       // Everything else not supported.
       return AllocateDartCObjectUnsupported();
@@ -27,7 +27,12 @@ struct Dart_CObject_Internal : public Dart_CObject {
 // Reads a message snapshot into a C structure.
 class ApiMessageReader : public BaseReader {
  public:
-  ApiMessageReader(const uint8_t* buffer, intptr_t length, ReAlloc alloc);
+  // The out-of-band buffers of the message, if any, must stay alive as long
+  // as the decoded message is used.
+  ApiMessageReader(const uint8_t* buffer,
+                   intptr_t length,
+                   ReAlloc alloc,
+                   MessageBuffers* buffers = NULL);
   ~ApiMessageReader() { }
 
   Dart_CObject* ReadMessage();
@@ -102,6 +107,7 @@ class ApiMessageReader : public BaseReader {
   // either in the supplied zone or using the supplied allocation
   // function.
   ReAlloc alloc_;
+  MessageBuffers* buffers_;
   ApiGrowableArray<BackRefNode*> backward_references_;
 
   Dart_CObject type_arguments_marker;
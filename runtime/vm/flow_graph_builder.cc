@@ -2375,10 +2375,6 @@ void FlowGraphBuilder::BuildGraph(bool for_optimized) {
       printer.PrintFunction();
     }
   }
-
-  if (for_optimized && FLAG_use_ssa) {
-    Bailout("No SSA code generation support.");
-  }
 }
 
 
@@ -2577,6 +2573,11 @@ void FlowGraphBuilder::Rename(intptr_t var_count) {
   if (parsed_function().copied_parameter_count()) {
     Bailout("Copied parameter support in SSA");
   }
+  // Catch entries are only reachable from the graph entry, their blocks are
+  // not renamed.
+  if (graph_entry_->SuccessorCount() > 1) {
+    Bailout("Catch entry support in SSA");
+  }
   Value* null_value = new ConstantVal(Object::ZoneHandle());
   // TODO(fschneider): Change this assert once parameters are supported.
   ASSERT(var_count == parsed_function().stack_local_count());
@@ -2646,9 +2647,8 @@ void FlowGraphBuilder::RenameRecursive(BlockEntryInstr* block_entry,
     if ((load != NULL) || (store != NULL)) {
       // Remove instruction with LoadLocal or StoreLocal.
       prev->SetSuccessor(current->StraightLineSuccessor());
-      // Update renaming environment for StoreLocal.
-      if (store != NULL) {
-        (*env)[store->local().BitIndexIn(var_count)] = store->value();
+      if (block_entry->last_instruction() == current) {
+        block_entry->set_last_instruction(prev);
       }
     } else {
       // Assign new SSA temporary.
@@ -2690,6 +2690,12 @@ void FlowGraphBuilder::RenameRecursive(BlockEntryInstr* block_entry,
       }
     }
 
+    // Update renaming environment for StoreLocal, after the stored value has
+    // been renamed itself.
+    if (store != NULL) {
+      (*env)[store->local().BitIndexIn(var_count)] = store->value();
+    }
+
     // Update previous only if no instruction was removed from the graph.
     if ((load == NULL) && (store == NULL)) {
       prev = current;
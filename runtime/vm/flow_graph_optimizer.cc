@@ -4,14 +4,32 @@
 
 #include "vm/flow_graph_optimizer.h"
 
+#include "vm/ast.h"
 #include "vm/flow_graph_builder.h"
 #include "vm/il_printer.h"
 #include "vm/object_store.h"
+#include "vm/parser.h"
+#include "vm/resolver.h"
 
 namespace dart {
 
+DEFINE_FLAG(bool, use_inlining, true,
+    "Inline calls to small functions returning a field of the receiver or "
+    "a constant.");
+DEFINE_FLAG(int, inlining_max_tokens, 16,
+    "Functions with more tokens are never inlined.");
+DEFINE_FLAG(bool, constant_propagation, false,
+    "Sparse conditional constant propagation on the SSA form.");
+DEFINE_FLAG(bool, common_subexpression_elimination, false,
+    "Dominator based common subexpression elimination on the SSA form.");
+DEFINE_FLAG(bool, loop_invariant_code_motion, false,
+    "Loop invariant code motion on the SSA form.");
+DEFINE_FLAG(bool, dead_code_elimination, false,
+    "Dead code elimination on the SSA form.");
 DECLARE_FLAG(bool, enable_type_checks);
+DECLARE_FLAG(int, max_polymorphic_checks);
 DECLARE_FLAG(bool, print_flow_graph);
+DECLARE_FLAG(bool, trace_compiler);
 DECLARE_FLAG(bool, trace_optimization);
 
 void FlowGraphOptimizer::ApplyICData() {
@@ -229,16 +247,69 @@ static RawICData* ToUnaryClassChecks(const ICData& ic_data) {
     }
     if (duplicate_class_id >= 0) {
       ASSERT(result.GetTargetAt(duplicate_class_id) == ic_data.GetTargetAt(i));
+      // Merge the counts of all checks with the same receiver class.
+      const intptr_t count = result.GetCountAt(duplicate_class_id) +
+          ic_data.GetCountAt(i);
+      result.SetCountAt(duplicate_class_id,
+                        Smi::IsValid(count) ? count : Smi::kMaxValue);
     } else {
       // This will make sure that Smi is first if it exists.
       result.AddReceiverCheck(class_id,
-                              Function::Handle(ic_data.GetTargetAt(i)));
+                              Function::Handle(ic_data.GetTargetAt(i)),
+                              ic_data.GetCountAt(i));
     }
   }
   return result.raw();
 }
 
 
+// Returns a copy of the unary ICData with the checks ordered by decreasing
+// count, so that the most frequent receiver classes are tested first. A Smi
+// check is placed first regardless of its count, as Smis are tested
+// separately.
+RawICData* FlowGraphOptimizer::SortByCount(const ICData& ic_data) {
+  ASSERT(ic_data.num_args_tested() == 1);
+  const intptr_t num_checks = ic_data.NumberOfChecks();
+  intptr_t smi_index = -1;
+  GrowableArray<intptr_t> order(num_checks);
+  for (intptr_t i = 0; i < num_checks; i++) {
+    if (ic_data.GetReceiverClassIdAt(i) == kSmi) {
+      smi_index = i;
+      continue;
+    }
+    // Insertion sort, the number of checks is small. Equal counts keep the
+    // order in which the classes were seen.
+    const intptr_t count = ic_data.GetCountAt(i);
+    intptr_t pos = order.length();
+    order.Add(i);
+    while ((pos > 0) && (ic_data.GetCountAt(order[pos - 1]) < count)) {
+      order[pos] = order[pos - 1];
+      pos--;
+    }
+    order[pos] = i;
+  }
+  ICData& result = ICData::Handle(ICData::New(
+      Function::Handle(ic_data.function()),
+      String::Handle(ic_data.target_name()),
+      ic_data.id(),
+      ic_data.num_args_tested()));
+  Function& target = Function::Handle();
+  if (smi_index >= 0) {
+    target = ic_data.GetTargetAt(smi_index);
+    result.AddReceiverCheck(kSmi, target, ic_data.GetCountAt(smi_index));
+  }
+  // The Smi check is already in place, the others are appended in order.
+  for (intptr_t i = 0; i < order.length(); i++) {
+    const intptr_t index = order[i];
+    target = ic_data.GetTargetAt(index);
+    result.AddReceiverCheck(ic_data.GetReceiverClassIdAt(index),
+                            target,
+                            ic_data.GetCountAt(index));
+  }
+  return result.raw();
+}
+
+
 // Only unique implicit instance getters can be currently handled.
 bool FlowGraphOptimizer::TryInlineInstanceGetter(InstanceCallComp* comp) {
   ASSERT(comp->HasICData());
@@ -352,6 +423,139 @@ bool FlowGraphOptimizer::TryInlineInstanceMethod(InstanceCallComp* comp) {
 }
 
 
+// Returns the value returned by a small function whose body consists of a
+// single return statement, NULL otherwise. The body is parsed again,
+// only functions which already ran are considered.
+static AstNode* ParseReturnedValue(const Function& function) {
+  if (!FLAG_use_inlining ||
+      function.is_native() ||
+      !function.HasCode() ||
+      ((function.kind() != RawFunction::kFunction) &&
+       (function.kind() != RawFunction::kGetterFunction)) ||
+      ((function.end_token_index() - function.token_index()) >
+       FLAG_inlining_max_tokens)) {
+    return NULL;
+  }
+  ParsedFunction parsed_function(function);
+  Parser::ParseFunction(&parsed_function);
+  // The statements of the body are nested in the sequence of its scope.
+  AstNode* statement = parsed_function.node_sequence();
+  while ((statement != NULL) && statement->IsSequenceNode()) {
+    SequenceNode* sequence = statement->AsSequenceNode();
+    statement = (sequence->length() == 1) ? sequence->NodeAt(0) : NULL;
+  }
+  if (statement == NULL) {
+    return NULL;
+  }
+  ReturnNode* return_node = statement->AsReturnNode();
+  if ((return_node == NULL) ||
+      (return_node->inlined_finally_list_length() != 0)) {
+    return NULL;
+  }
+  return return_node->value();
+}
+
+
+// Returns true if the node loads 'this', which is not captured in the
+// functions considered for inlining.
+static bool IsReceiverLoad(AstNode* node) {
+  if (!node->IsLoadLocalNode()) {
+    return false;
+  }
+  const LocalVariable& local = node->AsLoadLocalNode()->local();
+  return !local.is_captured() && local.name().Equals("this");
+}
+
+
+// Returns the field returned by a method whose body is 'return this.field;'
+// for receivers of the given class, null otherwise. The field is accessed
+// through its implicit getter, which may be overridden in subclasses.
+static RawField* GetReturnedField(AstNode* value, intptr_t class_id) {
+  if (value->IsLoadInstanceFieldNode()) {
+    LoadInstanceFieldNode* load = value->AsLoadInstanceFieldNode();
+    return IsReceiverLoad(load->instance()) ? load->field().raw()
+                                            : Field::null();
+  }
+  if (!value->IsInstanceGetterNode() ||
+      !IsReceiverLoad(value->AsInstanceGetterNode()->receiver())) {
+    return Field::null();
+  }
+  const String& field_name = value->AsInstanceGetterNode()->field_name();
+  const Class& cls =
+      Class::Handle(Isolate::Current()->class_table()->At(class_id));
+  const String& getter_name = String::Handle(Field::GetterName(field_name));
+  const Function& getter = Function::Handle(
+      Resolver::ResolveDynamicForReceiverClass(cls, getter_name, 1, 0));
+  if (getter.IsNull() || (getter.kind() != RawFunction::kImplicitGetter)) {
+    return Field::null();
+  }
+  return GetField(class_id, field_name);
+}
+
+
+// Inline instance methods and getters without arguments whose body is
+// 'return this.field;'. The load is guarded by the class checks of the call,
+// which deoptimize to the call in the unoptimized code. Implicit getters are
+// handled by TryInlineInstanceGetter.
+bool FlowGraphOptimizer::TryInlineFieldReturningMethod(InstanceCallComp* comp) {
+  ASSERT(comp->HasICData());
+  const ICData& ic_data = *comp->ic_data();
+  if ((comp->ArgumentCount() != 1) ||
+      (ic_data.NumberOfChecks() == 0) ||
+      !HasOneTarget(ic_data)) {
+    return false;
+  }
+  Function& target = Function::Handle();
+  GrowableArray<intptr_t> class_ids;
+  ic_data.GetCheckAt(0, &class_ids, &target);
+  if (target.is_static()) {
+    return false;
+  }
+  AstNode* value = ParseReturnedValue(target);
+  if (value == NULL) {
+    return false;
+  }
+  // All receiver classes seen must load the same field.
+  const Field& field = Field::ZoneHandle(GetReturnedField(value, class_ids[0]));
+  if (field.IsNull()) {
+    return false;
+  }
+  for (intptr_t i = 1; i < ic_data.NumberOfChecks(); i++) {
+    if (GetReturnedField(value, ic_data.GetReceiverClassIdAt(i)) !=
+        field.raw()) {
+      return false;
+    }
+  }
+  if (FLAG_trace_compiler) {
+    OS::Print("Inlining field load of '%s'\n",
+              target.ToFullyQualifiedCString());
+  }
+  LoadInstanceFieldComp* load =
+      new LoadInstanceFieldComp(field, comp->InputAt(0), comp);
+  load->set_ic_data(comp->ic_data());
+  comp->ReplaceWith(load);
+  return true;
+}
+
+
+// Inline static functions and getters without arguments whose body is
+// 'return <literal>;'.
+bool FlowGraphOptimizer::TryInlineConstantReturningFunction(
+    StaticCallComp* comp) {
+  if (comp->ArgumentCount() != 0) {
+    return false;
+  }
+  AstNode* value = ParseReturnedValue(comp->function());
+  if ((value == NULL) || !value->IsLiteralNode()) {
+    return false;
+  }
+  if (FLAG_trace_compiler) {
+    OS::Print("Inlining constant of '%s'\n",
+              comp->function().ToFullyQualifiedCString());
+  }
+  comp->ReplaceWith(new ConstantVal(value->AsLiteralNode()->literal()));
+  return true;
+}
 
 
 void FlowGraphOptimizer::VisitInstanceCall(InstanceCallComp* comp) {
@@ -370,11 +574,18 @@ void FlowGraphOptimizer::VisitInstanceCall(InstanceCallComp* comp) {
     if (TryInlineInstanceMethod(comp)) {
       return;
     }
+    if (TryInlineFieldReturningMethod(comp)) {
+      return;
+    }
     const intptr_t kMaxChecks = 4;
-    if (comp->ic_data()->num_args_tested() <= kMaxChecks) {
+    // Megamorphic calls are left to the megamorphic lookup, the recorded
+    // receivers are only a part of the ones seen.
+    if ((comp->ic_data()->num_args_tested() <= kMaxChecks) &&
+        (comp->ic_data()->NumberOfChecks() < FLAG_max_polymorphic_checks)) {
       PolymorphicInstanceCallComp* call = new PolymorphicInstanceCallComp(comp);
       ICData& unary_checks =
           ICData::Handle(ToUnaryClassChecks(*comp->ic_data()));
+      unary_checks = SortByCount(unary_checks);
       call->set_ic_data(&unary_checks);
       comp->ReplaceWith(call);
     }
@@ -387,7 +598,9 @@ void FlowGraphOptimizer::VisitStaticCall(StaticCallComp* comp) {
       MethodRecognizer::RecognizeKind(comp->function());
   if (recognized_kind == MethodRecognizer::kMathSqrt) {
     comp->set_recognized(MethodRecognizer::kMathSqrt);
+    return;
   }
+  TryInlineConstantReturningFunction(comp);
 }
 
 
@@ -551,4 +764,955 @@ void FlowGraphOptimizer::VisitBind(BindInstr* instr) {
 }
 
 
+// Returns one more than the highest SSA temporary index in the graph.
+static intptr_t ComputeSSATempCount(
+    const GrowableArray<BlockEntryInstr*>& block_order) {
+  intptr_t count = 0;
+  for (intptr_t i = 0; i < block_order.length(); ++i) {
+    BlockEntryInstr* block = block_order[i];
+    JoinEntryInstr* join = block->AsJoinEntry();
+    if ((join != NULL) && (join->phis() != NULL)) {
+      for (intptr_t j = 0; j < join->phis()->length(); ++j) {
+        PhiInstr* phi = (*join->phis())[j];
+        if (phi != NULL) {
+          count = Utils::Maximum(count, phi->ssa_temp_index() + 1);
+        }
+      }
+    }
+    for (Instruction* instr = block->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      if (instr->IsBind()) {
+        count = Utils::Maximum(count, instr->AsBind()->ssa_temp_index() + 1);
+      }
+    }
+  }
+  return count;
+}
+
+
+// Unlinks the instruction following prev from the block.
+static void RemoveInstruction(BlockEntryInstr* block,
+                              Instruction* prev,
+                              Instruction* instr) {
+  ASSERT(prev->StraightLineSuccessor() == instr);
+  prev->SetSuccessor(instr->StraightLineSuccessor());
+  if (block->last_instruction() == instr) {
+    block->set_last_instruction(prev);
+  }
+}
+
+
+static Computation* ComputationOf(Instruction* instr) {
+  if (instr->IsBind()) return instr->AsBind()->computation();
+  if (instr->IsDo()) return instr->AsDo()->computation();
+  return NULL;
+}
+
+
+static bool IsLoad(Computation* comp) {
+  return comp->IsLoadInstanceField() ||
+      comp->IsLoadVMField() ||
+      comp->IsLoadStaticField();
+}
+
+
+// Returns true if the computation may call other code or write to memory.
+// Computations which may deoptimize are considered free of side effects, the
+// remainder of the optimized code is not executed after deoptimizing.
+static bool HasSideEffects(Computation* comp) {
+  switch (comp->computation_type()) {
+    case Computation::kUse:
+    case Computation::kConstant:
+    case Computation::kCurrentContext:
+    case Computation::kStrictCompare:
+    case Computation::kBooleanNegate:
+    case Computation::kLoadInstanceField:
+    case Computation::kLoadVMField:
+    case Computation::kLoadStaticField:
+    case Computation::kBinaryOp:
+    case Computation::kUnarySmiOp:
+    case Computation::kNumberNegate:
+    case Computation::kToDouble:
+    case Computation::kAssertAssignable:
+    case Computation::kAssertBoolean:
+      return false;
+    default:
+      return true;
+  }
+}
+
+
+ConstantPropagator::ConstantPropagator(
+    const GrowableArray<BlockEntryInstr*>& blocks)
+    : block_order_(blocks),
+      non_constant_(Object::ZoneHandle()),
+      values_(),
+      uses_(),
+      instruction_blocks_(),
+      reachable_(new BitVector(blocks.length())),
+      block_worklist_(),
+      definition_worklist_() {
+  const intptr_t temp_count = ComputeSSATempCount(blocks);
+  for (intptr_t i = 0; i < temp_count; ++i) {
+    values_.Add(NULL);
+    uses_.Add(NULL);
+  }
+  const intptr_t cid_count = Isolate::Current()->computation_id();
+  for (intptr_t i = 0; i < cid_count; ++i) {
+    instruction_blocks_.Add(NULL);
+  }
+}
+
+
+void ConstantPropagator::AddUses(BlockEntryInstr* block, Instruction* instr) {
+  instruction_blocks_[instr->cid()] = block;
+  for (intptr_t i = 0; i < instr->InputCount(); ++i) {
+    Value* input = instr->InputAt(i);
+    if ((input == NULL) || !input->IsUse()) continue;
+    const intptr_t index = input->AsUse()->definition()->ssa_temp_index();
+    if (index < 0) continue;
+    if (uses_[index] == NULL) {
+      uses_[index] = new ZoneGrowableArray<Instruction*>(2);
+    }
+    uses_[index]->Add(instr);
+  }
+}
+
+
+void ConstantPropagator::Optimize() {
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    BlockEntryInstr* block = block_order_[i];
+    JoinEntryInstr* join = block->AsJoinEntry();
+    if ((join != NULL) && (join->phis() != NULL)) {
+      for (intptr_t j = 0; j < join->phis()->length(); ++j) {
+        PhiInstr* phi = (*join->phis())[j];
+        if (phi != NULL) AddUses(join, phi);
+      }
+    }
+    for (Instruction* instr = block->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      AddUses(block, instr);
+    }
+  }
+
+  GraphEntryInstr* graph_entry = block_order_[0]->AsGraphEntry();
+  ASSERT(graph_entry != NULL);
+  reachable_->Add(graph_entry->preorder_number());
+  for (intptr_t i = 0; i < graph_entry->SuccessorCount(); ++i) {
+    SetReachable(graph_entry->SuccessorAt(i));
+  }
+  while (!block_worklist_.is_empty() || !definition_worklist_.is_empty()) {
+    if (!block_worklist_.is_empty()) {
+      BlockEntryInstr* block = block_worklist_.Last();
+      block_worklist_.RemoveLast();
+      VisitBlock(block);
+      continue;
+    }
+    Definition* definition = definition_worklist_.Last();
+    definition_worklist_.RemoveLast();
+    ZoneGrowableArray<Instruction*>* uses =
+        uses_[definition->ssa_temp_index()];
+    if (uses == NULL) continue;
+    for (intptr_t i = 0; i < uses->length(); ++i) {
+      Instruction* use = (*uses)[i];
+      BlockEntryInstr* block = instruction_blocks_[use->cid()];
+      if (!reachable_->Contains(block->preorder_number())) continue;
+      if (use->IsPhi()) {
+        VisitPhi(block->AsJoinEntry(), use->AsPhi());
+      } else {
+        VisitInstruction(use);
+      }
+    }
+  }
+  Transform();
+}
+
+
+void ConstantPropagator::SetReachable(BlockEntryInstr* block) {
+  if (!reachable_->Contains(block->preorder_number())) {
+    reachable_->Add(block->preorder_number());
+    block_worklist_.Add(block);
+    return;
+  }
+  // Another predecessor of the join became reachable, the phis now take the
+  // values flowing in from it into account.
+  JoinEntryInstr* join = block->AsJoinEntry();
+  if ((join != NULL) && (join->phis() != NULL)) {
+    for (intptr_t i = 0; i < join->phis()->length(); ++i) {
+      PhiInstr* phi = (*join->phis())[i];
+      if (phi != NULL) VisitPhi(join, phi);
+    }
+  }
+}
+
+
+void ConstantPropagator::VisitBlock(BlockEntryInstr* block) {
+  JoinEntryInstr* join = block->AsJoinEntry();
+  if ((join != NULL) && (join->phis() != NULL)) {
+    for (intptr_t i = 0; i < join->phis()->length(); ++i) {
+      PhiInstr* phi = (*join->phis())[i];
+      if (phi != NULL) VisitPhi(join, phi);
+    }
+  }
+  for (Instruction* instr = block->StraightLineSuccessor();
+       (instr != NULL) && !instr->IsBlockEntry();
+       instr = instr->StraightLineSuccessor()) {
+    VisitInstruction(instr);
+  }
+  Instruction* successor = block->last_instruction()->StraightLineSuccessor();
+  if ((successor != NULL) && successor->IsBlockEntry()) {
+    SetReachable(successor->AsBlockEntry());
+  }
+}
+
+
+void ConstantPropagator::VisitInstruction(Instruction* instr) {
+  if (instr->IsBind()) {
+    SetValue(instr->AsBind(), Evaluate(instr->AsBind()->computation()));
+    return;
+  }
+  BranchInstr* branch = instr->AsBranch();
+  if (branch == NULL) return;
+  const Object* condition = ValueOf(branch->value());
+  if (IsUnknown(condition)) return;
+  if (IsConstant(condition) && condition->IsBool()) {
+    SetReachable((condition->raw() == Bool::True())
+                 ? branch->true_successor()
+                 : branch->false_successor());
+  } else {
+    SetReachable(branch->true_successor());
+    SetReachable(branch->false_successor());
+  }
+}
+
+
+void ConstantPropagator::VisitPhi(JoinEntryInstr* join, PhiInstr* phi) {
+  const Object* value = NULL;
+  for (intptr_t i = 0; i < phi->InputCount(); ++i) {
+    if (!reachable_->Contains(join->PredecessorAt(i)->preorder_number())) {
+      continue;
+    }
+    Value* input = phi->InputAt(i);
+    value = Meet(value, (input == NULL) ? &non_constant_ : ValueOf(input));
+  }
+  SetValue(phi, value);
+}
+
+
+void ConstantPropagator::SetValue(Definition* definition,
+                                  const Object* value) {
+  const intptr_t index = definition->ssa_temp_index();
+  const Object* current = values_[index];
+  // Values only move down the lattice.
+  const Object* new_value = Meet(current, value);
+  if (new_value != current) {
+    values_[index] = new_value;
+    definition_worklist_.Add(definition);
+  }
+}
+
+
+const Object* ConstantPropagator::ValueOf(Value* value) const {
+  if (value->IsConstant()) {
+    return &value->AsConstant()->value();
+  }
+  ASSERT(value->IsUse());
+  const intptr_t index = value->AsUse()->definition()->ssa_temp_index();
+  return (index < 0) ? &non_constant_ : values_[index];
+}
+
+
+const Object* ConstantPropagator::Meet(const Object* left,
+                                       const Object* right) const {
+  if (IsUnknown(left)) return right;
+  if (IsUnknown(right)) return left;
+  if (IsNonConstant(left) || IsNonConstant(right)) return &non_constant_;
+  return (left->raw() == right->raw()) ? left : &non_constant_;
+}
+
+
+const Object* ConstantPropagator::Evaluate(Computation* comp) const {
+  switch (comp->computation_type()) {
+    case Computation::kConstant:
+      return &comp->AsConstant()->value();
+    case Computation::kUse:
+      return ValueOf(comp->AsUse());
+    case Computation::kStrictCompare:
+    case Computation::kEqualityCompare:
+    case Computation::kRelationalOp:
+    case Computation::kBooleanNegate:
+    case Computation::kAssertBoolean:
+    case Computation::kBinaryOp:
+      break;
+    default:
+      return &non_constant_;
+  }
+  // The computations above are constant if all their inputs are.
+  bool has_unknown_input = false;
+  for (intptr_t i = 0; i < comp->InputCount(); ++i) {
+    const Object* value = ValueOf(comp->InputAt(i));
+    if (IsNonConstant(value)) return &non_constant_;
+    if (IsUnknown(value)) has_unknown_input = true;
+  }
+  if (has_unknown_input) return NULL;
+
+  const Object& input = *ValueOf(comp->InputAt(0));
+  switch (comp->computation_type()) {
+    case Computation::kStrictCompare:
+      return EvaluateComparison(comp->AsStrictCompare()->kind(),
+                                input,
+                                *ValueOf(comp->InputAt(1)));
+    case Computation::kEqualityCompare:
+      return EvaluateComparison(Token::kEQ,
+                                input,
+                                *ValueOf(comp->InputAt(1)));
+    case Computation::kRelationalOp:
+      return EvaluateComparison(comp->AsRelationalOp()->kind(),
+                                input,
+                                *ValueOf(comp->InputAt(1)));
+    case Computation::kBooleanNegate:
+      if (!input.IsBool()) return &non_constant_;
+      return &Bool::ZoneHandle(
+          (input.raw() == Bool::True()) ? Bool::False() : Bool::True());
+    case Computation::kAssertBoolean:
+      return input.IsBool() ? &input : &non_constant_;
+    case Computation::kBinaryOp:
+      return EvaluateBinaryOp(comp->AsBinaryOp(),
+                              input,
+                              *ValueOf(comp->InputAt(1)));
+    default:
+      UNREACHABLE();
+      return &non_constant_;
+  }
+}
+
+
+// Comparisons are only folded if they cannot call user defined operators.
+const Object* ConstantPropagator::EvaluateComparison(
+    Token::Kind kind, const Object& left, const Object& right) const {
+  bool result = false;
+  if ((kind == Token::kEQ_STRICT) || (kind == Token::kNE_STRICT)) {
+    result = (left.raw() == right.raw()) == (kind == Token::kEQ_STRICT);
+  } else if (left.IsSmi() && right.IsSmi()) {
+    const intptr_t left_value = Smi::CheckedHandle(left.raw()).Value();
+    const intptr_t right_value = Smi::CheckedHandle(right.raw()).Value();
+    switch (kind) {
+      case Token::kEQ: result = (left_value == right_value); break;
+      case Token::kLT: result = (left_value < right_value); break;
+      case Token::kGT: result = (left_value > right_value); break;
+      case Token::kLTE: result = (left_value <= right_value); break;
+      case Token::kGTE: result = (left_value >= right_value); break;
+      default: return &non_constant_;
+    }
+  } else if ((kind == Token::kEQ) && (left.IsNull() || right.IsNull())) {
+    result = (left.raw() == right.raw());
+  } else {
+    return &non_constant_;
+  }
+  return &Bool::ZoneHandle(result ? Bool::True() : Bool::False());
+}
+
+
+const Object* ConstantPropagator::EvaluateBinaryOp(
+    BinaryOpComp* comp, const Object& left, const Object& right) const {
+  if ((comp->operands_type() != BinaryOpComp::kSmiOperands) ||
+      !left.IsSmi() || !right.IsSmi()) {
+    return &non_constant_;
+  }
+  const int64_t left_value = Smi::CheckedHandle(left.raw()).Value();
+  const int64_t right_value = Smi::CheckedHandle(right.raw()).Value();
+  int64_t result = 0;
+  switch (comp->op_kind()) {
+    case Token::kADD: result = left_value + right_value; break;
+    case Token::kSUB: result = left_value - right_value; break;
+    case Token::kBIT_AND: result = left_value & right_value; break;
+    case Token::kBIT_OR: result = left_value | right_value; break;
+    case Token::kBIT_XOR: result = left_value ^ right_value; break;
+    case Token::kMUL:
+      // Avoid overflowing the 64-bit multiplication.
+      if (!Utils::IsInt(32, left_value) || !Utils::IsInt(32, right_value)) {
+        return &non_constant_;
+      }
+      result = left_value * right_value;
+      break;
+    default:
+      return &non_constant_;
+  }
+  if (!Smi::IsValid64(result)) {
+    // The operation deoptimizes on overflow.
+    return &non_constant_;
+  }
+  return &Smi::ZoneHandle(Smi::New(static_cast<intptr_t>(result)));
+}
+
+
+void ConstantPropagator::Transform() {
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    BlockEntryInstr* block = block_order_[i];
+    if (!reachable_->Contains(block->preorder_number())) continue;
+    JoinEntryInstr* join = block->AsJoinEntry();
+    if ((join != NULL) && (join->phis() != NULL)) {
+      for (intptr_t j = 0; j < join->phis()->length(); ++j) {
+        PhiInstr* phi = (*join->phis())[j];
+        if (phi != NULL) ReplaceConstantInputs(phi);
+      }
+    }
+    for (Instruction* instr = block->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      BindInstr* bind = instr->AsBind();
+      if (bind != NULL) {
+        const Object* value = values_[bind->ssa_temp_index()];
+        if (IsConstant(value) && !bind->computation()->IsConstant()) {
+          // The definition is now unused and removed by dead code
+          // elimination.
+          ConstantVal* constant =
+              new ConstantVal(Object::ZoneHandle(value->raw()));
+          bind->replace_computation(constant);
+          constant->set_instr(bind);
+          continue;
+        }
+      }
+      ReplaceConstantInputs(instr);
+    }
+  }
+}
+
+
+void ConstantPropagator::ReplaceConstantInputs(Instruction* instr) {
+  for (intptr_t i = 0; i < instr->InputCount(); ++i) {
+    Value* input = instr->InputAt(i);
+    if ((input == NULL) || !input->IsUse()) continue;
+    const Object* value = ValueOf(input);
+    if (IsConstant(value)) {
+      instr->SetInputAt(i, new ConstantVal(Object::ZoneHandle(value->raw())));
+    }
+  }
+}
+
+
+static bool AreEqualValues(Value* left, Value* right) {
+  if (left->IsUse() && right->IsUse()) {
+    return left->AsUse()->definition() == right->AsUse()->definition();
+  }
+  if (left->IsConstant() && right->IsConstant()) {
+    return left->AsConstant()->value().raw() ==
+        right->AsConstant()->value().raw();
+  }
+  return false;
+}
+
+
+static bool IsCSECandidate(Computation* comp) {
+  switch (comp->computation_type()) {
+    case Computation::kConstant:
+    case Computation::kLoadInstanceField:
+    case Computation::kLoadVMField:
+    case Computation::kLoadStaticField:
+    case Computation::kBinaryOp:
+    case Computation::kUnarySmiOp:
+    case Computation::kStrictCompare:
+    case Computation::kBooleanNegate:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+// Returns true if both candidates for CSE compute the same value.
+static bool AreEquivalent(Computation* left, Computation* right) {
+  if ((left->computation_type() != right->computation_type()) ||
+      (left->InputCount() != right->InputCount())) {
+    return false;
+  }
+  for (intptr_t i = 0; i < left->InputCount(); ++i) {
+    if (!AreEqualValues(left->InputAt(i), right->InputAt(i))) return false;
+  }
+  switch (left->computation_type()) {
+    case Computation::kConstant:
+      return AreEqualValues(left->AsConstant(), right->AsConstant());
+    case Computation::kLoadInstanceField:
+      return left->AsLoadInstanceField()->field().raw() ==
+          right->AsLoadInstanceField()->field().raw();
+    case Computation::kLoadVMField:
+      return left->AsLoadVMField()->offset_in_bytes() ==
+          right->AsLoadVMField()->offset_in_bytes();
+    case Computation::kLoadStaticField:
+      return left->AsLoadStaticField()->field().raw() ==
+          right->AsLoadStaticField()->field().raw();
+    case Computation::kBinaryOp:
+      return (left->AsBinaryOp()->op_kind() ==
+              right->AsBinaryOp()->op_kind()) &&
+          (left->AsBinaryOp()->operands_type() ==
+           right->AsBinaryOp()->operands_type());
+    case Computation::kUnarySmiOp:
+      return left->AsUnarySmiOp()->op_kind() ==
+          right->AsUnarySmiOp()->op_kind();
+    case Computation::kStrictCompare:
+      return left->AsStrictCompare()->kind() ==
+          right->AsStrictCompare()->kind();
+    case Computation::kBooleanNegate:
+      return true;
+    default:
+      UNREACHABLE();
+      return false;
+  }
+}
+
+
+static void RemoveLoads(GrowableArray<BindInstr*>* available) {
+  GrowableArray<BindInstr*> remaining(available->length());
+  for (intptr_t i = 0; i < available->length(); ++i) {
+    if (!IsLoad((*available)[i]->computation())) {
+      remaining.Add((*available)[i]);
+    }
+  }
+  available->Clear();
+  available->AddArray(remaining);
+}
+
+
+DominatorBasedCSE::DominatorBasedCSE(
+    const GrowableArray<BlockEntryInstr*>& blocks)
+    : block_order_(blocks), replacements_() {
+  const intptr_t temp_count = ComputeSSATempCount(blocks);
+  for (intptr_t i = 0; i < temp_count; ++i) {
+    replacements_.Add(NULL);
+  }
+}
+
+
+void DominatorBasedCSE::Optimize() {
+  GrowableArray<BindInstr*> available;
+  OptimizeRecursive(block_order_[0], &available);
+  // The inputs of phis flowing in along back edges are visited after the
+  // phis.
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    JoinEntryInstr* join = block_order_[i]->AsJoinEntry();
+    if ((join == NULL) || (join->phis() == NULL)) continue;
+    for (intptr_t j = 0; j < join->phis()->length(); ++j) {
+      PhiInstr* phi = (*join->phis())[j];
+      if (phi != NULL) ReplaceInputs(phi);
+    }
+  }
+}
+
+
+void DominatorBasedCSE::OptimizeRecursive(
+    BlockEntryInstr* block, GrowableArray<BindInstr*>* available) {
+  if (block->IsJoinEntry()) {
+    // Instructions with side effects may have executed in the other
+    // predecessors.
+    RemoveLoads(available);
+  }
+  Instruction* prev = block;
+  Instruction* instr = block->StraightLineSuccessor();
+  while ((instr != NULL) && !instr->IsBlockEntry()) {
+    Instruction* next = instr->StraightLineSuccessor();
+    ReplaceInputs(instr);
+    Computation* comp = ComputationOf(instr);
+    if (instr->IsBind() && IsCSECandidate(comp)) {
+      BindInstr* other = NULL;
+      for (intptr_t i = 0; i < available->length(); ++i) {
+        if (AreEquivalent((*available)[i]->computation(), comp)) {
+          other = (*available)[i];
+          break;
+        }
+      }
+      if (other != NULL) {
+        replacements_[instr->AsBind()->ssa_temp_index()] = other;
+        RemoveInstruction(block, prev, instr);
+        instr = next;
+        continue;
+      }
+      available->Add(instr->AsBind());
+    } else if ((comp != NULL) && HasSideEffects(comp)) {
+      RemoveLoads(available);
+    }
+    prev = instr;
+    instr = next;
+  }
+
+  for (intptr_t i = 0; i < block->dominated_blocks().length(); ++i) {
+    GrowableArray<BindInstr*> child_available(available->length());
+    child_available.AddArray(*available);
+    OptimizeRecursive(block->dominated_blocks()[i], &child_available);
+  }
+}
+
+
+void DominatorBasedCSE::ReplaceInputs(Instruction* instr) {
+  for (intptr_t i = 0; i < instr->InputCount(); ++i) {
+    Value* input = instr->InputAt(i);
+    if ((input == NULL) || !input->IsUse()) continue;
+    const intptr_t index = input->AsUse()->definition()->ssa_temp_index();
+    if ((index >= 0) && (replacements_[index] != NULL)) {
+      instr->SetInputAt(i, new UseVal(replacements_[index]));
+    }
+  }
+}
+
+
+static bool Dominates(BlockEntryInstr* dominator, BlockEntryInstr* block) {
+  while (block != NULL) {
+    if (block == dominator) return true;
+    block = block->dominator();
+  }
+  return false;
+}
+
+
+LICM::LICM(const GrowableArray<BlockEntryInstr*>& blocks)
+    : block_order_(blocks), definition_blocks_() {
+  const intptr_t temp_count = ComputeSSATempCount(blocks);
+  for (intptr_t i = 0; i < temp_count; ++i) {
+    definition_blocks_.Add(NULL);
+  }
+  for (intptr_t i = 0; i < blocks.length(); ++i) {
+    BlockEntryInstr* block = blocks[i];
+    JoinEntryInstr* join = block->AsJoinEntry();
+    if ((join != NULL) && (join->phis() != NULL)) {
+      for (intptr_t j = 0; j < join->phis()->length(); ++j) {
+        PhiInstr* phi = (*join->phis())[j];
+        if (phi != NULL) definition_blocks_[phi->ssa_temp_index()] = join;
+      }
+    }
+    for (Instruction* instr = block->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      if (instr->IsBind()) {
+        definition_blocks_[instr->AsBind()->ssa_temp_index()] = block;
+      }
+    }
+  }
+}
+
+
+void LICM::Optimize() {
+  // Inner loops follow their enclosing loops in reverse postorder. They are
+  // optimized first so that the instructions moved out of them can be moved
+  // further out.
+  for (intptr_t i = block_order_.length() - 1; i >= 0; --i) {
+    JoinEntryInstr* header = block_order_[i]->AsJoinEntry();
+    if (header == NULL) continue;
+    BitVector* loop = ComputeLoop(header);
+    if (loop != NULL) OptimizeLoop(header, loop);
+  }
+}
+
+
+// Returns the blocks of the loop with the given header, indexed by preorder
+// number, or NULL if the block is not a loop header.
+BitVector* LICM::ComputeLoop(JoinEntryInstr* header) {
+  BitVector* loop = NULL;
+  GrowableArray<BlockEntryInstr*> worklist;
+  for (intptr_t i = 0; i < header->PredecessorCount(); ++i) {
+    BlockEntryInstr* pred = header->PredecessorAt(i);
+    if (!Dominates(header, pred)) continue;
+    // A back edge, add the blocks reaching it without passing the header.
+    if (loop == NULL) {
+      loop = new BitVector(block_order_.length());
+      loop->Add(header->preorder_number());
+    }
+    worklist.Add(pred);
+    while (!worklist.is_empty()) {
+      BlockEntryInstr* block = worklist.Last();
+      worklist.RemoveLast();
+      if (loop->Contains(block->preorder_number())) continue;
+      loop->Add(block->preorder_number());
+      for (intptr_t j = 0; j < block->PredecessorCount(); ++j) {
+        worklist.Add(block->PredecessorAt(j));
+      }
+    }
+  }
+  return loop;
+}
+
+
+// Returns true if the computation can be executed before the loop. Loads in
+// other blocks than the header may be guarded by a test of their receiver.
+static bool IsLoopInvariantCandidate(Computation* comp,
+                                     bool in_header,
+                                     bool loop_has_side_effects) {
+  switch (comp->computation_type()) {
+    case Computation::kConstant:
+    case Computation::kStrictCompare:
+    case Computation::kBooleanNegate:
+      return true;
+    case Computation::kLoadStaticField:
+      return !loop_has_side_effects;
+    case Computation::kLoadInstanceField:
+    case Computation::kLoadVMField:
+      // Loads with class checks can deoptimize.
+      return in_header && !loop_has_side_effects && !comp->HasICData();
+    default:
+      return false;
+  }
+}
+
+
+void LICM::OptimizeLoop(JoinEntryInstr* header, BitVector* loop) {
+  // Instructions are moved to the only predecessor outside of the loop.
+  BlockEntryInstr* pre_header = NULL;
+  for (intptr_t i = 0; i < header->PredecessorCount(); ++i) {
+    BlockEntryInstr* pred = header->PredecessorAt(i);
+    if (loop->Contains(pred->preorder_number())) continue;
+    if (pre_header != NULL) return;
+    pre_header = pred;
+  }
+  if (pre_header == NULL) return;
+  ASSERT(pre_header->last_instruction()->StraightLineSuccessor() == header);
+
+  bool loop_has_side_effects = false;
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    BlockEntryInstr* block = block_order_[i];
+    if (!loop->Contains(block->preorder_number())) continue;
+    for (Instruction* instr = block->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      Computation* comp = ComputationOf(instr);
+      if ((comp != NULL) && HasSideEffects(comp)) {
+        loop_has_side_effects = true;
+      }
+    }
+  }
+
+  // In reverse postorder the definitions in the loop are visited before
+  // their uses, except for the inputs of phis.
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    BlockEntryInstr* block = block_order_[i];
+    if (!loop->Contains(block->preorder_number())) continue;
+    Instruction* prev = block;
+    Instruction* instr = block->StraightLineSuccessor();
+    while ((instr != NULL) && !instr->IsBlockEntry()) {
+      Instruction* next = instr->StraightLineSuccessor();
+      BindInstr* bind = instr->AsBind();
+      bool is_invariant = (bind != NULL) &&
+          IsLoopInvariantCandidate(bind->computation(),
+                                   block == header,
+                                   loop_has_side_effects);
+      for (intptr_t j = 0; is_invariant && (j < instr->InputCount()); ++j) {
+        Value* input = instr->InputAt(j);
+        if (input->IsUse()) {
+          const intptr_t index =
+              input->AsUse()->definition()->ssa_temp_index();
+          is_invariant = (index >= 0) &&
+              (definition_blocks_[index] != NULL) &&
+              !loop->Contains(definition_blocks_[index]->preorder_number());
+        }
+      }
+      if (is_invariant) {
+        RemoveInstruction(block, prev, instr);
+        Instruction* last = pre_header->last_instruction();
+        instr->SetSuccessor(last->StraightLineSuccessor());
+        last->SetSuccessor(instr);
+        pre_header->set_last_instruction(instr);
+        definition_blocks_[bind->ssa_temp_index()] = pre_header;
+      } else {
+        prev = instr;
+      }
+      instr = next;
+    }
+  }
+}
+
+
+DeadCodeElimination::DeadCodeElimination(
+    const GrowableArray<BlockEntryInstr*>& blocks)
+    : block_order_(blocks),
+      smi_definitions_(),
+      live_(NULL),
+      worklist_() {
+}
+
+
+void DeadCodeElimination::Optimize() {
+  const intptr_t temp_count = ComputeSSATempCount(block_order_);
+  if (temp_count == 0) return;
+  live_ = new BitVector(temp_count);
+  ComputeSmiDefinitions(temp_count);
+
+  // Instructions which cannot be removed keep their inputs alive.
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    BlockEntryInstr* block = block_order_[i];
+    for (Instruction* instr = block->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      if (instr->IsBind() && IsRemovable(instr->AsBind()->computation())) {
+        continue;
+      }
+      for (intptr_t j = 0; j < instr->InputCount(); ++j) {
+        MarkLive(instr->InputAt(j));
+      }
+    }
+  }
+  while (!worklist_.is_empty()) {
+    Definition* definition = worklist_.Last();
+    worklist_.RemoveLast();
+    for (intptr_t i = 0; i < definition->InputCount(); ++i) {
+      MarkLive(definition->InputAt(i));
+    }
+  }
+
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    BlockEntryInstr* block = block_order_[i];
+    JoinEntryInstr* join = block->AsJoinEntry();
+    if ((join != NULL) && (join->phis() != NULL)) {
+      for (intptr_t j = 0; j < join->phis()->length(); ++j) {
+        PhiInstr* phi = (*join->phis())[j];
+        if ((phi != NULL) && !live_->Contains(phi->ssa_temp_index())) {
+          join->RemovePhi(j);
+        }
+      }
+    }
+    Instruction* prev = block;
+    Instruction* instr = block->StraightLineSuccessor();
+    while ((instr != NULL) && !instr->IsBlockEntry()) {
+      Instruction* next = instr->StraightLineSuccessor();
+      BindInstr* bind = instr->AsBind();
+      if ((bind != NULL) &&
+          !live_->Contains(bind->ssa_temp_index()) &&
+          IsRemovable(bind->computation())) {
+        RemoveInstruction(block, prev, instr);
+      } else {
+        prev = instr;
+      }
+      instr = next;
+    }
+  }
+}
+
+
+void DeadCodeElimination::MarkLive(Value* value) {
+  if ((value == NULL) || !value->IsUse()) return;
+  Definition* definition = value->AsUse()->definition();
+  const intptr_t index = definition->ssa_temp_index();
+  if ((index >= 0) && !live_->Contains(index)) {
+    live_->Add(index);
+    worklist_.Add(definition);
+  }
+}
+
+
+static bool IsSmiBinaryOp(Computation* comp) {
+  if (!comp->IsBinaryOp() ||
+      (comp->AsBinaryOp()->operands_type() != BinaryOpComp::kSmiOperands)) {
+    return false;
+  }
+  switch (comp->AsBinaryOp()->op_kind()) {
+    case Token::kADD:
+    case Token::kSUB:
+    case Token::kMUL:
+    case Token::kBIT_AND:
+    case Token::kBIT_OR:
+    case Token::kBIT_XOR:
+    case Token::kTRUNCDIV:
+    case Token::kSHR:
+    case Token::kSHL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+// The operations on Smis deoptimize unless their result is a Smi. Starting
+// from the assumption that all phis are Smis, the phis with inputs which are
+// not known to be Smis are removed until nothing changes.
+void DeadCodeElimination::ComputeSmiDefinitions(intptr_t temp_count) {
+  for (intptr_t i = 0; i < temp_count; ++i) {
+    smi_definitions_.Add(false);
+  }
+  GrowableArray<PhiInstr*> phis;
+  for (intptr_t i = 0; i < block_order_.length(); ++i) {
+    BlockEntryInstr* block = block_order_[i];
+    JoinEntryInstr* join = block->AsJoinEntry();
+    if ((join != NULL) && (join->phis() != NULL)) {
+      for (intptr_t j = 0; j < join->phis()->length(); ++j) {
+        PhiInstr* phi = (*join->phis())[j];
+        if (phi != NULL) {
+          smi_definitions_[phi->ssa_temp_index()] = true;
+          phis.Add(phi);
+        }
+      }
+    }
+    for (Instruction* instr = block->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      if (!instr->IsBind()) continue;
+      Computation* comp = instr->AsBind()->computation();
+      if (IsSmiBinaryOp(comp) ||
+          comp->IsUnarySmiOp() ||
+          (comp->IsConstant() && comp->AsConstant()->value().IsSmi())) {
+        smi_definitions_[instr->AsBind()->ssa_temp_index()] = true;
+      }
+    }
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (intptr_t i = 0; i < phis.length(); ++i) {
+      PhiInstr* phi = phis[i];
+      if (!smi_definitions_[phi->ssa_temp_index()]) continue;
+      for (intptr_t j = 0; j < phi->InputCount(); ++j) {
+        if ((phi->InputAt(j) == NULL) || !IsSmiValue(phi->InputAt(j))) {
+          smi_definitions_[phi->ssa_temp_index()] = false;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+}
+
+
+bool DeadCodeElimination::IsSmiValue(Value* value) const {
+  if (value->IsConstant()) {
+    return value->AsConstant()->value().IsSmi();
+  }
+  const intptr_t index = value->AsUse()->definition()->ssa_temp_index();
+  return (index >= 0) && smi_definitions_[index];
+}
+
+
+// Returns true if the computation has no effect besides its value. Besides
+// side effects this excludes computations which may throw, or deoptimize
+// and then call other code.
+bool DeadCodeElimination::IsRemovable(Computation* comp) const {
+  switch (comp->computation_type()) {
+    case Computation::kUse:
+    case Computation::kConstant:
+    case Computation::kCurrentContext:
+    case Computation::kStrictCompare:
+    case Computation::kBooleanNegate:
+    case Computation::kLoadStaticField:
+    case Computation::kCreateClosure:
+    case Computation::kAllocateObject:
+      return true;
+    case Computation::kLoadInstanceField:
+    case Computation::kLoadVMField:
+      return !comp->HasICData();
+    case Computation::kBinaryOp:
+      // Operations on Smis which can only deoptimize on overflow.
+      switch (comp->AsBinaryOp()->op_kind()) {
+        case Token::kADD:
+        case Token::kSUB:
+        case Token::kMUL:
+        case Token::kBIT_AND:
+        case Token::kBIT_OR:
+        case Token::kBIT_XOR:
+          return IsSmiBinaryOp(comp) &&
+              IsSmiValue(comp->InputAt(0)) &&
+              IsSmiValue(comp->InputAt(1));
+        default:
+          return false;
+      }
+    default:
+      return false;
+  }
+}
+
 }  // namespace dart
@@ -5,6 +5,7 @@
 #ifndef VM_FLOW_GRAPH_OPTIMIZER_H_
 #define VM_FLOW_GRAPH_OPTIMIZER_H_
 
+#include "vm/bit_vector.h"
 #include "vm/intermediate_language.h"
 
 namespace dart {
@@ -19,6 +20,10 @@ class FlowGraphOptimizer : public FlowGraphVisitor {
 
   void ApplyICData();
 
+  // Returns a copy of the unary checks of ic_data, Smi first and the other
+  // classes by decreasing count.
+  static RawICData* SortByCount(const ICData& ic_data);
+
   virtual void VisitStaticCall(StaticCallComp* comp);
   virtual void VisitInstanceCall(InstanceCallComp* comp);
   virtual void VisitInstanceSetter(InstanceSetterComp* comp);
@@ -43,9 +48,158 @@ class FlowGraphOptimizer : public FlowGraphVisitor {
 
   bool TryInlineInstanceMethod(InstanceCallComp* comp);
 
+  bool TryInlineFieldReturningMethod(InstanceCallComp* comp);
+  bool TryInlineConstantReturningFunction(StaticCallComp* comp);
+
   DISALLOW_COPY_AND_ASSIGN(FlowGraphOptimizer);
 };
 
+
+// The passes below operate on the SSA form built with --use_ssa. They expect
+// the blocks in reverse postorder, starting with the graph entry, with their
+// predecessors and dominators computed.
+
+// Sparse conditional constant propagation (Wegman and Zadeck). Definitions
+// are only evaluated in reachable blocks and a branch on a constant makes
+// only one of its successors reachable, so that the inputs of phis flowing
+// in from unreachable predecessors are ignored. Definitions found to be
+// constant are replaced by the constant and their uses refer to the constant
+// directly.
+class ConstantPropagator : public ValueObject {
+ public:
+  explicit ConstantPropagator(const GrowableArray<BlockEntryInstr*>& blocks);
+
+  void Optimize();
+
+ private:
+  void SetReachable(BlockEntryInstr* block);
+  void VisitBlock(BlockEntryInstr* block);
+  void VisitInstruction(Instruction* instr);
+  void VisitPhi(JoinEntryInstr* join, PhiInstr* phi);
+  void SetValue(Definition* definition, const Object* value);
+
+  const Object* ValueOf(Value* value) const;
+  const Object* Meet(const Object* left, const Object* right) const;
+  const Object* Evaluate(Computation* comp) const;
+  const Object* EvaluateComparison(Token::Kind kind,
+                                   const Object& left,
+                                   const Object& right) const;
+  const Object* EvaluateBinaryOp(BinaryOpComp* comp,
+                                 const Object& left,
+                                 const Object& right) const;
+
+  bool IsUnknown(const Object* value) const { return value == NULL; }
+  bool IsNonConstant(const Object* value) const {
+    return value == &non_constant_;
+  }
+  bool IsConstant(const Object* value) const {
+    return !IsUnknown(value) && !IsNonConstant(value);
+  }
+
+  void AddUses(BlockEntryInstr* block, Instruction* instr);
+  void Transform();
+  void ReplaceConstantInputs(Instruction* instr);
+
+  const GrowableArray<BlockEntryInstr*>& block_order_;
+
+  // Marks the lattice value of definitions which are not constant, the
+  // value of definitions not evaluated yet is NULL.
+  const Object& non_constant_;
+
+  // The lattice values of the definitions, indexed by SSA temporary index.
+  GrowableArray<const Object*> values_;
+
+  // The instructions using each definition, indexed by SSA temporary index.
+  GrowableArray<ZoneGrowableArray<Instruction*>*> uses_;
+
+  // The block of each instruction, indexed by cid.
+  GrowableArray<BlockEntryInstr*> instruction_blocks_;
+
+  // Reachable blocks, indexed by preorder number.
+  BitVector* reachable_;
+
+  GrowableArray<BlockEntryInstr*> block_worklist_;
+  GrowableArray<Definition*> definition_worklist_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConstantPropagator);
+};
+
+
+// Replaces computations by an equivalent computation which dominates them.
+// Loads are only reused while no instruction with side effects can have
+// executed in between, i.e. not across joins.
+class DominatorBasedCSE : public ValueObject {
+ public:
+  explicit DominatorBasedCSE(const GrowableArray<BlockEntryInstr*>& blocks);
+
+  void Optimize();
+
+ private:
+  void OptimizeRecursive(BlockEntryInstr* block,
+                         GrowableArray<BindInstr*>* available);
+  void ReplaceInputs(Instruction* instr);
+
+  const GrowableArray<BlockEntryInstr*>& block_order_;
+
+  // The definition replacing each eliminated definition, indexed by SSA
+  // temporary index.
+  GrowableArray<Definition*> replacements_;
+
+  DISALLOW_COPY_AND_ASSIGN(DominatorBasedCSE);
+};
+
+
+// Loop invariant code motion. Moves computations whose inputs are defined
+// outside of a loop to the end of the block preceding the loop header.
+// Field and length loads are only moved out of loops without side effects.
+// Computations which can deoptimize are never moved, deoptimization has to
+// resume at their original position.
+class LICM : public ValueObject {
+ public:
+  explicit LICM(const GrowableArray<BlockEntryInstr*>& blocks);
+
+  void Optimize();
+
+ private:
+  BitVector* ComputeLoop(JoinEntryInstr* header);
+  void OptimizeLoop(JoinEntryInstr* header, BitVector* loop);
+
+  const GrowableArray<BlockEntryInstr*>& block_order_;
+
+  // The block defining each definition, indexed by SSA temporary index.
+  GrowableArray<BlockEntryInstr*> definition_blocks_;
+
+  DISALLOW_COPY_AND_ASSIGN(LICM);
+};
+
+
+// Removes definitions and phis whose values are not used by instructions
+// with side effects, directly or through other definitions.
+class DeadCodeElimination : public ValueObject {
+ public:
+  explicit DeadCodeElimination(
+      const GrowableArray<BlockEntryInstr*>& blocks);
+
+  void Optimize();
+
+ private:
+  void ComputeSmiDefinitions(intptr_t temp_count);
+  bool IsSmiValue(Value* value) const;
+  bool IsRemovable(Computation* comp) const;
+  void MarkLive(Value* value);
+
+  const GrowableArray<BlockEntryInstr*>& block_order_;
+
+  // Definitions whose value is always a Smi, indexed by SSA temporary index.
+  GrowableArray<bool> smi_definitions_;
+
+  // Definitions used by live instructions, indexed by SSA temporary index.
+  BitVector* live_;
+  GrowableArray<Definition*> worklist_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeadCodeElimination);
+};
+
 }  // namespace dart
 
 #endif  // VM_FLOW_GRAPH_OPTIMIZER_H_
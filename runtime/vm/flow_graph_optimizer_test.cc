@@ -0,0 +1,526 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/flow_graph_optimizer.h"
+
+#include "vm/class_finalizer.h"
+#include "vm/compiler.h"
+#include "vm/dart_api_impl.h"
+#include "vm/flow_graph_builder.h"
+#include "vm/longjump.h"
+#include "vm/object.h"
+#include "vm/object_store.h"
+#include "vm/parser.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+DECLARE_FLAG(int, inlining_max_tokens);
+DECLARE_FLAG(bool, use_ssa);
+
+static RawFunction* GetOptimizerTestTarget(const char* name) {
+  const String& function_name = String::Handle(String::NewSymbol(name));
+  const bool is_static = false;
+  const bool is_const = false;
+  return Function::New(function_name,
+                       RawFunction::kFunction,
+                       is_static,
+                       is_const,
+                       0);
+}
+
+
+TEST_CASE(SortByCount) {
+  const Function& function =
+      Function::Handle(GetOptimizerTestTarget("caller"));
+  const Function& target = Function::Handle(GetOptimizerTestTarget("foo"));
+  const String& target_name = String::Handle(String::New("foo"));
+  const ICData& ic_data =
+      ICData::Handle(ICData::New(function, target_name, 1, 1));
+  ic_data.AddReceiverCheck(kDouble, target, 5);
+  ic_data.AddReceiverCheck(kOneByteString, target, 20);
+  ic_data.AddReceiverCheck(kSmi, target, 1);
+  ic_data.AddReceiverCheck(kMint, target, 20);
+  ic_data.AddReceiverCheck(kBigint, target, 30);
+
+  // Smi first, then decreasing counts. Equal counts keep their order.
+  const ICData& sorted =
+      ICData::Handle(FlowGraphOptimizer::SortByCount(ic_data));
+  EXPECT_EQ(5, sorted.NumberOfChecks());
+  EXPECT_EQ(kSmi, sorted.GetReceiverClassIdAt(0));
+  EXPECT_EQ(1, sorted.GetCountAt(0));
+  EXPECT_EQ(kBigint, sorted.GetReceiverClassIdAt(1));
+  EXPECT_EQ(30, sorted.GetCountAt(1));
+  EXPECT_EQ(kOneByteString, sorted.GetReceiverClassIdAt(2));
+  EXPECT_EQ(kMint, sorted.GetReceiverClassIdAt(3));
+  EXPECT_EQ(kDouble, sorted.GetReceiverClassIdAt(4));
+  EXPECT_EQ(5, sorted.GetCountAt(4));
+
+  // Without a Smi check the most frequent class is first.
+  const ICData& no_smi =
+      ICData::Handle(ICData::New(function, target_name, 2, 1));
+  no_smi.AddReceiverCheck(kDouble, target, 2);
+  no_smi.AddReceiverCheck(kMint, target, 7);
+  const ICData& sorted_no_smi =
+      ICData::Handle(FlowGraphOptimizer::SortByCount(no_smi));
+  EXPECT_EQ(2, sorted_no_smi.NumberOfChecks());
+  EXPECT_EQ(kMint, sorted_no_smi.GetReceiverClassIdAt(0));
+  EXPECT_EQ(kDouble, sorted_no_smi.GetReceiverClassIdAt(1));
+}
+
+
+// Returns the type feedback of the unoptimized code indexed by computation
+// id, like the optimizing compiler extracts it.
+static RawArray* ExtractTestTypeFeedback(const Code& code) {
+  GrowableArray<intptr_t> computation_ids;
+  const GrowableObjectArray& ic_data_objs =
+      GrowableObjectArray::Handle(GrowableObjectArray::New());
+  const intptr_t max_id =
+      code.ExtractIcDataArraysAtCalls(&computation_ids, ic_data_objs);
+  const Array& result = Array::Handle(Array::New(max_id + 1));
+  for (intptr_t i = 0; i < computation_ids.length(); i++) {
+    result.SetAt(computation_ids[i], Object::Handle(ic_data_objs.At(i)));
+  }
+  return result.raw();
+}
+
+
+// Builds the SSA form of the optimized graph of the top level function
+// 'name' of the test library, with the blocks in reverse postorder. If the
+// function has run, the type feedback it collected is applied to the graph.
+// The SSA form does not support parameters yet. Returns false if the graph
+// builder bailed out.
+static bool BuildTestSSAGraph(Dart_Handle lib,
+                              const char* name,
+                              GrowableArray<BlockEntryInstr*>* block_order) {
+  EXPECT(ClassFinalizer::FinalizePendingClasses());
+  Library& library = Library::Handle();
+  library ^= Api::UnwrapHandle(lib);
+  const Function& function = Function::ZoneHandle(
+      library.LookupLocalFunction(String::Handle(String::NewSymbol(name))));
+  EXPECT(!function.IsNull());
+
+  Isolate* isolate = Isolate::Current();
+  const bool saved_use_ssa = FLAG_use_ssa;
+  FLAG_use_ssa = true;
+  // The passes size their tables by the computation id, it is left as the
+  // graph builder leaves it.
+  isolate->set_computation_id(0);
+  LongJump* base = isolate->long_jump_base();
+  LongJump jump;
+  isolate->set_long_jump_base(&jump);
+  bool is_built = false;
+  if (setjmp(*jump.Set()) == 0) {
+    if (function.HasCode()) {
+      isolate->set_ic_data_array(ExtractTestTypeFeedback(
+          Code::Handle(function.unoptimized_code())));
+    }
+    ParsedFunction parsed_function(function);
+    Parser::ParseFunction(&parsed_function);
+    parsed_function.AllocateVariables();
+    FlowGraphBuilder builder(parsed_function);
+    builder.BuildGraph(true);
+    const GrowableArray<BlockEntryInstr*>& postorder =
+        builder.postorder_block_entries();
+    for (intptr_t i = postorder.length() - 1; i >= 0; --i) {
+      block_order->Add(postorder[i]);
+    }
+    if (function.HasCode()) {
+      FlowGraphOptimizer optimizer(*block_order);
+      optimizer.ApplyICData();
+    }
+    is_built = true;
+  } else {
+    isolate->object_store()->clear_sticky_error();
+  }
+  isolate->set_ic_data_array(Array::null());
+  isolate->set_long_jump_base(base);
+  FLAG_use_ssa = saved_use_ssa;
+  return is_built;
+}
+
+
+TEST_CASE(SSACatchEntryBailout) {
+  // The blocks of catch entries are not renamed.
+  const char* kScriptChars =
+      "foo() { }\n"
+      "catcher() {\n"
+      "  try {\n"
+      "    foo();\n"
+      "  } catch (var e) {\n"
+      "    return 1;\n"
+      "  }\n"
+      "  return 0;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  GrowableArray<BlockEntryInstr*> blocks;
+  EXPECT(!BuildTestSSAGraph(lib, "catcher", &blocks));
+}
+
+
+// Returns the number of computations of the given type in the block.
+static intptr_t CountComputations(BlockEntryInstr* block,
+                                  Computation::ComputationType type) {
+  intptr_t count = 0;
+  for (Instruction* instr = block->StraightLineSuccessor();
+       (instr != NULL) && !instr->IsBlockEntry();
+       instr = instr->StraightLineSuccessor()) {
+    Computation* comp = NULL;
+    if (instr->IsBind()) comp = instr->AsBind()->computation();
+    if (instr->IsDo()) comp = instr->AsDo()->computation();
+    if ((comp != NULL) && (comp->computation_type() == type)) count++;
+  }
+  return count;
+}
+
+
+static intptr_t CountComputations(
+    const GrowableArray<BlockEntryInstr*>& blocks,
+    Computation::ComputationType type) {
+  intptr_t count = 0;
+  for (intptr_t i = 0; i < blocks.length(); ++i) {
+    count += CountComputations(blocks[i], type);
+  }
+  return count;
+}
+
+
+// Returns the first bind of a computation of the given type.
+static BindInstr* FindBind(const GrowableArray<BlockEntryInstr*>& blocks,
+                           Computation::ComputationType type) {
+  for (intptr_t i = 0; i < blocks.length(); ++i) {
+    for (Instruction* instr = blocks[i]->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      BindInstr* bind = instr->AsBind();
+      if ((bind != NULL) && (bind->computation()->computation_type() == type)) {
+        return bind;
+      }
+    }
+  }
+  return NULL;
+}
+
+
+static ReturnInstr* FindReturn(const GrowableArray<BlockEntryInstr*>& blocks) {
+  for (intptr_t i = 0; i < blocks.length(); ++i) {
+    for (Instruction* instr = blocks[i]->StraightLineSuccessor();
+         (instr != NULL) && !instr->IsBlockEntry();
+         instr = instr->StraightLineSuccessor()) {
+      if (instr->IsReturn()) return instr->AsReturn();
+    }
+  }
+  return NULL;
+}
+
+
+TEST_CASE(ConstantPropagation) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static var f;\n"
+      "}\n"
+      "constant() {\n"
+      "  var a = 1;\n"
+      "  var c = 10;\n"
+      "  if (a < 2) {\n"
+      "    c = 20;\n"
+      "  }\n"
+      "  return c;\n"
+      "}\n"
+      "notConstant() {\n"
+      "  var c = 10;\n"
+      "  if (A.f === null) {\n"
+      "    c = 20;\n"
+      "  }\n"
+      "  return c;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+
+  // The comparison is constant, the other branch is never taken and the
+  // phi only merges the value flowing in from the taken branch.
+  GrowableArray<BlockEntryInstr*> blocks;
+  EXPECT(BuildTestSSAGraph(lib, "constant", &blocks));
+  ReturnInstr* ret = FindReturn(blocks);
+  EXPECT(ret->value()->IsUse());
+  ConstantPropagator propagator(blocks);
+  propagator.Optimize();
+  EXPECT(ret->value()->IsConstant());
+  EXPECT(ret->value()->AsConstant()->value().raw() == Smi::New(20));
+  EXPECT_EQ(0, CountComputations(blocks, Computation::kRelationalOp));
+
+  GrowableArray<BlockEntryInstr*> other_blocks;
+  EXPECT(BuildTestSSAGraph(lib, "notConstant", &other_blocks));
+  ConstantPropagator other_propagator(other_blocks);
+  other_propagator.Optimize();
+  EXPECT(FindReturn(other_blocks)->value()->IsUse());
+  EXPECT_EQ(1, CountComputations(other_blocks, Computation::kStrictCompare));
+}
+
+
+TEST_CASE(CommonSubexpressionElimination) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static var f;\n"
+      "}\n"
+      "foo() { }\n"
+      "cse() {\n"
+      "  var x = A.f;\n"
+      "  var y = A.f;\n"
+      "  foo();\n"
+      "  var z = A.f;\n"
+      "  return (x === y) === z;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  GrowableArray<BlockEntryInstr*> blocks;
+  EXPECT(BuildTestSSAGraph(lib, "cse", &blocks));
+  EXPECT_EQ(3, CountComputations(blocks, Computation::kLoadStaticField));
+  DominatorBasedCSE cse(blocks);
+  cse.Optimize();
+  // The load after the call is kept, the call may store to the field.
+  EXPECT_EQ(2, CountComputations(blocks, Computation::kLoadStaticField));
+  BindInstr* compare = FindBind(blocks, Computation::kStrictCompare);
+  EXPECT(compare->computation()->InputAt(0)->IsUse());
+  EXPECT(compare->computation()->InputAt(1)->IsUse());
+  EXPECT(compare->computation()->InputAt(0)->AsUse()->definition() ==
+         compare->computation()->InputAt(1)->AsUse()->definition());
+}
+
+
+TEST_CASE(LoopInvariantCodeMotion) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static var f;\n"
+      "  static var g;\n"
+      "}\n"
+      "licm() {\n"
+      "  var a = A.f;\n"
+      "  var b = A.g;\n"
+      "  var i = 0;\n"
+      "  var r;\n"
+      "  while (i < 10) {\n"
+      "    var c = A.g;\n"
+      "    r = a === b;\n"
+      "    r = a === i;\n"
+      "    i = i + 1;\n"
+      "  }\n"
+      "  return r;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  GrowableArray<BlockEntryInstr*> blocks;
+  EXPECT(BuildTestSSAGraph(lib, "licm", &blocks));
+  // The graph entry is followed by the block preceding the loop.
+  BlockEntryInstr* pre_header = blocks[1];
+  BlockEntryInstr* body = NULL;
+  for (intptr_t i = 0; i < blocks.length(); ++i) {
+    if (CountComputations(blocks[i], Computation::kInstanceCall) > 0) {
+      body = blocks[i];
+    }
+  }
+  EXPECT(body != NULL);
+  EXPECT_EQ(0, CountComputations(pre_header, Computation::kStrictCompare));
+  EXPECT_EQ(2, CountComputations(body, Computation::kStrictCompare));
+
+  LICM licm(blocks);
+  licm.Optimize();
+  // Only the comparison of values defined before the loop is moved. The
+  // load is kept in the loop, the call to + may store to the field.
+  EXPECT_EQ(1, CountComputations(pre_header, Computation::kStrictCompare));
+  EXPECT_EQ(1, CountComputations(body, Computation::kStrictCompare));
+  EXPECT_EQ(1, CountComputations(body, Computation::kLoadStaticField));
+  EXPECT_EQ(0, CountComputations(body, Computation::kConstant));
+}
+
+
+TEST_CASE(DeadCodeElimination) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static var f;\n"
+      "}\n"
+      "foo() { }\n"
+      "dce() {\n"
+      "  var a = A.f;\n"
+      "  var b = a === null;\n"
+      "  foo();\n"
+      "  return 1;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  GrowableArray<BlockEntryInstr*> blocks;
+  EXPECT(BuildTestSSAGraph(lib, "dce", &blocks));
+  DeadCodeElimination dce(blocks);
+  dce.Optimize();
+  EXPECT_EQ(0, CountComputations(blocks, Computation::kLoadStaticField));
+  EXPECT_EQ(0, CountComputations(blocks, Computation::kStrictCompare));
+  EXPECT_EQ(1, CountComputations(blocks, Computation::kStaticCall));
+  EXPECT(FindReturn(blocks)->value()->IsUse());
+}
+
+
+TEST_CASE(InlineSmallFunctions) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  A(x) : f = x;\n"
+      "  var f;\n"
+      "  getF() { return this.f; }\n"
+      "  getFPlusOne() { return f + 1; }\n"
+      "  static one() { return 1; }\n"
+      "  static two() { var x = 2; return x; }\n"
+      "  static three() { return 3; }\n"
+      "}\n"
+      "class B {\n"
+      "  B(x) : g = x;\n"
+      "  var g;\n"
+      "  getF() { return this.g; }\n"
+      "}\n"
+      "inlined() {\n"
+      "  var a = new A(2);\n"
+      "  return a.getF() === A.one();\n"
+      "}\n"
+      "notInlined() {\n"
+      "  var a = new A(2);\n"
+      "  var r = a.getFPlusOne() === A.two();\n"
+      "  if (r === null) {\n"
+      "    A.three();\n"
+      "  }\n"
+      "  return r;\n"
+      "}\n"
+      "polymorphic() {\n"
+      "  var o = new A(1);\n"
+      "  var r;\n"
+      "  for (var i = 0; i < 2; i++) {\n"
+      "    r = o.getF();\n"
+      "    o = new B(2);\n"
+      "  }\n"
+      "  return r;\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("inlined"), 0, NULL));
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("notInlined"), 0, NULL));
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("polymorphic"), 0, NULL));
+
+  // 'return this.f;' becomes a load of the field guarded by the class check
+  // of the call, 'return 1;' becomes the constant.
+  GrowableArray<BlockEntryInstr*> blocks;
+  EXPECT(BuildTestSSAGraph(lib, "inlined", &blocks));
+  EXPECT_EQ(0, CountComputations(blocks, Computation::kInstanceCall));
+  // Only the constructor is called.
+  EXPECT_EQ(1, CountComputations(blocks, Computation::kStaticCall));
+  BindInstr* load = FindBind(blocks, Computation::kLoadInstanceField);
+  EXPECT(load != NULL);
+  if (load != NULL) {
+    EXPECT(load->computation()->HasICData());
+  }
+  BindInstr* compare = FindBind(blocks, Computation::kStrictCompare);
+  EXPECT(compare != NULL);
+  if (compare != NULL) {
+    Value* right = compare->computation()->InputAt(1);
+    EXPECT(right->IsUse());
+    BindInstr* constant = right->AsUse()->definition()->AsBind();
+    EXPECT(constant->computation()->IsConstant());
+    EXPECT(constant->computation()->AsConstant()->value().raw() ==
+           Smi::New(1));
+  }
+
+  // Other bodies than a single return of a field or literal, and functions
+  // which never ran, are not inlined.
+  GrowableArray<BlockEntryInstr*> other_blocks;
+  EXPECT(BuildTestSSAGraph(lib, "notInlined", &other_blocks));
+  EXPECT_EQ(0, CountComputations(other_blocks,
+                                 Computation::kLoadInstanceField));
+  EXPECT_EQ(1, CountComputations(other_blocks, Computation::kInstanceCall) +
+               CountComputations(other_blocks,
+                                 Computation::kPolymorphicInstanceCall));
+  EXPECT_EQ(3, CountComputations(other_blocks, Computation::kStaticCall));
+
+  // Receivers of different classes have different targets.
+  GrowableArray<BlockEntryInstr*> polymorphic_blocks;
+  EXPECT(BuildTestSSAGraph(lib, "polymorphic", &polymorphic_blocks));
+  EXPECT_EQ(0, CountComputations(polymorphic_blocks,
+                                 Computation::kLoadInstanceField));
+  EXPECT_EQ(1, CountComputations(polymorphic_blocks,
+                                 Computation::kPolymorphicInstanceCall));
+
+  // Functions with more tokens than the budget are not inlined.
+  const intptr_t saved_max_tokens = FLAG_inlining_max_tokens;
+  FLAG_inlining_max_tokens = 2;
+  GrowableArray<BlockEntryInstr*> budget_blocks;
+  EXPECT(BuildTestSSAGraph(lib, "inlined", &budget_blocks));
+  FLAG_inlining_max_tokens = saved_max_tokens;
+  EXPECT_EQ(0, CountComputations(budget_blocks,
+                                 Computation::kLoadInstanceField));
+  EXPECT_EQ(2, CountComputations(budget_blocks, Computation::kStaticCall));
+}
+
+
+// The optimized code of x64 is generated from the flow graph.
+#if defined(TARGET_ARCH_X64)
+TEST_CASE(InlinedFieldLoadDeoptimization) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  A(x) : f = x;\n"
+      "  var f;\n"
+      "  getF() { return this.f; }\n"
+      "}\n"
+      "class B extends A {\n"
+      "  B(x) : super(x);\n"
+      "  getF() { return 42; }\n"
+      "}\n"
+      "callGetF(o) { return o.getF(); }\n"
+      "makeA() { return new A(1); }\n"
+      "makeB() { return new B(1); }\n";
+  // Code is not generated from SSA yet.
+  const bool saved_use_ssa = FLAG_use_ssa;
+  FLAG_use_ssa = false;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle args[1];
+  args[0] = Dart_Invoke(lib, Dart_NewString("makeA"), 0, NULL);
+  EXPECT_VALID(args[0]);
+  for (intptr_t i = 0; i < 10; i++) {
+    EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("callGetF"), 1, args));
+  }
+
+  Library& library = Library::Handle();
+  library ^= Api::UnwrapHandle(lib);
+  const Function& caller = Function::Handle(library.LookupLocalFunction(
+      String::Handle(String::NewSymbol("callGetF"))));
+  const Class& cls =
+      Class::Handle(library.LookupClass(String::Handle(String::New("A"))));
+  const Function& getter = Function::Handle(
+      cls.LookupDynamicFunction(String::Handle(String::New("getF"))));
+  EXPECT(!caller.IsNull());
+  EXPECT(!getter.IsNull());
+  // A low optimization threshold may have optimized it already.
+  if (!caller.HasOptimizedCode()) {
+    EXPECT(Compiler::CompileOptimizedFunction(caller) == Error::null());
+  }
+  EXPECT(caller.HasOptimizedCode());
+
+  // The optimized code loads the field instead of calling the getter.
+  getter.set_usage_counter(0);
+  for (intptr_t i = 0; i < 10; i++) {
+    Dart_Handle result =
+        Dart_Invoke(lib, Dart_NewString("callGetF"), 1, args);
+    EXPECT_VALID(result);
+    int64_t value = 0;
+    EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+    EXPECT_EQ(1, value);
+  }
+  EXPECT_EQ(0, getter.usage_counter());
+  EXPECT(caller.HasOptimizedCode());
+
+  // A receiver of another class fails the class check, the call continues
+  // in the unoptimized code and calls the getter of B.
+  args[0] = Dart_Invoke(lib, Dart_NewString("makeB"), 0, NULL);
+  EXPECT_VALID(args[0]);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("callGetF"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(42, value);
+  EXPECT_EQ(1, caller.deoptimization_counter());
+  EXPECT(!caller.HasOptimizedCode());
+  FLAG_use_ssa = saved_use_ssa;
+}
+#endif  // TARGET_ARCH_X64
+
+}  // namespace dart
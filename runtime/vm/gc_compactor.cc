@@ -0,0 +1,270 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/gc_compactor.h"
+
+#include "vm/dart_api_state.h"
+#include "vm/flags.h"
+#include "vm/heap.h"
+#include "vm/isolate.h"
+#include "vm/pages.h"
+#include "vm/raw_object.h"
+#include "vm/stack_frame.h"
+#include "vm/store_buffer.h"
+#include "vm/visitor.h"
+
+namespace dart {
+
+DEFINE_FLAG(bool, compact_old_space, false,
+            "Move the live objects out of sparsely populated old generation "
+            "pages during mark-sweep.");
+DEFINE_FLAG(int, compaction_threshold, 25,
+            "Evacuate old generation pages whose live objects occupy less "
+            "than this percentage of the page.");
+
+// The header of an evacuated object is replaced by the address of its copy,
+// tagged with RawObject::kFreeBit. Free list elements are never referenced,
+// so no pointer visited by the compactor leads to an object with this bit set
+// unless the object has been moved.
+enum {
+  kForwardingMask = 1 << RawObject::kFreeBit,
+  kForwarded = kForwardingMask,
+};
+
+
+static inline bool IsForwarded(uword header) {
+  return (header & kForwardingMask) == kForwarded;
+}
+
+
+static inline uword ForwardedAddr(uword header) {
+  ASSERT(IsForwarded(header));
+  return header & ~kForwardingMask;
+}
+
+
+// Replaces pointers to evacuated objects with pointers to their copies. While
+// visiting slots in old space objects the pointers to new space objects are
+// recorded in the store buffer, or the card table of large pages.
+class CompactingVisitor : public ObjectPointerVisitor {
+ public:
+  explicit CompactingVisitor(Isolate* isolate)
+      : ObjectPointerVisitor(isolate),
+        visiting_old_object_(NULL),
+        card_page_(NULL) {}
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* raw_obj = *current;
+      if (!raw_obj->IsHeapObject()) {
+        continue;
+      }
+      if (raw_obj->IsNewObject()) {
+        if (visiting_old_object_ != NULL) {
+          RecordSlot(reinterpret_cast<uword>(current));
+        }
+        continue;
+      }
+      uword header = *reinterpret_cast<uword*>(RawObject::ToAddr(raw_obj));
+      if (IsForwarded(header)) {
+        *current = RawObject::FromAddr(ForwardedAddr(header));
+      }
+    }
+  }
+
+  // Pointers visited while this is set are slots of the given old space
+  // object, or embedded in the instructions of a code object.
+  void VisitingOldObject(RawObject* raw_obj) {
+    visiting_old_object_ = raw_obj;
+    card_page_ = NULL;
+    if (raw_obj != NULL) {
+      HeapPage* page = PageSpace::PageFor(raw_obj);
+      card_page_ = (page->card_table() != NULL) ? page : NULL;
+    }
+  }
+
+ private:
+  void RecordSlot(uword slot) {
+    if ((card_page_ != NULL) &&
+        (slot >= card_page_->first_object_start()) &&
+        (slot < card_page_->top())) {
+      card_page_->MarkCard(slot);
+    } else {
+      isolate()->store_buffer()->AddPointer(slot);
+    }
+  }
+
+  RawObject* visiting_old_object_;
+  HeapPage* card_page_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactingVisitor);
+};
+
+
+// Updates the weak persistent handles, the unreachable ones have already been
+// finalized after marking.
+class CompactingWeakVisitor : public HandleVisitor {
+ public:
+  explicit CompactingWeakVisitor(CompactingVisitor* visitor)
+      : visitor_(visitor) {}
+
+  void VisitHandle(uword addr) {
+    visitor_->VisitPointer(reinterpret_cast<RawObject**>(addr));
+  }
+
+ private:
+  CompactingVisitor* visitor_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactingWeakVisitor);
+};
+
+
+bool GCCompactor::IsEvacuationCandidate(HeapPage* page) const {
+  intptr_t threshold =
+      (PageSpace::AllocatablePageSize() / 100) * FLAG_compaction_threshold;
+  intptr_t used = page->used();
+  return (used > 0) && (used < threshold);
+}
+
+
+uword GCCompactor::AllocateCopy(intptr_t size) {
+  uword result = 0;
+  if (to_page_ != NULL) {
+    result = to_page_->TryBumpAllocate(size);
+  }
+  if (result == 0) {
+    page_space_->AllocatePage();
+    to_page_ = page_space_->pages_tail_;
+    result = to_page_->TryBumpAllocate(size);
+    ASSERT(result != 0);
+  }
+  to_page_->AddUsed(size);
+  return result;
+}
+
+
+void GCCompactor::EvacuatePage(HeapPage* page) {
+  intptr_t in_use = page->used();
+  intptr_t evacuated = 0;
+  uword current = page->first_object_start();
+  uword top = page->top();
+  while ((current < top) && (evacuated < in_use)) {
+    RawObject* raw_obj = RawObject::FromAddr(current);
+    intptr_t size = raw_obj->Size();
+    if (raw_obj->IsMarked()) {
+      // The copy keeps the mark bit, it is cleared when sweeping its page.
+      uword copy = AllocateCopy(size);
+      memmove(reinterpret_cast<void*>(copy),
+              reinterpret_cast<void*>(current),
+              size);
+      ASSERT((copy & kForwardingMask) == 0);
+      *reinterpret_cast<uword*>(current) = copy | kForwarded;
+      evacuated += size;
+    }
+    current += size;
+  }
+  ASSERT(evacuated == in_use);
+  // The page holds no live objects anymore and is released by the sweep.
+  page->set_used(0);
+}
+
+
+void GCCompactor::VisitMarkedObjects(HeapPage* page,
+                                     CompactingVisitor* visitor) {
+  intptr_t in_use = page->used();
+  intptr_t visited = 0;
+  uword current = page->first_object_start();
+  uword top = page->top();
+  while ((current < top) && (visited < in_use)) {
+    RawObject* raw_obj = RawObject::FromAddr(current);
+    intptr_t size = raw_obj->Size();
+    if (raw_obj->IsMarked()) {
+      visitor->VisitingOldObject(raw_obj);
+      raw_obj->VisitPointers(visitor);
+      visited += size;
+    }
+    current += size;
+  }
+  visitor->VisitingOldObject(NULL);
+}
+
+
+void GCCompactor::UpdatePointers(Isolate* isolate) {
+  // Slots located in evacuated objects have moved, record all of them again.
+  isolate->store_buffer()->Reset();
+  page_space_->ClearCardTables();
+
+  // The sizes of the visited objects are found through their classes, which
+  // may have moved. Their old copies stay intact until the evacuated pages
+  // are released.
+  CompactingVisitor visitor(isolate);
+
+  // Evacuated pages and pages without live objects are skipped, their used
+  // size is zero.
+  HeapPage* page = page_space_->pages_;
+  while (page != NULL) {
+    VisitMarkedObjects(page, &visitor);
+    page = page->next();
+  }
+  page = page_space_->large_pages_;
+  while (page != NULL) {
+    VisitMarkedObjects(page, &visitor);
+    page = page->next();
+  }
+  heap_->IterateNewPointers(&visitor);
+
+  // The instructions in code space only refer to old space objects, the
+  // pointers embedded in them are visited through their code objects.
+  heap_->IterateCodePointers(&visitor);
+
+  // Visiting the stack frames looks up their code objects and stack maps,
+  // the heap has to be updated before the roots.
+  isolate->VisitObjectPointers(&visitor,
+                               true,
+                               StackFrameIterator::kDontValidateFrames);
+  CompactingWeakVisitor weak_visitor(&visitor);
+  isolate->VisitWeakPersistentHandles(&weak_visitor, true);
+}
+
+
+intptr_t GCCompactor::CompactPages(Isolate* isolate) {
+  // Evacuation only pays off if the live objects of several pages fit into
+  // fewer fresh pages.
+  intptr_t num_candidates = 0;
+  intptr_t live_bytes = 0;
+  HeapPage* last_page = page_space_->pages_tail_;
+  HeapPage* page = page_space_->pages_;
+  while (page != NULL) {
+    if (IsEvacuationCandidate(page)) {
+      num_candidates++;
+      live_bytes += page->used();
+    }
+    page = page->next();
+  }
+  // Objects are not split across pages, allow for the unused page ends.
+  intptr_t num_to_pages =
+      (live_bytes / PageSpace::AllocatablePageSize()) + 2;
+  if ((num_candidates <= num_to_pages) ||
+      !page_space_->CanIncreaseCapacity(num_to_pages * PageSpace::kPageSize)) {
+    return 0;
+  }
+
+  // The fresh pages are appended to the page list, only the pages before them
+  // are evacuated.
+  page = page_space_->pages_;
+  while (true) {
+    HeapPage* next_page = page->next();
+    if (IsEvacuationCandidate(page)) {
+      EvacuatePage(page);
+    }
+    if (page == last_page) {
+      break;
+    }
+    page = next_page;
+  }
+  UpdatePointers(isolate);
+  return num_candidates;
+}
+
+}  // namespace dart
@@ -0,0 +1,53 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_GC_COMPACTOR_H_
+#define VM_GC_COMPACTOR_H_
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Forward declarations.
+class CompactingVisitor;
+class Heap;
+class HeapPage;
+class Isolate;
+class PageSpace;
+
+// The class GCCompactor is used after marking to move the live objects out of
+// sparsely populated old generation pages, so that these pages are released
+// instead of being swept into the freelist. The objects are copied to fresh
+// pages and all pointers to them are updated.
+class GCCompactor : public ValueObject {
+ public:
+  GCCompactor(Heap* heap, PageSpace* page_space)
+      : heap_(heap), page_space_(page_space), to_page_(NULL) {}
+  ~GCCompactor() {}
+
+  // Evacuate the pages whose marked objects occupy less than
+  // --compaction_threshold percent of the page. The evacuated pages are left
+  // without any used bytes. The store buffer is rebuilt. Returns the number
+  // of evacuated pages.
+  intptr_t CompactPages(Isolate* isolate);
+
+ private:
+  bool IsEvacuationCandidate(HeapPage* page) const;
+  void EvacuatePage(HeapPage* page);
+  uword AllocateCopy(intptr_t size);
+  void VisitMarkedObjects(HeapPage* page, CompactingVisitor* visitor);
+  void UpdatePointers(Isolate* isolate);
+
+  Heap* heap_;
+  PageSpace* page_space_;
+  // The fresh page the evacuated objects are currently copied to.
+  HeapPage* to_page_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(GCCompactor);
+};
+
+}  // namespace dart
+
+#endif  // VM_GC_COMPACTOR_H_
@@ -6,6 +6,7 @@
 
 #include "vm/allocation.h"
 #include "vm/dart_api_state.h"
+#include "vm/freelist.h"
 #include "vm/isolate.h"
 #include "vm/pages.h"
 #include "vm/raw_object.h"
@@ -15,7 +16,7 @@
 namespace dart {
 
 // A simple chunked marking stack.
-class MarkingStack : public ValueObject {
+class MarkingStack {
  public:
   MarkingStack()
       : head_(new MarkingStackChunk()),
@@ -124,7 +125,9 @@ class MarkingVisitor : public ObjectPointerVisitor {
         heap_(heap),
         vm_heap_(Dart::vm_isolate()->heap()),
         page_space_(page_space),
-        marking_stack_(marking_stack) {
+        marking_stack_(marking_stack),
+        visiting_old_pointers_(false),
+        card_page_(NULL) {
     ASSERT(heap_ != vm_heap_);
   }
 
@@ -132,10 +135,21 @@ class MarkingVisitor : public ObjectPointerVisitor {
 
   void VisitPointers(RawObject** first, RawObject** last) {
     for (RawObject** current = first; current <= last; current++) {
-      MarkObject(*current);
+      MarkObject(*current, current);
     }
   }
 
+  // Pointers visited while this is set are slots in old space objects. The
+  // store buffer is rebuilt from the old to new pointers found in these.
+  void VisitingOldPointers(bool value) { visiting_old_pointers_ = value; }
+
+  // Old to new pointers found in objects located on a page with a card table
+  // are recorded by marking the card instead.
+  void VisitingObject(RawObject* raw_obj) {
+    HeapPage* page = PageSpace::PageFor(raw_obj);
+    card_page_ = (page->card_table() != NULL) ? page : NULL;
+  }
+
  private:
   void MarkAndPush(RawObject* raw_obj) {
     ASSERT(raw_obj->IsHeapObject());
@@ -152,10 +166,10 @@ class MarkingVisitor : public ObjectPointerVisitor {
     page->AddUsed(raw_obj->Size());
 
     // TODO(iposva): Should we mark the classes early?
-    MarkObject(raw_class);
+    MarkObject(raw_class, NULL);
   }
 
-  void MarkObject(RawObject* raw_obj) {
+  void MarkObject(RawObject* raw_obj, RawObject** p) {
     // Fast exit if the raw object is a Smi.
     if (!raw_obj->IsHeapObject()) return;
 
@@ -165,6 +179,14 @@ class MarkingVisitor : public ObjectPointerVisitor {
     // Skip over new objects, but verify consistency of heap while at it.
     if (raw_obj->IsNewObject()) {
       // TODO(iposva): Add consistency check.
+      if (visiting_old_pointers_) {
+        ASSERT(p != NULL);
+        if (card_page_ != NULL) {
+          card_page_->MarkCard(reinterpret_cast<uword>(p));
+        } else {
+          isolate()->store_buffer()->AddPointer(reinterpret_cast<uword>(p));
+        }
+      }
       return;
     }
 
@@ -182,6 +204,8 @@ class MarkingVisitor : public ObjectPointerVisitor {
   Heap* vm_heap_;
   PageSpace* page_space_;
   MarkingStack* marking_stack_;
+  bool visiting_old_pointers_;
+  HeapPage* card_page_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(MarkingVisitor);
 };
@@ -217,10 +241,17 @@ class MarkingWeakVisitor : public HandleVisitor {
 };
 
 
-void GCMarker::Prologue(Isolate* isolate, bool invoke_api_callbacks) {
+void GCMarker::Prologue(Isolate* isolate,
+                        PageSpace* page_space,
+                        bool invoke_api_callbacks) {
   if (invoke_api_callbacks) {
     isolate->gc_prologue_callbacks().Invoke();
   }
+  // Slots recorded in the store buffer may be located in objects which are
+  // about to be swept. The store buffer and the card tables are rebuilt
+  // while marking instead.
+  isolate->store_buffer()->Reset();
+  page_space->ClearCardTables();
 }
 
 
@@ -232,13 +263,15 @@ void GCMarker::Epilogue(Isolate* isolate, bool invoke_api_callbacks) {
 
 
 void GCMarker::IterateRoots(Isolate* isolate,
-                            ObjectPointerVisitor* visitor,
+                            MarkingVisitor* visitor,
                             bool visit_prologue_weak_persistent_handles) {
   isolate->VisitObjectPointers(visitor,
                                visit_prologue_weak_persistent_handles,
                                StackFrameIterator::kDontValidateFrames);
   heap_->IterateNewPointers(visitor);
+  visitor->VisitingOldPointers(true);
   heap_->IterateCodePointers(visitor);
+  visitor->VisitingOldPointers(false);
 }
 
 
@@ -306,10 +339,13 @@ void GCMarker::IterateWeakReferences(Isolate* isolate,
 
 void GCMarker::DrainMarkingStack(Isolate* isolate,
                                  MarkingVisitor* visitor) {
+  visitor->VisitingOldPointers(true);
   while (!visitor->marking_stack()->IsEmpty()) {
     RawObject* raw_obj = visitor->marking_stack()->Pop();
+    visitor->VisitingObject(raw_obj);
     raw_obj->VisitPointers(visitor);
   }
+  visitor->VisitingOldPointers(false);
 }
 
 
@@ -317,7 +353,7 @@ void GCMarker::MarkObjects(Isolate* isolate,
                            PageSpace* page_space,
                            bool invoke_api_callbacks) {
   MarkingStack marking_stack;
-  Prologue(isolate, invoke_api_callbacks);
+  Prologue(isolate, page_space, invoke_api_callbacks);
   MarkingVisitor mark(isolate, heap_, page_space, &marking_stack);
   IterateRoots(isolate, &mark, !invoke_api_callbacks);
   DrainMarkingStack(isolate, &mark);
@@ -327,4 +363,109 @@ void GCMarker::MarkObjects(Isolate* isolate,
   Epilogue(isolate, invoke_api_callbacks);
 }
 
+
+
+IncrementalMarker::IncrementalMarker(Heap* heap, PageSpace* page_space)
+    : marker_(heap),
+      page_space_(page_space),
+      marking_stack_(new MarkingStack()),
+      visitor_(NULL),
+      allocations_(NULL),
+      allocations_length_(0),
+      allocations_capacity_(0) {
+}
+
+
+IncrementalMarker::~IncrementalMarker() {
+  // Marking may be abandoned when the isolate shuts down.
+  while (!marking_stack_->IsEmpty()) {
+    marking_stack_->Pop();
+  }
+  delete visitor_;
+  delete marking_stack_;
+  delete[] allocations_;
+}
+
+
+void IncrementalMarker::Start(Isolate* isolate) {
+  ASSERT(visitor_ == NULL);
+  visitor_ = new MarkingVisitor(isolate,
+                                marker_.heap_,
+                                page_space_,
+                                marking_stack_);
+  // The prologue weak persistent handles are only treated as roots if the
+  // final pause does not invoke the API callbacks, see Finish.
+  marker_.IterateRoots(isolate, visitor_, false);
+}
+
+
+void IncrementalMarker::RecordAllocation(uword addr, intptr_t size) {
+  if (allocations_length_ == allocations_capacity_) {
+    intptr_t new_capacity =
+        (allocations_capacity_ == 0) ? 256 : (2 * allocations_capacity_);
+    uword* new_allocations = new uword[new_capacity];
+    memmove(new_allocations,
+            allocations_,
+            allocations_length_ * sizeof(allocations_[0]));
+    delete[] allocations_;
+    allocations_ = new_allocations;
+    allocations_capacity_ = new_capacity;
+  }
+  allocations_[allocations_length_++] = addr;
+  allocations_[allocations_length_++] = size;
+}
+
+
+void IncrementalMarker::MarkAllocations() {
+  // The recorded regions are only visited once the objects in them have been
+  // initialized. A region may hold several objects, e.g. the promotion
+  // buffers of the parallel scavenger, and free list elements.
+  for (intptr_t i = 0; i < allocations_length_; i += 2) {
+    uword addr = allocations_[i];
+    uword end = addr + allocations_[i + 1];
+    while (addr < end) {
+      RawObject* raw_obj = RawObject::FromAddr(addr);
+      intptr_t size = raw_obj->Size();
+      if (raw_obj->GetClassId() != kFreeListElement) {
+        MarkObject(raw_obj);
+      }
+      addr += size;
+    }
+  }
+  allocations_length_ = 0;
+}
+
+
+void IncrementalMarker::MarkObject(RawObject* raw_obj) {
+  ASSERT(raw_obj->IsHeapObject() && raw_obj->IsOldObject());
+  if (!raw_obj->IsMarked()) {
+    visitor_->VisitPointer(&raw_obj);
+  }
+}
+
+
+bool IncrementalMarker::Step(intptr_t budget) {
+  MarkAllocations();
+  intptr_t visited = 0;
+  while ((visited < budget) && !marking_stack_->IsEmpty()) {
+    RawObject* raw_obj = marking_stack_->Pop();
+    visited += raw_obj->VisitPointers(visitor_);
+  }
+  return marking_stack_->IsEmpty();
+}
+
+
+void IncrementalMarker::Finish(Isolate* isolate, bool invoke_api_callbacks) {
+  if (invoke_api_callbacks) {
+    isolate->gc_prologue_callbacks().Invoke();
+  }
+  MarkAllocations();
+  marker_.IterateRoots(isolate, visitor_, !invoke_api_callbacks);
+  marker_.DrainMarkingStack(isolate, visitor_);
+  marker_.IterateWeakReferences(isolate, visitor_);
+  MarkingWeakVisitor mark_weak;
+  marker_.IterateWeakRoots(isolate, &mark_weak, invoke_api_callbacks);
+  marker_.Epilogue(isolate, invoke_api_callbacks);
+}
+
 }  // namespace dart
@@ -13,9 +13,11 @@ namespace dart {
 class HandleVisitor;
 class Heap;
 class Isolate;
+class MarkingStack;
 class MarkingVisitor;
 class ObjectPointerVisitor;
 class PageSpace;
+class RawObject;
 
 // The class GCMarker is used to mark reachable old generation objects as part
 // of the mark-sweep collection. The marking bit used is defined in RawObject.
@@ -29,10 +31,12 @@ class GCMarker : public ValueObject {
                    bool invoke_api_callbacks);
 
  private:
-  void Prologue(Isolate* isolate, bool invoke_api_callbacks);
+  void Prologue(Isolate* isolate,
+                PageSpace* page_space,
+                bool invoke_api_callbacks);
   void Epilogue(Isolate* isolate, bool invoke_api_callbacks);
   void IterateRoots(Isolate* isolate,
-                    ObjectPointerVisitor* visitor,
+                    MarkingVisitor* visitor,
                     bool visit_prologue_weak_persistent_handles);
   void IterateWeakRoots(Isolate* isolate,
                         HandleVisitor* visitor,
@@ -42,9 +46,55 @@ class GCMarker : public ValueObject {
 
   Heap* heap_;
 
+  friend class IncrementalMarker;
   DISALLOW_IMPLICIT_CONSTRUCTORS(GCMarker);
 };
 
+
+// The class IncrementalMarker marks the old generation in bounded steps which
+// are interleaved with the execution of the mutator.
+//
+// The write barrier marks old space objects stored into the heap while
+// marking is in progress, so that no reachable object is hidden from the
+// marker behind an object it has already visited. Objects allocated in old
+// space during marking, including promoted objects, are visited in the next
+// step. The roots are visited again in the final pause by Finish.
+class IncrementalMarker {
+ public:
+  IncrementalMarker(Heap* heap, PageSpace* page_space);
+  ~IncrementalMarker();
+
+  // Mark the objects referenced from the roots.
+  void Start(Isolate* isolate);
+
+  // Visit marked objects until about 'budget' bytes have been visited.
+  // Returns true if no unvisited marked objects are left.
+  bool Step(intptr_t budget);
+
+  // Complete the marking. Called in the pause before sweeping.
+  void Finish(Isolate* isolate, bool invoke_api_callbacks);
+
+  // Record a region of memory allocated in old space while marking.
+  void RecordAllocation(uword addr, intptr_t size);
+
+  void MarkObject(RawObject* raw_obj);
+
+ private:
+  void MarkAllocations();
+
+  GCMarker marker_;
+  PageSpace* page_space_;
+  MarkingStack* marking_stack_;
+  MarkingVisitor* visitor_;
+
+  // Start address and size pairs of the recorded allocations.
+  uword* allocations_;
+  intptr_t allocations_length_;
+  intptr_t allocations_capacity_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncrementalMarker);
+};
+
 }  // namespace dart
 
 #endif  // VM_GC_MARKER_H_
@@ -10,6 +10,40 @@
 
 namespace dart {
 
+intptr_t GCSweeper::FirstRememberedSlotAtOrAbove(uword start) const {
+  intptr_t low = 0;
+  intptr_t high = remembered_slots_length_;
+  while (low < high) {
+    intptr_t middle = low + (high - low) / 2;
+    if (remembered_slots_[middle] < start) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+
+bool GCSweeper::HasRememberedSlots(uword start, uword end) const {
+  intptr_t index = FirstRememberedSlotAtOrAbove(start);
+  return (index < remembered_slots_length_) &&
+      (remembered_slots_[index] < end);
+}
+
+
+void GCSweeper::ForgetRememberedSlots(uword start, uword end) {
+  if (remembered_slots_length_ == 0) {
+    return;
+  }
+  for (intptr_t i = FirstRememberedSlotAtOrAbove(start);
+       (i < remembered_slots_length_) && (remembered_slots_[i] < end);
+       i++) {
+    remembered_slots_[i] = 0;
+  }
+}
+
+
 intptr_t GCSweeper::SweepPage(HeapPage* page, FreeList* freelist) {
   // Keep track of the discovered live object sizes to be able to finish
   // sweeping early. Reset the per page in_use count for the next marking phase.
@@ -23,6 +57,7 @@ intptr_t GCSweeper::SweepPage(HeapPage* page, FreeList* freelist) {
   while (current < top) {
     if (in_use_swept == in_use) {
       // No more marked objects will be found on this page.
+      ForgetRememberedSlots(current, top);
       page->set_top(current);
       break;
     }
@@ -45,6 +80,7 @@ intptr_t GCSweeper::SweepPage(HeapPage* page, FreeList* freelist) {
         free_end += next_obj->Size();
       }
       obj_size = free_end - current;
+      ForgetRememberedSlots(current, free_end);
       if ((current + obj_size) == top) {
         page->set_top(current);
         break;
@@ -64,6 +100,7 @@ intptr_t GCSweeper::SweepLargePage(HeapPage* page) {
   if (!raw_obj->IsMarked()) {
     // The large object was not marked. Used size is zero, which also tells the
     // calling code that the large object page can be recycled.
+    ForgetRememberedSlots(page->first_object_start(), page->top());
     return 0;
   }
   raw_obj->ClearMarkBit();
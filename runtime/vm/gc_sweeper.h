@@ -18,9 +18,21 @@ class HeapPage;
 // memory.
 class GCSweeper {
  public:
-  explicit GCSweeper(Heap* heap) : heap_(heap) {}
+  explicit GCSweeper(Heap* heap)
+      : heap_(heap), remembered_slots_(NULL), remembered_slots_length_(0) {}
   ~GCSweeper() {}
 
+  // After incremental marking the store buffer still holds the slots of
+  // unreachable objects. The sorted array of these slots is passed here, and
+  // the slots located in freed memory are set to 0 while sweeping.
+  void set_remembered_slots(uword* slots, intptr_t length) {
+    remembered_slots_ = slots;
+    remembered_slots_length_ = length;
+  }
+
+  // Returns true if one of the remembered slots is located in [start, end).
+  bool HasRememberedSlots(uword start, uword end) const;
+
   // Sweep the memory area for the page while clearing the mark bits and adding
   // all the unmarked objects to the freelist.
   // Returns the size of memory used by the marked objects.
@@ -29,7 +41,12 @@ class GCSweeper {
   intptr_t SweepLargePage(HeapPage* page);
 
  private:
+  intptr_t FirstRememberedSlotAtOrAbove(uword start) const;
+  void ForgetRememberedSlots(uword start, uword end);
+
   Heap* heap_;
+  uword* remembered_slots_;
+  intptr_t remembered_slots_length_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(GCSweeper);
 };
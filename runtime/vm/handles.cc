@@ -99,12 +99,17 @@ HandleScope::~HandleScope() {
 
 #if defined(DEBUG)
 NoHandleScope::NoHandleScope(BaseIsolate* isolate) : StackResource(isolate) {
-  isolate->IncrementNoHandleScopeDepth();
+  // Parallel scavenger tasks visit objects without an isolate.
+  if (isolate != NULL) {
+    isolate->IncrementNoHandleScopeDepth();
+  }
 }
 
 
 NoHandleScope::~NoHandleScope() {
-  isolate()->DecrementNoHandleScopeDepth();
+  if (isolate() != NULL) {
+    isolate()->DecrementNoHandleScopeDepth();
+  }
 }
 #endif  // defined(DEBUG)
 
@@ -20,6 +20,7 @@
 
 namespace dart {
 
+DECLARE_FLAG(bool, incremental_marking);
 DEFINE_FLAG(bool, verbose_gc, false, "Enables verbose GC.");
 DEFINE_FLAG(bool, verify_before_gc, false,
             "Enables heap verification before GC.");
@@ -71,7 +72,18 @@ uword Heap::AllocateNew(intptr_t size) {
 
 uword Heap::AllocateOld(intptr_t size) {
   ASSERT(Isolate::Current()->no_gc_scope_depth() == 0);
+  if (old_space_->NeedsMarkingStep()) {
+    old_space_->MarkingStep();
+  }
   uword addr = old_space_->TryAllocate(size);
+  if ((addr == 0) && FLAG_incremental_marking) {
+    // Grow the heap while the old generation is being marked instead of
+    // collecting it in a single pause.
+    if (!old_space_->IsMarking()) {
+      old_space_->StartMarking();
+    }
+    addr = old_space_->TryAllocate(size, PageSpace::kForceGrowth);
+  }
   if (addr == 0) {
     CollectAllGarbage();
     if (FLAG_verbose_gc) {
@@ -130,6 +142,17 @@ void Heap::IterateCodePointers(ObjectPointerVisitor* visitor) {
 }
 
 
+void Heap::IterateOldMarkedCards(ObjectPointerVisitor* visitor) {
+  old_space_->VisitMarkedCards(visitor);
+}
+
+
+void Heap::IterateOldObjects(ObjectVisitor* visitor) {
+  old_space_->VisitObjects(visitor);
+  code_space_->VisitObjects(visitor);
+}
+
+
 RawInstructions* Heap::FindObjectInCodeSpace(FindObjectVisitor* visitor) {
   // The code heap can only have RawInstructions objects.
   RawObject* raw_obj = code_space_->FindObject(visitor);
@@ -139,13 +162,27 @@ RawInstructions* Heap::FindObjectInCodeSpace(FindObjectVisitor* visitor) {
 }
 
 
+RawInstructions* Heap::FindInstructionsInCodeSpace(uword pc) {
+  RawObject* raw_obj = code_space_->FindObjectContaining(pc);
+  ASSERT((raw_obj == Object::null()) ||
+         (raw_obj->GetClassId() == kInstructions));
+  return reinterpret_cast<RawInstructions*>(raw_obj);
+}
+
+
 void Heap::CollectGarbage(Space space, ApiCallbacks api_callbacks) {
   bool invoke_api_callbacks = (api_callbacks == kInvokeApiCallbacks);
   switch (space) {
     case kNew:
       new_space_->Scavenge(invoke_api_callbacks);
-      if (new_space_->HadPromotionFailure()) {
-        old_space_->MarkSweep(true);
+      if (old_space_->IsMarking()) {
+        old_space_->MarkingStep();
+      } else if (new_space_->HadPromotionFailure()) {
+        if (FLAG_incremental_marking) {
+          old_space_->StartMarking();
+        } else {
+          old_space_->MarkSweep(true);
+        }
       }
       break;
     case kOld:
@@ -86,6 +86,12 @@ class Heap {
   void IterateCodePointers(ObjectPointerVisitor* visitor);
   void IterateStubCodePointers(ObjectPointerVisitor* visitor);
 
+  // Visit the pointers in the marked cards of old space.
+  void IterateOldMarkedCards(ObjectPointerVisitor* visitor);
+
+  // Visit all objects in the old and code spaces.
+  void IterateOldObjects(ObjectVisitor* visitor);
+
   // Find an object by visiting all pointers in the specified heap space,
   // the 'visitor' is used to determine if an object is found or not.
   // The 'visitor' function should be set up to return true if the
@@ -96,10 +102,26 @@ class Heap {
   RawInstructions* FindObjectInCodeSpace(FindObjectVisitor* visitor);
   RawInstructions* FindObjectInStubCodeSpace(FindObjectVisitor* visitor);
 
+  // Returns the instructions object covering the pc, or null if the pc is not
+  // located in the code space.
+  RawInstructions* FindInstructionsInCodeSpace(uword pc);
+
   void CollectGarbage(Space space);
   void CollectGarbage(Space space, ApiCallbacks api_callbacks);
   void CollectAllGarbage();
 
+  // Incremental marking of the old generation, see PageSpace. The old
+  // generation is swept once a marking step finds no more work.
+  bool IsMarking() const { return old_space_->IsMarking(); }
+  void StartMarking() { old_space_->StartMarking(); }
+  void MarkingStep() { old_space_->MarkingStep(); }
+
+  // Called by the write barrier when an unmarked old object is stored while
+  // the old generation is being marked.
+  void MarkingBarrier(RawObject* raw_obj) {
+    old_space_->MarkingBarrier(raw_obj);
+  }
+
   // Enables growth control on the page space heaps.  This should be
   // called before any user code is executed.
   void EnableGrowthControl();
@@ -133,6 +155,8 @@ class Heap {
   PageSpace* old_space_;
   PageSpace* code_space_;
 
+  friend class HeapImage;
+
   DISALLOW_COPY_AND_ASSIGN(Heap);
 };
 
@@ -0,0 +1,314 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/heap_image.h"
+
+#include "platform/assert.h"
+#include "vm/bootstrap.h"
+#include "vm/class_table.h"
+#include "vm/dart.h"
+#include "vm/heap.h"
+#include "vm/isolate.h"
+#include "vm/object.h"
+#include "vm/object_store.h"
+#include "vm/pages.h"
+#include "vm/snapshot.h"
+#include "vm/thread.h"
+#include "vm/visitor.h"
+
+namespace dart {
+
+Mutex* HeapImage::mutex_ = NULL;
+HeapImage* HeapImage::image_ = NULL;
+bool HeapImage::capture_attempted_ = false;
+
+
+// Checks that all pointers visited refer to objects which are copied along
+// with the image or which are located in the VM isolate.
+class HeapImageVerifier : public ObjectPointerVisitor {
+ public:
+  HeapImageVerifier(Isolate* isolate, const HeapImage* image)
+      : ObjectPointerVisitor(isolate),
+        image_(image),
+        vm_heap_(Dart::vm_isolate()->heap()),
+        is_valid_(true) { }
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* raw_obj = *current;
+      if (raw_obj->IsHeapObject()) {
+        uword addr = RawObject::ToAddr(raw_obj);
+        if ((image_->BlockIndexOf(addr) < 0) && !vm_heap_->Contains(addr)) {
+          is_valid_ = false;
+        }
+      }
+    }
+  }
+
+  bool is_valid() const { return is_valid_; }
+
+ private:
+  const HeapImage* image_;
+  Heap* vm_heap_;
+  bool is_valid_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapImageVerifier);
+};
+
+
+// Relocates the pointers into the blocks of an image to the copies of the
+// blocks in the current heap.
+class HeapImageRelocator : public ObjectPointerVisitor {
+ public:
+  HeapImageRelocator(Isolate* isolate,
+                     const HeapImage* image,
+                     const uword* new_starts)
+      : ObjectPointerVisitor(isolate),
+        image_(image),
+        new_starts_(new_starts) { }
+
+  RawObject* Relocate(RawObject* raw_obj) const {
+    if (!raw_obj->IsHeapObject()) {
+      return raw_obj;
+    }
+    uword addr = RawObject::ToAddr(raw_obj);
+    intptr_t index = image_->BlockIndexOf(addr);
+    if (index < 0) {
+      // Objects of the VM isolate are shared.
+      return raw_obj;
+    }
+    uword offset = addr - image_->blocks_[index].start;
+    return RawObject::FromAddr(new_starts_[index] + offset);
+  }
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      *current = Relocate(*current);
+    }
+  }
+
+ private:
+  const HeapImage* image_;
+  const uword* new_starts_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapImageRelocator);
+};
+
+
+HeapImage::HeapImage(const Snapshot* snapshot, intptr_t num_blocks)
+    : snapshot_length_(snapshot->length()),
+      snapshot_data_(new uint8_t[snapshot->length()]),
+      num_blocks_(num_blocks),
+      blocks_(new Block[num_blocks]),
+      num_roots_(0),
+      roots_(NULL),
+      num_classes_(0),
+      class_table_capacity_(0),
+      classes_(NULL) {
+  memmove(snapshot_data_, snapshot->content(), snapshot_length_);
+  for (intptr_t i = 0; i < num_blocks_; i++) {
+    blocks_[i].data = NULL;
+  }
+}
+
+
+HeapImage::~HeapImage() {
+  for (intptr_t i = 0; i < num_blocks_; i++) {
+    delete[] blocks_[i].data;
+  }
+  delete[] blocks_;
+  delete[] snapshot_data_;
+  delete[] roots_;
+  delete[] classes_;
+}
+
+
+void HeapImage::InitOnce() {
+  ASSERT(mutex_ == NULL);
+  mutex_ = new Mutex();
+}
+
+
+intptr_t HeapImage::BlockIndexOf(uword addr) const {
+  intptr_t low = 0;
+  intptr_t high = num_blocks_ - 1;
+  while (low <= high) {
+    intptr_t mid = low + (high - low) / 2;
+    const Block& block = blocks_[mid];
+    if (addr < block.start) {
+      high = mid - 1;
+    } else if (addr >= (block.start + block.size)) {
+      low = mid + 1;
+    } else {
+      return mid;
+    }
+  }
+  return -1;
+}
+
+
+intptr_t HeapImage::size() const {
+  intptr_t result = 0;
+  for (intptr_t i = 0; i < num_blocks_; i++) {
+    result += blocks_[i].size;
+  }
+  return result;
+}
+
+
+const HeapImage* HeapImage::Lookup(const Snapshot* snapshot) {
+  MutexLocker ml(mutex_);
+  if ((image_ == NULL) || (image_->snapshot_length_ != snapshot->length())) {
+    return NULL;
+  }
+  if (memcmp(image_->snapshot_data_,
+             snapshot->content(),
+             image_->snapshot_length_) != 0) {
+    return NULL;
+  }
+  return image_;
+}
+
+
+void HeapImage::Capture(const Snapshot* snapshot) {
+  MutexLocker ml(mutex_);
+  if (capture_attempted_) {
+    return;
+  }
+  capture_attempted_ = true;
+  image_ = New(snapshot);
+}
+
+
+HeapImage* HeapImage::New(const Snapshot* snapshot) {
+  Isolate* isolate = Isolate::Current();
+  PageSpace* old_space = isolate->heap()->old_space_;
+  if (old_space->IsMarking() || (old_space->lazy_sweep_page_ != NULL)) {
+    return NULL;
+  }
+  NoGCScope no_gc;
+
+  // Collect the used parts of the pages, sorted by address.
+  intptr_t num_blocks = 0;
+  HeapPage* pages[2] = { old_space->pages_, old_space->large_pages_ };
+  for (intptr_t i = 0; i < 2; i++) {
+    for (HeapPage* page = pages[i]; page != NULL; page = page->next()) {
+      if (page->top() > page->first_object_start()) {
+        num_blocks++;
+      }
+    }
+  }
+  HeapImage* image = new HeapImage(snapshot, num_blocks);
+  intptr_t index = 0;
+  for (intptr_t i = 0; i < 2; i++) {
+    for (HeapPage* page = pages[i]; page != NULL; page = page->next()) {
+      if (page->top() == page->first_object_start()) {
+        continue;
+      }
+      Block block;
+      block.start = page->first_object_start();
+      block.size = page->top() - block.start;
+      block.is_large = (i == 1);
+      block.data = new uint8_t[block.size];
+      memmove(block.data, reinterpret_cast<void*>(block.start), block.size);
+      intptr_t j = index;
+      while ((j > 0) && (image->blocks_[j - 1].start > block.start)) {
+        image->blocks_[j] = image->blocks_[j - 1];
+        j--;
+      }
+      image->blocks_[j] = block;
+      index++;
+    }
+  }
+  ASSERT(index == num_blocks);
+
+  ObjectStore* object_store = isolate->object_store();
+  image->num_roots_ = (object_store->to() - object_store->from()) + 1;
+  image->roots_ = new RawObject*[image->num_roots_];
+  for (intptr_t i = 0; i < image->num_roots_; i++) {
+    image->roots_[i] = object_store->from()[i];
+  }
+
+  ClassTable* class_table = isolate->class_table();
+  image->num_classes_ = class_table->top_;
+  image->class_table_capacity_ = class_table->capacity_;
+  image->classes_ = new RawClass*[image->num_classes_];
+  for (intptr_t i = 0; i < image->num_classes_; i++) {
+    image->classes_[i] = class_table->table_[i];
+  }
+
+  // The image cannot be restored if objects refer to other parts of the
+  // heap, e.g. to new space.
+  HeapImageVerifier verifier(isolate, image);
+  for (intptr_t i = 0; i < num_blocks; i++) {
+    uword addr = image->blocks_[i].start;
+    uword end = addr + image->blocks_[i].size;
+    while (addr < end) {
+      addr += RawObject::FromAddr(addr)->VisitPointers(&verifier);
+    }
+  }
+  verifier.VisitPointers(image->roots_,
+                         image->roots_ + image->num_roots_ - 1);
+  RawObject** classes = reinterpret_cast<RawObject**>(image->classes_);
+  verifier.VisitPointers(classes, classes + image->num_classes_ - 1);
+  if (!verifier.is_valid()) {
+    delete image;
+    return NULL;
+  }
+  return image;
+}
+
+
+void HeapImage::Restore() const {
+  Isolate* isolate = Isolate::Current();
+  PageSpace* old_space = isolate->heap()->old_space_;
+  NoGCScope no_gc;
+
+  uword* new_starts = new uword[num_blocks_];
+  for (intptr_t i = 0; i < num_blocks_; i++) {
+    const Block& block = blocks_[i];
+    new_starts[i] = old_space->AllocateBlock(block.size, block.is_large);
+    memmove(reinterpret_cast<void*>(new_starts[i]), block.data, block.size);
+  }
+  HeapImageRelocator relocator(isolate, this, new_starts);
+
+  // The class table is needed to visit the instances, it is set up first.
+  ClassTable* class_table = isolate->class_table();
+  if (class_table->capacity_ < class_table_capacity_) {
+    free(class_table->table_);
+    class_table->table_ = reinterpret_cast<RawClass**>(
+        calloc(class_table_capacity_, sizeof(RawClass*)));  // NOLINT
+    class_table->capacity_ = class_table_capacity_;
+  }
+  for (intptr_t i = 0; i < num_classes_; i++) {
+    class_table->table_[i] =
+        reinterpret_cast<RawClass*>(relocator.Relocate(classes_[i]));
+  }
+  class_table->top_ = num_classes_;
+
+  ObjectStore* object_store = isolate->object_store();
+  ASSERT((object_store->to() - object_store->from()) + 1 == num_roots_);
+  for (intptr_t i = 0; i < num_roots_; i++) {
+    object_store->from()[i] = relocator.Relocate(roots_[i]);
+  }
+
+  Context& context = Context::Handle(isolate);
+  for (intptr_t i = 0; i < num_blocks_; i++) {
+    uword addr = new_starts[i];
+    uword end = addr + blocks_[i].size;
+    while (addr < end) {
+      RawObject* raw_obj = RawObject::FromAddr(addr);
+      addr += raw_obj->VisitPointers(&relocator);
+      if (raw_obj->GetClassId() == kContext) {
+        context ^= raw_obj;
+        context.set_isolate(isolate);
+      }
+    }
+  }
+  delete[] new_starts;
+
+  Bootstrap::SetupNativeResolver();
+}
+
+}  // namespace dart
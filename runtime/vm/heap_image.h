@@ -0,0 +1,91 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_HEAP_IMAGE_H_
+#define VM_HEAP_IMAGE_H_
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Forward declarations.
+class Isolate;
+class Mutex;
+class RawClass;
+class RawObject;
+class Snapshot;
+
+// A heap image is a copy of the old generation of an isolate, taken right
+// after the isolate has been initialized from a full snapshot, together with
+// its object store and class table. Isolates created later from the same
+// snapshot restore the image instead of reading the snapshot: its blocks of
+// objects are copied into the new heap and the pointers between them are
+// relocated, which is much cheaper than deserializing and relinking every
+// object. The first image captured is kept for the lifetime of the VM.
+class HeapImage {
+ public:
+  static void InitOnce();
+
+  // Returns the image captured from this snapshot, or NULL if there is none.
+  static const HeapImage* Lookup(const Snapshot* snapshot);
+
+  // Captures the heap of the current isolate, which has just been read from
+  // the snapshot. Does nothing if an image was already captured or if the
+  // heap cannot be copied, e.g. because objects refer to new space.
+  static void Capture(const Snapshot* snapshot);
+
+  // Initializes the heap, object store and class table of the current
+  // isolate from the image. The heap and object store must be empty.
+  void Restore() const;
+
+  intptr_t size() const;
+
+ private:
+  // A block of objects from one page of the old generation.
+  struct Block {
+    uword start;
+    intptr_t size;
+    bool is_large;
+    uint8_t* data;
+  };
+
+  HeapImage(const Snapshot* snapshot, intptr_t num_blocks);
+  ~HeapImage();
+
+  // Returns the index of the block containing addr, or -1.
+  intptr_t BlockIndexOf(uword addr) const;
+
+  static HeapImage* New(const Snapshot* snapshot);
+
+  static Mutex* mutex_;
+  static HeapImage* image_;
+  static bool capture_attempted_;
+
+  // Copy of the snapshot the image was captured from.
+  intptr_t snapshot_length_;
+  uint8_t* snapshot_data_;
+
+  // Blocks sorted by their start address.
+  intptr_t num_blocks_;
+  Block* blocks_;
+
+  // Contents of the object store.
+  intptr_t num_roots_;
+  RawObject** roots_;
+
+  // Contents of the class table.
+  intptr_t num_classes_;
+  intptr_t class_table_capacity_;
+  RawClass** classes_;
+
+  friend class HeapImageRelocator;
+  friend class HeapImageVerifier;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapImage);
+};
+
+}  // namespace dart
+
+#endif  // VM_HEAP_IMAGE_H_
@@ -0,0 +1,80 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "platform/assert.h"
+#include "vm/class_finalizer.h"
+#include "vm/heap.h"
+#include "vm/heap_image.h"
+#include "vm/isolate.h"
+#include "vm/snapshot.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+static uint8_t* malloc_allocator(
+    uint8_t* ptr, intptr_t old_size, intptr_t new_size) {
+  return reinterpret_cast<uint8_t*>(realloc(ptr, new_size));
+}
+
+
+// Only ia32 and x64 can run execution tests.
+#if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
+UNIT_TEST_CASE(HeapImage) {
+  const char* kScriptChars =
+      "class HeapImageTest {\n"
+      "  static int testMain() {\n"
+      "    var map = new Map();\n"
+      "    map['list'] = [1, 2, 3];\n"
+      "    return map['list'].length + 'abc'.length;\n"
+      "  }\n"
+      "}\n";
+  uint8_t* buffer;
+
+  // Start an Isolate, load a script and create a full snapshot.
+  {
+    TestIsolateScope __test_isolate__;
+    Isolate* isolate = Isolate::Current();
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    TestCase::LoadTestScript(kScriptChars, NULL);
+    ClassFinalizer::FinalizePendingClasses();
+    SnapshotWriter writer(Snapshot::kFull, &buffer, &malloc_allocator);
+    writer.WriteFullSnapshot();
+  }
+  const Snapshot* snapshot = Snapshot::SetupFromBuffer(buffer);
+
+  // The first isolate created from the snapshot reads it and captures the
+  // heap image, the second one is initialized from the image.
+  for (intptr_t i = 0; i < 2; i++) {
+    TestCase::CreateTestIsolateFromSnapshot(buffer);
+    EXPECT(HeapImage::Lookup(snapshot) != NULL);
+    {
+      Dart_EnterScope();
+      Dart_Handle cls =
+          Dart_GetClass(TestCase::lib(), Dart_NewString("HeapImageTest"));
+      Dart_Handle result =
+          Dart_Invoke(cls, Dart_NewString("testMain"), 0, NULL);
+      EXPECT_VALID(result);
+      int64_t value = 0;
+      EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+      EXPECT_EQ(6, value);
+
+      {
+        Isolate* isolate = Isolate::Current();
+        Zone zone(isolate);
+        HandleScope scope(isolate);
+        isolate->heap()->CollectAllGarbage();
+        EXPECT(isolate->heap()->Verify());
+      }
+      result = Dart_Invoke(cls, Dart_NewString("testMain"), 0, NULL);
+      EXPECT_VALID(result);
+      Dart_ExitScope();
+    }
+    Dart_ShutdownIsolate();
+  }
+  free(buffer);
+}
+#endif  // TARGET_ARCH_IA32 || TARGET_ARCH_X64
+
+}  // namespace dart
@@ -5,10 +5,19 @@
 #include "platform/assert.h"
 #include "vm/globals.h"
 #include "vm/heap.h"
+#include "vm/object.h"
+#include "vm/pages.h"
+#include "vm/store_buffer.h"
 #include "vm/unit_test.h"
 
 namespace dart {
 
+DECLARE_FLAG(bool, compact_old_space);
+DECLARE_FLAG(int, compaction_threshold);
+DECLARE_FLAG(int, heap_growth_rate);
+DECLARE_FLAG(bool, parallel_scavenge);
+DECLARE_FLAG(int, scavenger_tasks);
+
 // Only ia32 and x64 can run execution tests.
 #if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
 TEST_CASE(OldGC) {
@@ -53,5 +62,299 @@ TEST_CASE(LargeSweep) {
   heap->CollectGarbage(Heap::kOld);
 }
 
+
+
+TEST_CASE(CardMarkingFromDartCode) {
+  const char* kScriptChars =
+  "int main() {\n"
+  "  var list = new List(300000);\n"
+  "  for (int i = 0; i < list.length; i++) {\n"
+  "    list[i] = [i];\n"
+  "  }\n"
+  "  int sum = 0;\n"
+  "  for (int i = 0; i < list.length; i += 1000) {\n"
+  "    sum += list[i][0];\n"
+  "  }\n"
+  "  return sum;\n"
+  "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle result = Dart_Invoke(lib,
+                                   Dart_NewString("main"),
+                                   0, NULL);
+  EXPECT_VALID(result);
+  EXPECT(Dart_IsInteger(result));
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(44850000, value);
+}
+
 #endif  // defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64).
+
+
+TEST_CASE(StoreBufferDedup) {
+  StoreBuffer store_buffer;
+  const intptr_t kNumSlots = 3 * StoreBufferBlock::kSize;
+  uword* slots = new uword[kNumSlots];
+  for (intptr_t i = 0; i < kNumSlots; i++) {
+    store_buffer.AddPointer(reinterpret_cast<uword>(&slots[i]));
+    store_buffer.AddPointer(reinterpret_cast<uword>(&slots[0]));
+  }
+  EXPECT(store_buffer.Contains(reinterpret_cast<uword>(&slots[0])));
+  EXPECT(store_buffer.Contains(
+      reinterpret_cast<uword>(&slots[kNumSlots - 1])));
+  EXPECT_EQ(kNumSlots, store_buffer.Count());
+  StoreBufferBlock* blocks = store_buffer.TakeBlocks();
+  intptr_t count = 0;
+  for (StoreBufferBlock* block = blocks;
+       block != NULL;
+       block = block->next()) {
+    count += block->Count();
+  }
+  EXPECT_EQ(kNumSlots, count);
+  EXPECT_EQ(0, store_buffer.Count());
+  StoreBuffer::DeleteBlocks(blocks);
+  delete[] slots;
+}
+
+
+TEST_CASE(StoreBufferKeepsNewObjectAlive) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  const Array& old_array = Array::Handle(Array::New(1, Heap::kOld));
+  const uword slot = RawObject::ToAddr(old_array.raw()) + Array::data_offset();
+  {
+    HANDLESCOPE(isolate);
+    const String& str = String::Handle(String::New("new", Heap::kNew));
+    old_array.SetAt(0, str);
+  }
+  EXPECT(isolate->store_buffer()->Contains(slot));
+  heap->CollectGarbage(Heap::kNew);
+  String& str = String::Handle();
+  str ^= old_array.At(0);
+  EXPECT(str.Equals("new"));
+  // The slot stays in the store buffer as long as it refers to new space.
+  EXPECT_EQ(str.raw()->IsNewObject(),
+            isolate->store_buffer()->Contains(slot));
+}
+
+
+
+TEST_CASE(CardMarkingLargeArray) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  const intptr_t kLength = 1024 * 1024;
+  const Array& large_array = Array::Handle(Array::New(kLength, Heap::kOld));
+  HeapPage* page = PageSpace::PageFor(large_array.raw());
+  EXPECT(page->card_table() != NULL);
+  const intptr_t kIndex = kLength - 7;
+  const uword slot = RawObject::ToAddr(large_array.raw()) +
+      Array::data_offset() + (kIndex * kWordSize);
+  {
+    HANDLESCOPE(isolate);
+    const String& str = String::Handle(String::New("card", Heap::kNew));
+    large_array.SetAt(kIndex, str);
+  }
+  EXPECT(page->IsCardMarked(slot));
+  EXPECT(!isolate->store_buffer()->Contains(slot));
+  heap->CollectGarbage(Heap::kNew);
+  String& str = String::Handle();
+  str ^= large_array.At(kIndex);
+  EXPECT(str.Equals("card"));
+  EXPECT_EQ(str.raw()->IsNewObject(), page->IsCardMarked(slot));
+}
+
+
+
+TEST_CASE(ParallelScavenge) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  const intptr_t kLength = 1000;
+  const Array& old_array = Array::Handle(Array::New(kLength, Heap::kOld));
+  {
+    HANDLESCOPE(isolate);
+    Array& list = Array::Handle();
+    String& str = String::Handle();
+    for (intptr_t i = 0; i < kLength; i++) {
+      // Each slot holds a short list, whose elements are shared between
+      // neighbouring slots.
+      list = Array::New(2, Heap::kNew);
+      str = String::New((i % 2 == 0) ? "even" : "odd", Heap::kNew);
+      list.SetAt(0, str);
+      if (i > 0) {
+        list.SetAt(1, Object::Handle(old_array.At(i - 1)));
+      }
+      old_array.SetAt(i, list);
+    }
+  }
+  bool saved_parallel_scavenge = FLAG_parallel_scavenge;
+  int saved_scavenger_tasks = FLAG_scavenger_tasks;
+  FLAG_parallel_scavenge = true;
+  FLAG_scavenger_tasks = 4;
+  // The second scavenge promotes the survivors of the first one.
+  heap->CollectGarbage(Heap::kNew);
+  heap->CollectGarbage(Heap::kNew);
+  FLAG_parallel_scavenge = saved_parallel_scavenge;
+  FLAG_scavenger_tasks = saved_scavenger_tasks;
+  Array& list = Array::Handle();
+  Array& previous = Array::Handle();
+  String& str = String::Handle();
+  for (intptr_t i = 0; i < kLength; i++) {
+    list ^= old_array.At(i);
+    str ^= list.At(0);
+    EXPECT(str.Equals((i % 2 == 0) ? "even" : "odd"));
+    if (i > 0) {
+      EXPECT(list.At(1) == previous.raw());
+    }
+    previous = list.raw();
+  }
+}
+
+
+
+TEST_CASE(IncrementalMarking) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  const intptr_t kLength = 1000;
+  const Array& from = Array::Handle(Array::New(kLength, Heap::kOld));
+  const Array& to = Array::Handle(Array::New(kLength, Heap::kOld));
+  {
+    HANDLESCOPE(isolate);
+    String& str = String::Handle();
+    for (intptr_t i = 0; i < kLength; i++) {
+      str = String::New((i % 2 == 0) ? "even" : "odd", Heap::kOld);
+      from.SetAt(i, str);
+    }
+  }
+  heap->StartMarking();
+  EXPECT(heap->IsMarking());
+  // Move the strings between the arrays while marking, so that the only
+  // reference to a string may be stored into an already visited array.
+  intptr_t moved = 0;
+  while (heap->IsMarking()) {
+    for (intptr_t i = 0; (i < 10) && (moved < kLength); i++, moved++) {
+      to.SetAt(moved, Object::Handle(from.At(moved)));
+      from.SetAt(moved, Object::Handle());
+    }
+    heap->MarkingStep();
+  }
+  String& str = String::Handle();
+  for (intptr_t i = 0; i < moved; i++) {
+    str ^= to.At(i);
+    EXPECT(str.Equals((i % 2 == 0) ? "even" : "odd"));
+  }
+}
+
+
+
+static void CheckSurvivors(const Array& survivors) {
+  String& str = String::Handle();
+  for (intptr_t i = 0; i < survivors.Length(); i++) {
+    str ^= survivors.At(i);
+    EXPECT(str.Equals("survivor"));
+  }
+}
+
+
+TEST_CASE(LazySweep) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  const intptr_t kLength = 100;
+  const Array& survivors = Array::Handle(Array::New(kLength, Heap::kOld));
+  {
+    HANDLESCOPE(isolate);
+    // Interleave the surviving strings with garbage on the same pages.
+    String& str = String::Handle();
+    for (intptr_t i = 0; i < kLength; i++) {
+      Array::New(1000, Heap::kOld);
+      str = String::New("survivor", Heap::kOld);
+      survivors.SetAt(i, str);
+    }
+  }
+  heap->CollectGarbage(Heap::kOld);
+  CheckSurvivors(survivors);
+  {
+    // Reuse the garbage, which sweeps the pages holding the survivors.
+    HANDLESCOPE(isolate);
+    for (intptr_t i = 0; i < kLength; i++) {
+      Array::New(1000, Heap::kOld);
+    }
+  }
+  CheckSurvivors(survivors);
+  heap->CollectGarbage(Heap::kOld);
+  CheckSurvivors(survivors);
+}
+
+
+// Allocates garbage until it is the first object bump allocated on a fresh
+// page. Objects allocated next follow it on that page.
+static void AllocateUntilFreshPage() {
+  // Stale handle blocks would keep the garbage alive.
+  HANDLESCOPE(Isolate::Current());
+  while (true) {
+    RawArray* garbage = Array::New(1000, Heap::kOld);
+    HeapPage* page = PageSpace::PageFor(garbage);
+    uword addr = RawObject::ToAddr(garbage);
+    if ((addr == page->first_object_start()) &&
+        (page->top() == addr + Array::InstanceSize(1000))) {
+      return;
+    }
+  }
+}
+
+
+TEST_CASE(CompactOldSpace) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  bool saved_compact_old_space = FLAG_compact_old_space;
+  int saved_compaction_threshold = FLAG_compaction_threshold;
+  FLAG_compact_old_space = true;
+  FLAG_compaction_threshold = 50;
+  // The second collection frees almost nothing, after which the heap may
+  // grow by FLAG_heap_growth_rate pages without collecting. The holders and
+  // the garbage after them fit into those pages.
+  heap->CollectGarbage(Heap::kOld);
+  heap->CollectGarbage(Heap::kOld);
+  const intptr_t kLength = 3;
+  EXPECT_LE(kLength + 1, FLAG_heap_growth_rate);
+  const Array& survivors = Array::Handle(Array::New(kLength, Heap::kOld));
+  for (intptr_t i = 0; i < kLength; i++) {
+    // Each surviving holder refers to a new space string and is the only
+    // live object on a fresh page, the rest of the page is garbage.
+    HANDLESCOPE(isolate);
+    AllocateUntilFreshPage();
+    const Array& holder = Array::Handle(Array::New(1, Heap::kOld));
+    const String& str = String::Handle(String::New("survivor", Heap::kNew));
+    holder.SetAt(0, str);
+    survivors.SetAt(i, holder);
+  }
+  AllocateUntilFreshPage();
+  HeapPage* pages[kLength];
+  for (intptr_t i = 0; i < kLength; i++) {
+    pages[i] = PageSpace::PageFor(survivors.At(i));
+    for (intptr_t j = 0; j < i; j++) {
+      EXPECT(pages[i] != pages[j]);
+    }
+  }
+  heap->CollectGarbage(Heap::kOld);
+  // The sparse pages were evacuated, none of the holders is left on them.
+  for (intptr_t i = 0; i < kLength; i++) {
+    HeapPage* page = PageSpace::PageFor(survivors.At(i));
+    for (intptr_t j = 0; j < kLength; j++) {
+      EXPECT(page != pages[j]);
+    }
+  }
+  // The moved holders keep the new space strings alive.
+  heap->CollectGarbage(Heap::kNew);
+  Array& holder = Array::Handle();
+  String& str = String::Handle();
+  for (intptr_t i = 0; i < kLength; i++) {
+    holder ^= survivors.At(i);
+    EXPECT(holder.IsOld());
+    str ^= holder.At(0);
+    EXPECT(str.Equals("survivor"));
+  }
+  FLAG_compact_old_space = saved_compact_old_space;
+  FLAG_compaction_threshold = saved_compaction_threshold;
+}
+
 }
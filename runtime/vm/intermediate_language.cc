@@ -500,6 +500,13 @@ void JoinEntryInstr::InsertPhi(intptr_t var_index, intptr_t var_count) {
 }
 
 
+void JoinEntryInstr::RemovePhi(intptr_t var_index) {
+  ASSERT((phis_ != NULL) && ((*phis_)[var_index] != NULL));
+  (*phis_)[var_index] = NULL;
+  phi_count_--;
+}
+
+
 intptr_t Instruction::SuccessorCount() const {
   ASSERT(!IsBranch());
   ASSERT(!IsGraphEntry());
@@ -1999,6 +1999,7 @@ class JoinEntryInstr : public BlockEntryInstr {
   virtual void PrepareEntry(FlowGraphCompiler* compiler);
 
   void InsertPhi(intptr_t var_index, intptr_t var_count);
+  void RemovePhi(intptr_t var_index);
 
   intptr_t phi_count() const { return phi_count_; }
 
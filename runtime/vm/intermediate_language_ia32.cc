@@ -19,6 +19,7 @@ namespace dart {
 
 DECLARE_FLAG(int, optimization_counter_threshold);
 DECLARE_FLAG(bool, trace_functions);
+DECLARE_FLAG(bool, use_osr);
 
 // Generic summary for call instructions that have all arguments pushed
 // on the stack and return the result in a fixed register EAX.
@@ -1271,22 +1272,42 @@ void CatchEntryComp::EmitNativeCode(FlowGraphCompiler* compiler) {
 
 
 LocationSummary* CheckStackOverflowComp::MakeLocationSummary() const {
-  return LocationSummary::Make(0,
-                               Location::NoLocation(),
-                               LocationSummary::kCall);
+  const intptr_t kNumInputs = 0;
+  const intptr_t kNumTemps = 1;
+  LocationSummary* summary = new LocationSummary(kNumInputs,
+                                                 kNumTemps,
+                                                 LocationSummary::kCall);
+  summary->set_temp(0, Location::RequiresRegister());
+  return summary;
 }
 
 
 void CheckStackOverflowComp::EmitNativeCode(FlowGraphCompiler* compiler) {
   __ cmpl(ESP,
           Address::Absolute(Isolate::Current()->stack_limit_address()));
-  Label no_stack_overflow;
-  __ j(ABOVE, &no_stack_overflow);
+  Label call_runtime, done;
+  if (!compiler->is_optimizing() && FLAG_use_osr &&
+      CodeGenerator::CanOptimize()) {
+    // Count loop iterations in the usage counter of the function. Once the
+    // function is hot, the runtime continues this frame in optimized code.
+    Register temp = locs()->temp(0).reg();
+    __ j(BELOW_EQUAL, &call_runtime);
+    const Function& function =
+        Function::ZoneHandle(compiler->parsed_function().function().raw());
+    __ LoadObject(temp, function);
+    __ incl(FieldAddress(temp, Function::usage_counter_offset()));
+    __ cmpl(FieldAddress(temp, Function::usage_counter_offset()),
+        Immediate(FLAG_optimization_counter_threshold));
+    __ j(LESS_EQUAL, &done);
+  } else {
+    __ j(ABOVE, &done);
+  }
+  __ Bind(&call_runtime);
   compiler->GenerateCallRuntime(cid(),
                                 token_index(),
                                 try_index(),
                                 kStackOverflowRuntimeEntry);
-  __ Bind(&no_stack_overflow);
+  __ Bind(&done);
 }
 
 
@@ -1775,10 +1796,15 @@ void PolymorphicInstanceCallComp::EmitNativeCode(FlowGraphCompiler* compiler) {
   __ j(ZERO, is_smi_label);
   Label done;
   __ LoadClassId(EDI, EAX);
-  for (intptr_t i = 0; i < ic_data()->NumberOfChecks(); i++) {
+  // The checks are ordered by decreasing frequency, the Smi check is
+  // handled above.
+  const intptr_t first_check = (is_smi_label == &handle_smi) ? 1 : 0;
+  const intptr_t num_checks = ic_data()->NumberOfChecks();
+  for (intptr_t i = first_check; i < num_checks; i++) {
+    const bool is_last_check = (i == (num_checks - 1));
     Label next_test;
     __ cmpl(EDI, Immediate(ic_data()->GetReceiverClassIdAt(i)));
-    __ j(NOT_EQUAL, &next_test);
+    __ j(NOT_EQUAL, is_last_check ? deopt : &next_test);
     const Function& target = Function::ZoneHandle(ic_data()->GetTargetAt(i));
     compiler->GenerateStaticCall(instance_call()->cid(),
                                  instance_call()->token_index(),
@@ -1789,7 +1815,9 @@ void PolymorphicInstanceCallComp::EmitNativeCode(FlowGraphCompiler* compiler) {
     __ jmp(&done);
     __ Bind(&next_test);
   }
-  __ jmp(deopt);
+  if (first_check == num_checks) {
+    __ jmp(deopt);
+  }
   if (is_smi_label == &handle_smi) {
     __ Bind(&handle_smi);
     ASSERT(ic_data()->GetReceiverClassIdAt(0) == kSmi);
@@ -20,6 +20,7 @@ namespace dart {
 
 DECLARE_FLAG(int, optimization_counter_threshold);
 DECLARE_FLAG(bool, trace_functions);
+DECLARE_FLAG(bool, use_osr);
 
 void BindInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
   computation()->EmitNativeCode(compiler);
@@ -1299,13 +1300,28 @@ void CheckStackOverflowComp::EmitNativeCode(FlowGraphCompiler* compiler) {
   // Generate stack overflow check.
   __ movq(temp, Immediate(Isolate::Current()->stack_limit_address()));
   __ cmpq(RSP, Address(temp, 0));
-  Label no_stack_overflow;
-  __ j(ABOVE, &no_stack_overflow, Assembler::kNearJump);
+  Label call_runtime, done;
+  if (!compiler->is_optimizing() && FLAG_use_osr &&
+      CodeGenerator::CanOptimize()) {
+    // Count loop iterations in the usage counter of the function. Once the
+    // function is hot, the runtime continues this frame in optimized code.
+    __ j(BELOW_EQUAL, &call_runtime, Assembler::kNearJump);
+    const Function& function =
+        Function::ZoneHandle(compiler->parsed_function().function().raw());
+    __ LoadObject(temp, function);
+    __ incq(FieldAddress(temp, Function::usage_counter_offset()));
+    __ cmpl(FieldAddress(temp, Function::usage_counter_offset()),
+        Immediate(FLAG_optimization_counter_threshold));
+    __ j(LESS_EQUAL, &done, Assembler::kNearJump);
+  } else {
+    __ j(ABOVE, &done, Assembler::kNearJump);
+  }
+  __ Bind(&call_runtime);
   compiler->GenerateCallRuntime(cid(),
                                 token_index(),
                                 try_index(),
                                 kStackOverflowRuntimeEntry);
-  __ Bind(&no_stack_overflow);
+  __ Bind(&done);
 }
 
 
@@ -1788,10 +1804,15 @@ void PolymorphicInstanceCallComp::EmitNativeCode(FlowGraphCompiler* compiler) {
   __ j(ZERO, is_smi_label);
   Label done;
   __ LoadClassId(RDI, RAX);
-  for (intptr_t i = 0; i < ic_data()->NumberOfChecks(); i++) {
+  // The checks are ordered by decreasing frequency, the Smi check is
+  // handled above.
+  const intptr_t first_check = (is_smi_label == &handle_smi) ? 1 : 0;
+  const intptr_t num_checks = ic_data()->NumberOfChecks();
+  for (intptr_t i = first_check; i < num_checks; i++) {
+    const bool is_last_check = (i == (num_checks - 1));
     Label next_test;
     __ cmpq(RDI, Immediate(ic_data()->GetReceiverClassIdAt(i)));
-    __ j(NOT_EQUAL, &next_test);
+    __ j(NOT_EQUAL, is_last_check ? deopt : &next_test);
     const Function& target = Function::ZoneHandle(ic_data()->GetTargetAt(i));
     compiler->GenerateStaticCall(instance_call()->cid(),
                                  instance_call()->token_index(),
@@ -1802,7 +1823,9 @@ void PolymorphicInstanceCallComp::EmitNativeCode(FlowGraphCompiler* compiler) {
     __ jmp(&done);
     __ Bind(&next_test);
   }
-  __ jmp(deopt);
+  if (first_check == num_checks) {
+    __ jmp(deopt);
+  }
   if (is_smi_label == &handle_smi) {
     __ Bind(&handle_smi);
     ASSERT(ic_data()->GetReceiverClassIdAt(0) == kSmi);
@@ -15,6 +15,7 @@
 #include "vm/heap.h"
 #include "vm/message_handler.h"
 #include "vm/object_store.h"
+#include "vm/optimization_queue.h"
 #include "vm/parser.h"
 #include "vm/port.h"
 #include "vm/random.h"
@@ -79,13 +80,13 @@ void IsolateMessageHandler::MessageNotify(Message::Priority priority) {
 }
 
 
-static RawInstance* DeserializeMessage(void* data) {
+static RawInstance* DeserializeMessage(Message* message) {
   // Create a snapshot object using the buffer.
-  const Snapshot* snapshot = Snapshot::SetupFromBuffer(data);
+  const Snapshot* snapshot = Snapshot::SetupFromBuffer(message->data());
   ASSERT(snapshot->IsMessageSnapshot());
 
   // Read object back from the snapshot.
-  SnapshotReader reader(snapshot, Isolate::Current());
+  SnapshotReader reader(snapshot, Isolate::Current(), message->buffers());
   Instance& instance = Instance::Handle();
   instance ^= reader.ReadObject();
   return instance.raw();
@@ -98,7 +99,7 @@ bool IsolateMessageHandler::HandleMessage(Message* message) {
   HandleScope handle_scope(isolate_);
 
   const Instance& msg =
-      Instance::Handle(DeserializeMessage(message->data()));
+      Instance::Handle(DeserializeMessage(message));
   if (message->IsOOB()) {
     // For now the only OOB messages are Mirrors messages.
     HandleMirrorsMessage(isolate_, message->reply_port(), msg);
@@ -155,6 +156,7 @@ Isolate::Isolate()
       api_state_(NULL),
       stub_code_(NULL),
       debugger_(NULL),
+      optimization_queue_(NULL),
       long_jump_base_(NULL),
       timer_list_(),
       ast_node_id_(AstNode::kNoId),
@@ -175,6 +177,7 @@ Isolate::~Isolate() {
   delete api_state_;
   delete stub_code_;
   delete debugger_;
+  delete optimization_queue_;
   delete mutex_;
   mutex_ = NULL;  // Fail fast if interrupts are scheduled on a dead isolate.
   delete message_handler_;
@@ -182,21 +185,34 @@ Isolate::~Isolate() {
 }
 
 void Isolate::SetCurrent(Isolate* current) {
+  if ((current != NULL) && (Thread::GetThreadLocal(stack_upper_key) == 0)) {
+    // Determining the bounds may be slow, they are recorded once per thread.
+    uword lower = 0;
+    uword upper = 0;
+    if (Thread::GetStackBounds(&lower, &upper)) {
+      Thread::SetThreadLocal(stack_lower_key, lower);
+      Thread::SetThreadLocal(stack_upper_key, upper);
+    }
+  }
   Thread::SetThreadLocal(isolate_key, reinterpret_cast<uword>(current));
 }
 
 
-// The single thread local key which stores all the thread local data
-// for a thread. Since an Isolate is the central repository for
-// storing all isolate specific information a single thread local key
-// is sufficient.
+// The thread local key which stores all the isolate specific data for a
+// thread. Since an Isolate is the central repository for storing all
+// isolate specific information a single thread local key is sufficient.
+// The stack bounds belong to the thread, not to the isolate it runs.
 ThreadLocalKey Isolate::isolate_key = Thread::kUnsetThreadLocalKey;
+ThreadLocalKey Isolate::stack_lower_key = Thread::kUnsetThreadLocalKey;
+ThreadLocalKey Isolate::stack_upper_key = Thread::kUnsetThreadLocalKey;
 
 
 void Isolate::InitOnce() {
   ASSERT(isolate_key == Thread::kUnsetThreadLocalKey);
   isolate_key = Thread::CreateThreadLocal();
   ASSERT(isolate_key != Thread::kUnsetThreadLocalKey);
+  stack_lower_key = Thread::CreateThreadLocal();
+  stack_upper_key = Thread::CreateThreadLocal();
   create_callback_ = NULL;
 }
 
@@ -229,6 +245,7 @@ Isolate* Isolate::Init(const char* name_prefix) {
 
   result->debugger_ = new Debugger();
   result->debugger_->Initialize(result);
+  result->optimization_queue_ = new OptimizationQueue(result);
   if (FLAG_trace_isolates) {
     if (name_prefix == NULL || strcmp(name_prefix, "vm-isolate") != 0) {
       OS::Print("[+] Starting isolate:\n"
@@ -373,6 +390,10 @@ void Isolate::Shutdown() {
     debugger_->Shutdown();
   }
 
+  // Stop requesting interrupts for the queued functions.
+  delete optimization_queue_;
+  optimization_queue_ = NULL;
+
   // Close all the ports owned by this isolate.
   PortMap::ClosePorts(message_handler());
 
@@ -461,6 +482,11 @@ void Isolate::VisitObjectPointers(ObjectPointerVisitor* visitor,
 
   // Visit objects in the debugger.
   debugger()->VisitObjectPointers(visitor);
+
+  // Visit the functions queued for optimization.
+  if (optimization_queue_ != NULL) {
+    optimization_queue_->VisitObjectPointers(visitor);
+  }
 }
 
 
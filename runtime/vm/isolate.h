@@ -28,6 +28,7 @@ class MessageHandler;
 class Mutex;
 class ObjectPointerVisitor;
 class ObjectStore;
+class OptimizationQueue;
 class RawArray;
 class RawContext;
 class RawError;
@@ -45,6 +46,15 @@ class Isolate : public BaseIsolate {
 
   static void SetCurrent(Isolate* isolate);
 
+  // Sets lower and upper to the bounds of the stack of the current thread,
+  // which are recorded when the thread first enters an isolate. Returns
+  // false if they are not known. Can be called from a signal handler.
+  static bool GetThreadStackBounds(uword* lower, uword* upper) {
+    *lower = Thread::GetThreadLocal(stack_lower_key);
+    *upper = Thread::GetThreadLocal(stack_upper_key);
+    return *upper != 0;
+  }
+
   static void InitOnce();
   static Isolate* Init(const char* name_prefix);
   void Shutdown();
@@ -58,7 +68,7 @@ class Isolate : public BaseIsolate {
   void VisitWeakPersistentHandles(HandleVisitor* visit,
                                   bool visit_prologue_weak_persistent_handles);
 
-  StoreBufferBlock* store_buffer() { return &store_buffer_; }
+  StoreBuffer* store_buffer() { return &store_buffer_; }
 
   ClassTable* class_table() { return &class_table_; }
   static intptr_t class_table_offset() {
@@ -151,8 +161,9 @@ class Isolate : public BaseIsolate {
   enum {
     kApiInterrupt = 0x1,      // An interrupt from Dart_InterruptIsolate.
     kMessageInterrupt = 0x2,  // An interrupt to process an out of band message.
+    kOptimizeInterrupt = 0x4,  // An interrupt to optimize a queued function.
 
-    kInterruptsMask = kApiInterrupt | kMessageInterrupt,
+    kInterruptsMask = kApiInterrupt | kMessageInterrupt | kOptimizeInterrupt,
   };
 
   void ScheduleInterrupts(uword interrupt_bits);
@@ -176,6 +187,10 @@ class Isolate : public BaseIsolate {
 
   Debugger* debugger() const { return debugger_; }
 
+  OptimizationQueue* optimization_queue() const {
+    return optimization_queue_;
+  }
+
   static void SetCreateCallback(Dart_IsolateCreateCallback cback);
   static Dart_IsolateCreateCallback CreateCallback();
 
@@ -201,7 +216,9 @@ class Isolate : public BaseIsolate {
   static const intptr_t kStackSizeBuffer = (16 * KB);
 
   static ThreadLocalKey isolate_key;
-  StoreBufferBlock store_buffer_;
+  static ThreadLocalKey stack_lower_key;
+  static ThreadLocalKey stack_upper_key;
+  StoreBuffer store_buffer_;
   ClassTable class_table_;
   Dart_MessageNotifyCallback message_notify_callback_;
   char* name_;
@@ -216,6 +233,7 @@ class Isolate : public BaseIsolate {
   ApiState* api_state_;
   StubCode* stub_code_;
   Debugger* debugger_;
+  OptimizationQueue* optimization_queue_;
   LongJump* long_jump_base_;
   TimerList timer_list_;
   intptr_t ast_node_id_;  // Deprecate.
@@ -18,6 +18,19 @@ UNIT_TEST_CASE(IsolateCurrent) {
 }
 
 
+UNIT_TEST_CASE(IsolateThreadStackBounds) {
+  Isolate* isolate = Isolate::Init(NULL);
+  uword lower = 0;
+  uword upper = 0;
+  EXPECT(Isolate::GetThreadStackBounds(&lower, &upper));
+  const uword local = reinterpret_cast<uword>(&lower);
+  EXPECT_LT(lower, local);
+  EXPECT_LT(local, upper);
+  isolate->Shutdown();
+  delete isolate;
+}
+
+
 // Only ia32 and x64 can run dart execution tests.
 #if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
 // Unit test case to verify error during isolate spawning (application classes
@@ -4,13 +4,57 @@
 
 #include "vm/message.h"
 
+#include "vm/atomic.h"
+
 namespace dart {
 
 DECLARE_FLAG(bool, trace_isolates);
 
+MessageBuffers::~MessageBuffers() {
+  for (intptr_t i = 0; i < length_; i++) {
+    free(buffers_[i].data);
+  }
+  free(buffers_);
+}
+
+
+intptr_t MessageBuffers::Add(uint8_t* data, intptr_t size) {
+  if (length_ == capacity_) {
+    capacity_ = (capacity_ == 0) ? 4 : (2 * capacity_);
+    buffers_ = reinterpret_cast<Buffer*>(
+        realloc(buffers_, capacity_ * sizeof(Buffer)));  // NOLINT
+  }
+  buffers_[length_].data = data;
+  buffers_[length_].size = size;
+  return length_++;
+}
+
+
+intptr_t MessageBuffers::SizeAt(intptr_t index) const {
+  ASSERT((index >= 0) && (index < length_));
+  return buffers_[index].size;
+}
+
+
+uint8_t* MessageBuffers::DataAt(intptr_t index) const {
+  ASSERT((index >= 0) && (index < length_));
+  return buffers_[index].data;
+}
+
+
+uint8_t* MessageBuffers::Take(intptr_t index) {
+  ASSERT((index >= 0) && (index < length_));
+  uint8_t* data = buffers_[index].data;
+  ASSERT(data != NULL);
+  buffers_[index].data = NULL;
+  return data;
+}
+
+
 MessageQueue::MessageQueue() {
   head_ = NULL;
   tail_ = NULL;
+  incoming_ = NULL;
 }
 
 
@@ -18,28 +62,68 @@ MessageQueue::~MessageQueue() {
   // Ensure that all pending messages have been released.
 #if defined(DEBUG)
   ASSERT(head_ == NULL);
+  ASSERT(incoming_ == NULL);
 #endif
 }
 
 
-void MessageQueue::Enqueue(Message* msg) {
+bool MessageQueue::Enqueue(Message* msg) {
   // Make sure messages are not reused.
   ASSERT(msg->next_ == NULL);
+  uword* incoming_addr = reinterpret_cast<uword*>(&incoming_);
+  uword old_incoming = *incoming_addr;
+  while (true) {
+    msg->next_ = reinterpret_cast<Message*>(old_incoming);
+    uword result = AtomicOperations::CompareAndSwapWord(
+        incoming_addr, old_incoming, reinterpret_cast<uword>(msg));
+    if (result == old_incoming) {
+      return (old_incoming == 0);
+    }
+    old_incoming = result;
+  }
+}
+
+
+void MessageQueue::TakeIncoming() {
+  uword* incoming_addr = reinterpret_cast<uword*>(&incoming_);
+  uword old_incoming = *incoming_addr;
+  while (old_incoming != 0) {
+    uword result =
+        AtomicOperations::CompareAndSwapWord(incoming_addr, old_incoming, 0);
+    if (result == old_incoming) {
+      break;
+    }
+    old_incoming = result;
+  }
+  if (old_incoming == 0) {
+    return;
+  }
+
+  // Reverse the pushed messages and append them to the pending ones.
+  Message* cur = reinterpret_cast<Message*>(old_incoming);
+  Message* first = NULL;
+  Message* last = cur;
+  while (cur != NULL) {
+    Message* next = cur->next_;
+    cur->next_ = first;
+    first = cur;
+    cur = next;
+  }
   if (head_ == NULL) {
-    // Only element in the queue.
     ASSERT(tail_ == NULL);
-    head_ = msg;
-    tail_ = msg;
+    head_ = first;
   } else {
     ASSERT(tail_ != NULL);
-    // Append at the tail.
-    tail_->next_ = msg;
-    tail_ = msg;
+    tail_->next_ = first;
   }
+  tail_ = last;
 }
 
 
 Message* MessageQueue::Dequeue() {
+  if (head_ == NULL) {
+    TakeIncoming();
+  }
   Message* result = head_;
   if (result != NULL) {
     head_ = result->next_;
@@ -57,6 +141,7 @@ Message* MessageQueue::Dequeue() {
 
 
 void MessageQueue::Flush(Dart_Port port) {
+  TakeIncoming();
   Message* cur = head_;
   Message* prev = NULL;
   while (cur != NULL) {
@@ -81,6 +166,7 @@ void MessageQueue::Flush(Dart_Port port) {
 
 
 void MessageQueue::FlushAll() {
+  TakeIncoming();
   Message* cur = head_;
   head_ = NULL;
   tail_ = NULL;
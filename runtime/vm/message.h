@@ -12,6 +12,39 @@ typedef int64_t Dart_Port;
 
 namespace dart {
 
+// Buffers which are sent along with a message instead of being copied into
+// its snapshot, e.g. the contents of large byte arrays. The buffers are
+// allocated with malloc(). The receiver takes ownership of the buffers it
+// uses, the remaining ones are freed together with the list.
+class MessageBuffers {
+ public:
+  MessageBuffers() : length_(0), capacity_(0), buffers_(NULL) {}
+  ~MessageBuffers();
+
+  // Adds a buffer to the list and returns its index.
+  intptr_t Add(uint8_t* data, intptr_t size);
+
+  intptr_t length() const { return length_; }
+  intptr_t SizeAt(intptr_t index) const;
+  uint8_t* DataAt(intptr_t index) const;
+
+  // Transfers the ownership of a buffer to the caller.
+  uint8_t* Take(intptr_t index);
+
+ private:
+  struct Buffer {
+    uint8_t* data;
+    intptr_t size;
+  };
+
+  intptr_t length_;
+  intptr_t capacity_;
+  Buffer* buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessageBuffers);
+};
+
+
 class Message {
  public:
   typedef enum {
@@ -37,14 +70,28 @@ class Message {
         dest_port_(dest_port),
         reply_port_(reply_port),
         data_(data),
+        buffers_(NULL),
+        priority_(priority) {}
+
+  // A new message which also carries out-of-band buffers, the message takes
+  // ownership of the buffers.
+  Message(Dart_Port dest_port, Dart_Port reply_port,
+          uint8_t* data, MessageBuffers* buffers, Priority priority)
+      : next_(NULL),
+        dest_port_(dest_port),
+        reply_port_(reply_port),
+        data_(data),
+        buffers_(buffers),
         priority_(priority) {}
   ~Message() {
     free(data_);
+    delete buffers_;
   }
 
   Dart_Port dest_port() const { return dest_port_; }
   Dart_Port reply_port() const { return reply_port_; }
   uint8_t* data() const { return data_; }
+  MessageBuffers* buffers() const { return buffers_; }
   Priority priority() const { return priority_; }
 
   bool IsOOB() const { return priority_ == Message::kOOBPriority; }
@@ -56,18 +103,27 @@ class Message {
   Dart_Port dest_port_;
   Dart_Port reply_port_;
   uint8_t* data_;
+  MessageBuffers* buffers_;
   Priority priority_;
 
   DISALLOW_COPY_AND_ASSIGN(Message);
 };
 
 // There is a message queue per isolate.
+//
+// Any number of threads may enqueue messages concurrently without taking a
+// lock: they push the messages on a stack with compare-and-swap. All other
+// operations must be serialized by the owner of the queue. They move the
+// whole stack of pushed messages to the list of pending messages at once,
+// restoring the order in which the messages were enqueued.
 class MessageQueue {
  public:
   MessageQueue();
   ~MessageQueue();
 
-  void Enqueue(Message* msg);
+  // Returns true if the queue was empty before the message was added, in
+  // which case the caller is responsible for notifying the consumer.
+  bool Enqueue(Message* msg);
 
   // Gets the next message from the message queue or NULL if no
   // message is available.  This function will not block.
@@ -79,9 +135,16 @@ class MessageQueue {
  private:
   friend class MessageQueueTestPeer;
 
+  // Moves the pushed messages to the end of the pending messages.
+  void TakeIncoming();
+
+  // Pending messages, in order.
   Message* head_;
   Message* tail_;
 
+  // Messages pushed by Enqueue, most recent first.
+  Message* incoming_;
+
   DISALLOW_COPY_AND_ASSIGN(MessageQueue);
 };
 
@@ -86,7 +86,6 @@ void MessageHandler::Run(ThreadPool* pool,
 
 
 void MessageHandler::PostMessage(Message* message) {
-  MonitorLocker ml(&monitor_);
   if (FLAG_trace_isolates) {
     const char* source_name = "<native code>";
     Isolate* source_isolate = Isolate::Current();
@@ -101,17 +100,25 @@ void MessageHandler::PostMessage(Message* message) {
               source_name, message->reply_port(), name(), message->dest_port());
   }
 
+  // The queues accept messages without holding the monitor_. Only the
+  // sender which finds a queue empty needs to check whether a task has to
+  // be started: a running task handles all messages in the queues before
+  // it clears task_ while holding the monitor_.
   Message::Priority saved_priority = message->priority();
+  bool was_empty;
   if (message->IsOOB()) {
-    oob_queue_->Enqueue(message);
+    was_empty = oob_queue_->Enqueue(message);
   } else {
-    queue_->Enqueue(message);
+    was_empty = queue_->Enqueue(message);
   }
   message = NULL;  // Do not access message.  May have been deleted.
 
-  if (pool_ != NULL && task_ == NULL) {
-    task_ = new MessageHandlerTask(this);
-    pool_->Run(task_);
+  if (was_empty) {
+    MonitorLocker ml(&monitor_);
+    if (pool_ != NULL && task_ == NULL) {
+      task_ = new MessageHandlerTask(this);
+      pool_->Run(task_);
+    }
   }
 
   // Invoke any custom message notification.
@@ -265,4 +265,135 @@ UNIT_TEST_CASE(MessageHandler_Run) {
   EXPECT(!handler.HasLivePorts());
 }
 
+
+// Counts the messages it handles and checks that the messages sent from
+// each port arrive in order.
+class CountingMessageHandler : public MessageHandler {
+ public:
+  explicit CountingMessageHandler(intptr_t num_ports)
+      : next_(new intptr_t[num_ports]),
+        message_count_(0),
+        in_order_(true),
+        ended_(false) {
+    for (intptr_t i = 0; i < num_ports; i++) {
+      next_[i] = 0;
+    }
+  }
+
+  ~CountingMessageHandler() {
+    delete[] next_;
+  }
+
+  bool HandleMessage(Message* message) {
+    // The reply port holds the sequence number of the message.
+    if (message->reply_port() != next_[message->dest_port()]) {
+      in_order_ = false;
+    }
+    next_[message->dest_port()]++;
+    delete message;
+    MonitorLocker ml(&monitor_);
+    message_count_++;
+    ml.Notify();
+    return true;
+  }
+
+  void End() {
+    MonitorLocker ml(&monitor_);
+    ended_ = true;
+    ml.Notify();
+  }
+
+  void WaitForMessages(intptr_t count) {
+    MonitorLocker ml(&monitor_);
+    while (message_count_ < count) {
+      ml.Wait();
+    }
+  }
+
+  void WaitForEnd() {
+    MonitorLocker ml(&monitor_);
+    while (!ended_) {
+      ml.Wait();
+    }
+  }
+
+  bool in_order() const { return in_order_; }
+
+ private:
+  Monitor monitor_;
+  intptr_t* next_;
+  intptr_t message_count_;
+  bool in_order_;
+  bool ended_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingMessageHandler);
+};
+
+
+static void CountingEndFunction(uword data) {
+  reinterpret_cast<CountingMessageHandler*>(data)->End();
+}
+
+
+struct SenderInfo {
+  MessageHandler* handler;
+  Dart_Port port;
+  intptr_t count;
+  Monitor* monitor;
+  intptr_t* num_running;
+};
+
+
+static void SendNumberedMessages(uword param) {
+  SenderInfo* info = reinterpret_cast<SenderInfo*>(param);
+  MessageHandlerTestPeer handler_peer(info->handler);
+  for (intptr_t i = 0; i < info->count; i++) {
+    handler_peer.PostMessage(
+        new Message(info->port, i, NULL, Message::kNormalPriority));
+  }
+  MonitorLocker ml(info->monitor);
+  (*info->num_running)--;
+  ml.Notify();
+}
+
+
+UNIT_TEST_CASE(MessageHandler_RunConcurrentSenders) {
+  const intptr_t kNumSenders = 4;
+  const intptr_t kNumMessages = 10000;
+  ThreadPool pool;
+  CountingMessageHandler handler(kNumSenders + 1);
+  MessageHandlerTestPeer handler_peer(&handler);
+  handler_peer.increment_live_ports();
+  handler.Run(&pool, NULL, CountingEndFunction,
+              reinterpret_cast<uword>(&handler));
+
+  // Senders post to an idle or running handler, which must handle all the
+  // messages.
+  Monitor monitor;
+  intptr_t num_running = kNumSenders;
+  SenderInfo infos[kNumSenders];
+  for (intptr_t i = 0; i < kNumSenders; i++) {
+    infos[i].handler = &handler;
+    infos[i].port = i;
+    infos[i].count = kNumMessages;
+    infos[i].monitor = &monitor;
+    infos[i].num_running = &num_running;
+    Thread::Start(SendNumberedMessages, reinterpret_cast<uword>(&infos[i]));
+  }
+  handler.WaitForMessages(kNumSenders * kNumMessages);
+  EXPECT(handler.in_order());
+  {
+    MonitorLocker ml(&monitor);
+    while (num_running > 0) {
+      ml.Wait();
+    }
+  }
+
+  // Stop the handler once it has handled a last message.
+  handler_peer.decrement_live_ports();
+  handler_peer.PostMessage(
+      new Message(kNumSenders, 0, NULL, Message::kNormalPriority));
+  handler.WaitForEnd();
+}
+
 }  // namespace dart
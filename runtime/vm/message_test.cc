@@ -4,6 +4,7 @@
 
 #include "platform/assert.h"
 #include "vm/message.h"
+#include "vm/thread.h"
 #include "vm/unit_test.h"
 
 namespace dart {
@@ -17,7 +18,7 @@ class MessageQueueTestPeer {
   bool HasMessage() const {
     // We don't really need to grab the monitor during the unit test,
     // but it doesn't hurt.
-    bool result = (queue_->head_ != NULL);
+    bool result = (queue_->head_ != NULL) || (queue_->incoming_ != NULL);
     return result;
   }
 
@@ -153,4 +154,66 @@ TEST_CASE(MessageQueue_Flush_EmptyQueue) {
   EXPECT(!queue_peer.HasMessage());
 }
 
+
+struct EnqueueInfo {
+  MessageQueue* queue;
+  Dart_Port port;
+  intptr_t count;
+  Monitor* monitor;
+  intptr_t* num_running;
+};
+
+
+static void EnqueueMessages(uword param) {
+  EnqueueInfo* info = reinterpret_cast<EnqueueInfo*>(param);
+  for (intptr_t i = 0; i < info->count; i++) {
+    // The reply port holds the sequence number of the message.
+    info->queue->Enqueue(
+        new Message(info->port, i, NULL, Message::kNormalPriority));
+  }
+  MonitorLocker ml(info->monitor);
+  (*info->num_running)--;
+  ml.Notify();
+}
+
+
+TEST_CASE(MessageQueue_ConcurrentEnqueue) {
+  const intptr_t kNumThreads = 4;
+  const intptr_t kNumMessages = 10000;
+  MessageQueue queue;
+  Monitor monitor;
+  intptr_t num_running = kNumThreads;
+  EnqueueInfo infos[kNumThreads];
+  for (intptr_t i = 0; i < kNumThreads; i++) {
+    infos[i].queue = &queue;
+    infos[i].port = i;
+    infos[i].count = kNumMessages;
+    infos[i].monitor = &monitor;
+    infos[i].num_running = &num_running;
+    Thread::Start(EnqueueMessages, reinterpret_cast<uword>(&infos[i]));
+  }
+
+  // Dequeue while the messages are being enqueued. The messages of each
+  // thread arrive in the order in which they were sent.
+  intptr_t next[kNumThreads] = { 0 };
+  intptr_t received = 0;
+  while (received < kNumThreads * kNumMessages) {
+    Message* msg = queue.Dequeue();
+    if (msg == NULL) {
+      continue;
+    }
+    intptr_t thread = msg->dest_port();
+    EXPECT_EQ(next[thread], msg->reply_port());
+    next[thread]++;
+    received++;
+    delete msg;
+  }
+  EXPECT(queue.Dequeue() == NULL);
+
+  MonitorLocker ml(&monitor);
+  while (num_running > 0) {
+    ml.Wait();
+  }
+}
+
 }  // namespace dart
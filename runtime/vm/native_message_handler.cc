@@ -54,7 +54,8 @@ bool NativeMessageHandler::HandleMessage(Message* message) {
       message->data())[Snapshot::kLengthIndex];
   ApiMessageReader reader(message->data() + Snapshot::kHeaderSize,
                           length,
-                          zone_allocator);
+                          zone_allocator,
+                          message->buffers());
   Dart_CObject* object = reader.ReadMessage();
   (*func())(message->dest_port(), message->reply_port(), object);
   delete message;
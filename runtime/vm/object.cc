@@ -1086,9 +1086,9 @@ void Class::InitEmptyFields() {
     return;
   }
   StorePointer(&raw_ptr()->interfaces_, empty_array.raw());
-  // TODO(srdjan): Make functions_cache growable and start with a smaller size.
-  Array& fcache =
-      Array::Handle(Array::New(FunctionsCache::kNumEntries * 32, Heap::kOld));
+  Array& fcache = Array::Handle(Array::New(
+      FunctionsCache::kNumEntries * FunctionsCache::kInitialCapacity,
+      Heap::kOld));
   StorePointer(&raw_ptr()->functions_cache_, fcache.raw());
   StorePointer(&raw_ptr()->constants_, empty_array.raw());
   StorePointer(&raw_ptr()->canonical_types_, empty_array.raw());
@@ -1119,6 +1119,7 @@ void Class::SetFunctions(const Array& value) const {
     func.set_owner(*this);
   }
   StorePointer(&raw_ptr()->functions_, value.raw());
+  StorePointer(&raw_ptr()->functions_index_, Array::null());
 }
 
 
@@ -1364,6 +1365,9 @@ void Class::Finalize() const {
     // Compute offsets of instance fields and instance size.
     CalculateFieldOffsets();
   }
+  // The indexes are rebuilt on the next lookup.
+  StorePointer(&raw_ptr()->functions_index_, Array::null());
+  StorePointer(&raw_ptr()->fields_index_, Array::null());
   set_is_finalized();
 }
 
@@ -1381,6 +1385,7 @@ void Class::SetFields(const Array& value) const {
   }
   // The value of static fields is already initialized to null.
   StorePointer(&raw_ptr()->fields_, value.raw());
+  StorePointer(&raw_ptr()->fields_index_, Array::null());
 }
 
 
@@ -1954,10 +1959,132 @@ static bool MatchesPrivateName(const String& name, const String& private_name) {
 }
 
 
+// Classes with at least this many functions or fields get hash indexes of
+// them, smaller classes are searched linearly.
+static const intptr_t kMinMembersForIndex = 16;
+
+
+// Hashes the prefix followed by the name up to the private key separator, so
+// that a private name hashes like the name it is looked up by.
+static intptr_t MemberNameHash(const char* prefix,
+                               intptr_t prefix_length,
+                               const String& name) {
+  uintptr_t hash = 0;
+  for (intptr_t i = 0; i < prefix_length; i++) {
+    hash += prefix[i];
+    hash += hash << 10;
+    hash ^= hash >> 6;
+  }
+  intptr_t len = name.Length();
+  for (intptr_t i = 0; i < len; i++) {
+    int32_t ch = name.CharAt(i);
+    if (ch == Scanner::kPrivateKeySeparator) {
+      break;
+    }
+    hash += ch;
+    hash += hash << 10;
+    hash ^= hash >> 6;
+  }
+  hash += hash << 3;
+  hash ^= hash >> 11;
+  hash += hash << 15;
+  return static_cast<intptr_t>(hash & kMaxInt32);
+}
+
+
+// Returns an open addressed hash table of the positions of the members in
+// the array, keyed by the MemberNameHash of their names.
+template<typename T>
+static RawArray* NewMemberIndex(const Array& members) {
+  const intptr_t len = members.Length();
+  const intptr_t capacity = Utils::RoundUpToPowerOfTwo(2 * len);
+  const intptr_t mask = capacity - 1;
+  const Array& index = Array::Handle(Array::New(capacity, Heap::kOld));
+  T& member = T::Handle();
+  String& member_name = String::Handle();
+  Smi& position = Smi::Handle();
+  for (intptr_t i = 0; i < len; i++) {
+    member ^= members.At(i);
+    member_name = member.name();
+    intptr_t probe = MemberNameHash(NULL, 0, member_name) & mask;
+    while (index.At(probe) != Object::null()) {
+      probe = (probe + 1) & mask;
+    }
+    position = Smi::New(i);
+    index.SetAt(probe, position);
+  }
+  return index.raw();
+}
+
+
+// Returns the first of the members whose name matches the prefix followed by
+// the name. Without a prefix, private names also match the name without their
+// private key. The result is the same as the one of a linear search.
+template<typename T>
+static RawObject* LookupMemberInIndex(const Array& members,
+                                      const Array& index,
+                                      const char* prefix,
+                                      intptr_t prefix_length,
+                                      const String& name) {
+  const intptr_t mask = index.Length() - 1;
+  intptr_t probe = MemberNameHash(prefix, prefix_length, name) & mask;
+  intptr_t found = members.Length();
+  T& member = T::Handle();
+  String& member_name = String::Handle();
+  Smi& position = Smi::Handle();
+  while (index.At(probe) != Object::null()) {
+    position ^= index.At(probe);
+    if (position.Value() < found) {
+      member ^= members.At(position.Value());
+      member_name = member.name();
+      bool matches = (prefix == NULL)
+          ? (member_name.Equals(name) || MatchesPrivateName(member_name, name))
+          : MatchesAccessorName(member_name, prefix, prefix_length, name);
+      if (matches) {
+        found = position.Value();
+      }
+    }
+    probe = (probe + 1) & mask;
+  }
+  return (found < members.Length()) ? members.At(found) : Object::null();
+}
+
+
+RawArray* Class::FunctionsIndex() const {
+  if (raw_ptr()->functions_index_ == Array::null()) {
+    const Array& funcs = Array::Handle(functions());
+    if (funcs.Length() < kMinMembersForIndex) {
+      return Array::null();
+    }
+    const Array& index = Array::Handle(NewMemberIndex<Function>(funcs));
+    StorePointer(&raw_ptr()->functions_index_, index.raw());
+  }
+  return raw_ptr()->functions_index_;
+}
+
+
+RawArray* Class::FieldsIndex() const {
+  if (raw_ptr()->fields_index_ == Array::null()) {
+    const Array& flds = Array::Handle(fields());
+    if (flds.Length() < kMinMembersForIndex) {
+      return Array::null();
+    }
+    const Array& index = Array::Handle(NewMemberIndex<Field>(flds));
+    StorePointer(&raw_ptr()->fields_index_, index.raw());
+  }
+  return raw_ptr()->fields_index_;
+}
+
+
 RawFunction* Class::LookupFunction(const String& name) const {
   Isolate* isolate = Isolate::Current();
   Array& funcs = Array::Handle(isolate, functions());
   Function& function = Function::Handle(isolate, Function::null());
+  const Array& index = Array::Handle(isolate, FunctionsIndex());
+  if (!index.IsNull()) {
+    function ^= LookupMemberInIndex<Function>(funcs, index, NULL, 0, name);
+    return function.raw();
+  }
   String& function_name = String::Handle(isolate, String::null());
   intptr_t len = funcs.Length();
   for (intptr_t i = 0; i < len; i++) {
@@ -1989,6 +2116,12 @@ RawFunction* Class::LookupAccessorFunction(const char* prefix,
   Isolate* isolate = Isolate::Current();
   Array& funcs = Array::Handle(isolate, functions());
   Function& function = Function::Handle(isolate, Function::null());
+  const Array& index = Array::Handle(isolate, FunctionsIndex());
+  if (!index.IsNull()) {
+    function ^= LookupMemberInIndex<Function>(
+        funcs, index, prefix, prefix_length, name);
+    return function.raw();
+  }
   String& function_name = String::Handle(isolate, String::null());
   intptr_t len = funcs.Length();
   for (intptr_t i = 0; i < len; i++) {
@@ -2060,6 +2193,11 @@ RawField* Class::LookupField(const String& name) const {
   Isolate* isolate = Isolate::Current();
   const Array& flds = Array::Handle(isolate, fields());
   Field& field = Field::Handle(isolate, Field::null());
+  const Array& index = Array::Handle(isolate, FieldsIndex());
+  if (!index.IsNull()) {
+    field ^= LookupMemberInIndex<Field>(flds, index, NULL, 0, name);
+    return field.raw();
+  }
   String& field_name = String::Handle(isolate, String::null());
   intptr_t len = flds.Length();
   for (intptr_t i = 0; i < len; i++) {
@@ -4348,63 +4486,26 @@ void TokenStream::SetLength(intptr_t value) const {
 }
 
 
-void TokenStream::SetTokenAt(intptr_t index,
-                             Token::Kind kind,
-                             const String& literal) {
-  if (kind == Token::kIDENT) {
-    if (FLAG_compiler_stats) {
-      CompilerStats::num_ident_tokens_total += 1;
-    }
-    StorePointer(EntryAddr(index), reinterpret_cast<RawObject*>(literal.raw()));
-  } else if (Token::NeedsLiteralToken(kind)) {
-    if (FLAG_compiler_stats) {
-      CompilerStats::num_literal_tokens_total += 1;
-    }
-    StorePointer(
-        EntryAddr(index),
-        reinterpret_cast<RawObject*>(LiteralToken::New(kind, literal)));
-  } else {
-    ASSERT(kind < Token::kNumTokens);
-    *(SmiAddr(index)) = Smi::New(kind);
-  }
+void TokenStream::set_literals(const Array& value) const {
+  StorePointer(&raw_ptr()->literals_, value.raw());
 }
 
 
-void TokenStream::SetTokenAt(intptr_t index, const Object& token) {
-  StorePointer(EntryAddr(index), token.raw());
+Token::Kind TokenStream::KindAt(intptr_t index) const {
+  Iterator iterator(*this, index);
+  return iterator.CurrentTokenKind();
 }
 
 
 RawObject* TokenStream::TokenAt(intptr_t index) const {
-  return *EntryAddr(index);
+  Iterator iterator(*this, index);
+  return iterator.CurrentToken();
 }
 
 
 RawString* TokenStream::LiteralAt(intptr_t index) const {
-  const Object& obj = Object::Handle(TokenAt(index));
-  if (obj.IsString()) {
-    return reinterpret_cast<RawString*>(obj.raw());
-  } else if (obj.IsSmi()) {
-    Token::Kind kind = static_cast<Token::Kind>(
-        Smi::Value(reinterpret_cast<RawSmi*>(obj.raw())));
-    ASSERT(kind < Token::kNumTokens);
-    if (Token::IsPseudoKeyword(kind) || Token::IsKeyword(kind)) {
-      Isolate* isolate = Isolate::Current();
-      ObjectStore* object_store = isolate->object_store();
-      String& str = String::Handle(isolate, String::null());
-      const Array& symbols = Array::Handle(isolate,
-                                           object_store->keyword_symbols());
-      ASSERT(!symbols.IsNull());
-      str ^= symbols.At(kind - Token::kFirstKeyword);
-      ASSERT(!str.IsNull());
-      return str.raw();
-    }
-    return String::NewSymbol(Token::Str(kind));
-  } else {
-    LiteralToken& token = LiteralToken::Handle();
-    token ^= obj.raw();  // Must be a literal token.
-    return token.literal();
-  }
+  Iterator iterator(*this, index);
+  return iterator.CurrentLiteral();
 }
 
 
@@ -4414,54 +4515,277 @@ RawString* TokenStream::GenerateSource() const {
   String& literal = String::Handle();
   String& blank = String::Handle(String::New(" "));
   String& newline = String::Handle(String::New("\n"));
-  for (intptr_t i = 0; i < Length(); i++) {
-    Token::Kind kind = KindAt(i);
-    literal = LiteralAt(i);
+  Iterator iterator(*this, 0);
+  while (iterator.CurrentIndex() < Length()) {
+    Token::Kind kind = iterator.CurrentTokenKind();
+    literal = iterator.CurrentLiteral();
     literals.Add(literal);
     if (kind == Token::kLBRACE) {
       literals.Add(newline);
     } else {
       literals.Add(blank);
     }
+    iterator.Advance();
   }
   const Array& source = Array::Handle(Array::MakeArray(literals));
   return String::ConcatAll(source);
 }
 
 
-RawTokenStream* TokenStream::New(intptr_t len) {
+RawTokenStream* TokenStream::New(intptr_t data_length) {
   const Class& token_stream_class = Class::Handle(Object::token_stream_class());
   TokenStream& result = TokenStream::Handle();
   {
     RawObject* raw = Object::Allocate(token_stream_class,
-                                      TokenStream::InstanceSize(len),
+                                      TokenStream::InstanceSize(data_length),
                                       Heap::kOld);
     NoGCScope no_gc;
     result ^= raw;
-    result.SetLength(len);
+    result.SetLength(0);
+    result.raw_ptr()->data_length_ = data_length;
   }
   return result.raw();
 }
 
 
+static void WriteVarint(intptr_t value, GrowableArray<uint8_t>* data) {
+  ASSERT(value >= 0);
+  while (value >= 0x80) {
+    data->Add(static_cast<uint8_t>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  data->Add(static_cast<uint8_t>(value));
+}
+
+
 RawTokenStream* TokenStream::New(const Scanner::GrowableTokenStream& tokens) {
-  intptr_t len = tokens.length();
+  const intptr_t len = tokens.length();
+  const intptr_t num_checkpoints =
+      (len + kCheckpointInterval - 1) / kCheckpointInterval;
 
-  TokenStream& result = TokenStream::Handle(New(len));
-  // Copy the relevant data out of the scanner's token stream.
-  const String& empty_literal = String::Handle();
+  // Assign an index to each distinct identifier and literal. The table
+  // holds indexes into 'literal_kinds' and 'literal_strings', or -1.
+  GrowableArray<Token::Kind> literal_kinds;
+  GrowableArray<const String*> literal_strings;
+  const intptr_t capacity = Utils::RoundUpToPowerOfTwo(2 * len + 2);
+  GrowableArray<intptr_t> table(capacity);
+  for (intptr_t i = 0; i < capacity; i++) {
+    table.Add(-1);
+  }
+  GrowableArray<uint8_t> data(4 * num_checkpoints + 2 * len);
+  for (intptr_t i = 0; i < num_checkpoints; i++) {
+    for (intptr_t b = 0; b < 4; b++) {
+      data.Add(0);
+    }
+  }
   for (intptr_t i = 0; i < len; i++) {
-    Scanner::TokenDescriptor token = tokens[i];
-    if (token.literal != NULL) {
-      result.SetTokenAt(i, token.kind, *(token.literal));
+    if ((i % kCheckpointInterval) == 0) {
+      reinterpret_cast<uint32_t*>(&data[0])[i / kCheckpointInterval] =
+          data.length();
+    }
+    const Scanner::TokenDescriptor& token = tokens[i];
+    ASSERT(token.kind < Token::kNumTokens);
+    WriteVarint(token.kind, &data);
+    if ((token.kind != Token::kIDENT) &&
+        !Token::NeedsLiteralToken(token.kind)) {
+      continue;
+    }
+    if (FLAG_compiler_stats) {
+      if (token.kind == Token::kIDENT) {
+        CompilerStats::num_ident_tokens_total += 1;
+      } else {
+        CompilerStats::num_literal_tokens_total += 1;
+      }
+    }
+    const String* literal = token.literal;
+    intptr_t literal_index = -1;
+    if ((literal != NULL) && !literal->IsNull()) {
+      intptr_t probe = (literal->Hash() + token.kind) & (capacity - 1);
+      while (table[probe] != -1) {
+        const intptr_t entry = table[probe];
+        if ((literal_kinds[entry] == token.kind) &&
+            literal_strings[entry]->Equals(*literal)) {
+          literal_index = entry;
+          break;
+        }
+        probe = (probe + 1) & (capacity - 1);
+      }
+      if (literal_index == -1) {
+        table[probe] = literal_kinds.length();
+      }
+    }
+    if (literal_index == -1) {
+      literal_index = literal_kinds.length();
+      literal_kinds.Add(token.kind);
+      literal_strings.Add(literal);
+    }
+    WriteVarint(literal_index, &data);
+  }
+
+  const intptr_t num_literals = literal_kinds.length();
+  const Array& literals =
+      Array::Handle(Array::New(num_literals, Heap::kOld));
+  const String& empty_literal = String::Handle();
+  for (intptr_t i = 0; i < num_literals; i++) {
+    const String& literal = (literal_strings[i] != NULL) ?
+        *literal_strings[i] : empty_literal;
+    if (literal_kinds[i] == Token::kIDENT) {
+      literals.SetAt(i, literal);
     } else {
-      result.SetTokenAt(i, token.kind, empty_literal);
+      literals.SetAt(i, Object::Handle(
+          LiteralToken::New(literal_kinds[i], literal)));
     }
   }
+
+  const TokenStream& result = TokenStream::Handle(New(data.length()));
+  result.SetLength(len);
+  result.set_literals(literals);
+  if (data.length() > 0) {
+    NoGCScope no_gc;
+    memmove(result.DataAddr(0), &data[0], data.length());
+  }
   return result.raw();
 }
 
 
+TokenStream::Iterator::Iterator(const TokenStream& tokens,
+                                intptr_t token_index)
+    : tokens_(tokens),
+      cur_index_(-1),
+      cur_offset_(0),
+      next_offset_(0),
+      cur_kind_(Token::kEOS),
+      cur_literal_index_(-1) {
+  SetCurrentIndex(token_index);
+}
+
+
+intptr_t TokenStream::Iterator::ReadToken(intptr_t offset,
+                                          Token::Kind* kind,
+                                          intptr_t* literal_index) const {
+  NoGCScope no_gc;
+  const uint8_t* data = tokens_.DataAddr(0);
+  intptr_t value = 0;
+  intptr_t shift = 0;
+  uint8_t byte;
+  do {
+    byte = data[offset++];
+    value |= static_cast<intptr_t>(byte & 0x7F) << shift;
+    shift += 7;
+  } while ((byte & 0x80) != 0);
+  *kind = static_cast<Token::Kind>(value);
+  ASSERT(*kind < Token::kNumTokens);
+  *literal_index = -1;
+  if ((*kind == Token::kIDENT) || Token::NeedsLiteralToken(*kind)) {
+    value = 0;
+    shift = 0;
+    do {
+      byte = data[offset++];
+      value |= static_cast<intptr_t>(byte & 0x7F) << shift;
+      shift += 7;
+    } while ((byte & 0x80) != 0);
+    *literal_index = value;
+  }
+  return offset;
+}
+
+
+void TokenStream::Iterator::SetCurrentIndex(intptr_t index) {
+  ASSERT(index >= 0);
+  if (index == cur_index_) {
+    return;
+  }
+  if ((index > cur_index_) &&
+      (cur_index_ >= 0) &&
+      (index - cur_index_) < kCheckpointInterval) {
+    while (cur_index_ < index) {
+      Advance();
+    }
+    return;
+  }
+  if (index >= tokens_.Length()) {
+    cur_index_ = index;
+    cur_kind_ = Token::kEOS;
+    cur_literal_index_ = -1;
+    return;
+  }
+  cur_index_ = index - (index % kCheckpointInterval);
+  next_offset_ = tokens_.CheckpointAt(index / kCheckpointInterval);
+  cur_offset_ = next_offset_;
+  next_offset_ = ReadToken(cur_offset_, &cur_kind_, &cur_literal_index_);
+  while (cur_index_ < index) {
+    Advance();
+  }
+}
+
+
+Token::Kind TokenStream::Iterator::LookaheadTokenKind(
+    intptr_t num_tokens) const {
+  ASSERT(num_tokens >= 0);
+  if (num_tokens == 0) {
+    return cur_kind_;
+  }
+  if (cur_index_ + num_tokens >= tokens_.Length()) {
+    return Token::kEOS;
+  }
+  Token::Kind kind = cur_kind_;
+  intptr_t literal_index;
+  intptr_t offset = next_offset_;
+  for (intptr_t i = 0; i < num_tokens; i++) {
+    offset = ReadToken(offset, &kind, &literal_index);
+  }
+  return kind;
+}
+
+
+RawObject* TokenStream::Iterator::CurrentToken() const {
+  if (cur_literal_index_ < 0) {
+    return Smi::New(cur_kind_);
+  }
+  const Array& literals = Array::Handle(tokens_.literals());
+  return literals.At(cur_literal_index_);
+}
+
+
+RawString* TokenStream::Iterator::CurrentLiteral() const {
+  if (cur_literal_index_ >= 0) {
+    const Array& literals = Array::Handle(tokens_.literals());
+    if (cur_kind_ == Token::kIDENT) {
+      String& ident = String::Handle();
+      ident ^= literals.At(cur_literal_index_);
+      return ident.raw();
+    }
+    LiteralToken& token = LiteralToken::Handle();
+    token ^= literals.At(cur_literal_index_);
+    return token.literal();
+  }
+  if (Token::IsPseudoKeyword(cur_kind_) || Token::IsKeyword(cur_kind_)) {
+    Isolate* isolate = Isolate::Current();
+    ObjectStore* object_store = isolate->object_store();
+    String& str = String::Handle(isolate, String::null());
+    const Array& symbols = Array::Handle(isolate,
+                                         object_store->keyword_symbols());
+    ASSERT(!symbols.IsNull());
+    str ^= symbols.At(cur_kind_ - Token::kFirstKeyword);
+    ASSERT(!str.IsNull());
+    return str.raw();
+  }
+  return String::NewSymbol(Token::Str(cur_kind_));
+}
+
+
+void TokenStream::Iterator::Advance() {
+  cur_index_++;
+  if (cur_index_ >= tokens_.Length()) {
+    cur_kind_ = Token::kEOS;
+    cur_literal_index_ = -1;
+    return;
+  }
+  cur_offset_ = next_offset_;
+  next_offset_ = ReadToken(cur_offset_, &cur_kind_, &cur_literal_index_);
+}
+
+
 const char* TokenStream::ToCString() const {
   return "TokenStream";
 }
@@ -5421,9 +5745,10 @@ RawLibrary* Library::New() {
 RawLibrary* Library::NewLibraryHelper(const String& url,
                                       bool import_core_lib) {
   const Library& result = Library::Handle(Library::New());
-  result.raw_ptr()->name_ = url.raw();
-  result.raw_ptr()->url_ = url.raw();
-  result.raw_ptr()->private_key_ = Scanner::AllocatePrivateKey(result);
+  result.StorePointer(&result.raw_ptr()->name_, url.raw());
+  result.StorePointer(&result.raw_ptr()->url_, url.raw());
+  result.StorePointer(&result.raw_ptr()->private_key_,
+                      Scanner::AllocatePrivateKey(result));
   result.raw_ptr()->dictionary_ = Array::Empty();
   result.raw_ptr()->anonymous_classes_ = Array::Empty();
   result.raw_ptr()->num_anonymous_ = 0;
@@ -6377,7 +6702,14 @@ RawCode* Code::FinalizeCode(const char* name, Assembler* assembler) {
       int offset_in_instrs = pointer_offsets[i];
       code.SetPointerOffsetAt(i, offset_in_instrs);
       const Object* object = region.Load<const Object*>(offset_in_instrs);
-      region.Store<RawObject*>(offset_in_instrs, object->raw());
+      RawObject* raw_object = object->raw();
+      region.Store<RawObject*>(offset_in_instrs, raw_object);
+      // Embedded pointers are written without a write barrier, record the
+      // ones that refer to new space objects in the store buffer.
+      if (raw_object->IsHeapObject() && raw_object->IsNewObject()) {
+        Isolate::Current()->store_buffer()->AddPointer(
+            region.start() + offset_in_instrs);
+      }
     }
 
     // Hook up Code and Instruction objects.
@@ -6398,19 +6730,12 @@ RawCode* Code::FinalizeCode(const Function& function, Assembler* assembler) {
 }
 
 
-// Check if object matches find condition.
-bool Code::FindRawCodeVisitor::FindObject(RawObject* obj) {
-  return RawInstructions::ContainsPC(obj, pc_);
-}
-
-
 RawCode* Code::LookupCode(uword pc) {
   Isolate* isolate = Isolate::Current();
   NoGCScope no_gc;
-  FindRawCodeVisitor visitor(pc);
-  RawInstructions* instr;
-  instr = isolate->heap()->FindObjectInCodeSpace(&visitor);
-  if (instr != Instructions::null()) {
+  RawInstructions* instr = isolate->heap()->FindInstructionsInCodeSpace(pc);
+  if ((instr != Instructions::null()) &&
+      RawInstructions::ContainsPC(instr, pc)) {
     return instr->ptr()->code_;
   }
   return Code::null();
@@ -6674,7 +6999,7 @@ void ICData::set_ic_data(const Array& value) const {
 
 
 intptr_t ICData::TestEntryLength() const {
-  return num_args_tested() + 1 /* target function*/;
+  return TestEntryLengthFor(num_args_tested());
 }
 
 
@@ -6685,7 +7010,8 @@ intptr_t ICData::NumberOfChecks() const {
 
 
 void ICData::AddCheck(const GrowableArray<intptr_t>& class_ids,
-                      const Function& target) const {
+                      const Function& target,
+                      intptr_t count) const {
   ASSERT(num_args_tested() > 1);  // Otherwise use 'AddReceiverCheck'.
   ASSERT(class_ids.length() == num_args_tested());
   intptr_t old_num = NumberOfChecks();
@@ -6702,11 +7028,13 @@ void ICData::AddCheck(const GrowableArray<intptr_t>& class_ids,
   }
   ASSERT(!target.IsNull());
   data.SetAt(data_pos, target);
+  SetCountAt(old_num, count);
 }
 
 
 void ICData::AddReceiverCheck(intptr_t receiver_class_id,
-                              const Function& target) const {
+                              const Function& target,
+                              intptr_t count) const {
   ASSERT(num_args_tested() == 1);  // Otherwise use 'AddCheck'.
   // Not supporting collection of null receivers.
   ASSERT(receiver_class_id != kNullClass);
@@ -6724,13 +7052,17 @@ void ICData::AddReceiverCheck(intptr_t receiver_class_id,
     const intptr_t zero_class_id = GetReceiverClassIdAt(0);
     ASSERT(zero_class_id != kSmi);  // Simple duplicate entry check.
     const Function& zero_target = Function::Handle(GetTargetAt(0));
+    const intptr_t zero_count = GetCountAt(0);
     data.SetAt(0, Smi::Handle(Smi::New(receiver_class_id)));
     data.SetAt(1, target);
+    SetCountAt(0, count);
     data.SetAt(data_pos, Smi::Handle(Smi::New(zero_class_id)));
     data.SetAt(data_pos + 1, zero_target);
+    SetCountAt(old_num, zero_count);
   } else {
     data.SetAt(data_pos, Smi::Handle(Smi::New(receiver_class_id)));
     data.SetAt(data_pos + 1, target);
+    SetCountAt(old_num, count);
   }
 }
 
@@ -6784,6 +7116,25 @@ RawFunction* ICData::GetTargetAt(intptr_t index) const {
 }
 
 
+intptr_t ICData::GetCountAt(intptr_t index) const {
+  const Array& data = Array::Handle(ic_data());
+  const intptr_t data_pos =
+      index * TestEntryLength() + CountIndexFor(num_args_tested());
+  Smi& smi = Smi::Handle();
+  smi ^= data.At(data_pos);
+  return smi.Value();
+}
+
+
+void ICData::SetCountAt(intptr_t index, intptr_t value) const {
+  ASSERT(Smi::IsValid(value));
+  const Array& data = Array::Handle(ic_data());
+  const intptr_t data_pos =
+      index * TestEntryLength() + CountIndexFor(num_args_tested());
+  data.SetAt(data_pos, Smi::Handle(Smi::New(value)));
+}
+
+
 RawICData* ICData::New(const Function& function,
                        const String& target_name,
                        intptr_t id,
@@ -6802,7 +7153,7 @@ RawICData* ICData::New(const Function& function,
   result.set_target_name(target_name);
   result.set_id(id);
   result.set_num_args_tested(num_args_tested);
-  // Number of array elements in one test entry (num_args_tested + 1)
+  // Number of array elements in one test entry.
   intptr_t len = result.TestEntryLength();
   // IC data array must be null terminated (sentinel entry).
   const Array& ic_data = Array::Handle(Array::New(len, Heap::kOld));
@@ -9914,12 +10265,12 @@ RawClosure* Closure::New(const Function& function,
 
 
 void Closure::set_context(const Context& value) const {
-  raw_ptr()->context_ = value.raw();
+  StorePointer(&raw_ptr()->context_, value.raw());
 }
 
 
 void Closure::set_function(const Function& value) const {
-  raw_ptr()->function_ = value.raw();
+  StorePointer(&raw_ptr()->function_, value.raw());
 }
 
 
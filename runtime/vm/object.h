@@ -365,12 +365,22 @@ CLASS_LIST_NO_OBJECT(DEFINE_CLASS_TESTER);
   }
 
   template<typename type> void StorePointer(type* addr, type value) const {
-    // TODO(iposva): Implement real store barrier here.
     *addr = value;
     // Filter stores based on source and target.
-    if (value->IsNewObject() && raw()->IsOldObject()) {
+    if (!value->IsHeapObject() || !raw()->IsOldObject()) {
+      return;
+    }
+    if (value->IsNewObject()) {
       uword ptr = reinterpret_cast<uword>(addr);
-      Isolate::Current()->store_buffer()->AddPointer(ptr);
+      HeapPage* page = PageSpace::PageFor(raw());
+      if (page->card_table() != NULL) {
+        page->MarkCard(ptr);
+      } else {
+        Isolate::Current()->store_buffer()->AddPointer(ptr);
+      }
+    } else if (PageSpace::PageFor(value)->is_marking() &&
+               !value->IsMarked()) {
+      Isolate::Current()->heap()->MarkingBarrier(value);
     }
   }
 
@@ -757,6 +767,12 @@ class Class : public Object {
                                       intptr_t prefix_length,
                                       const String& name) const;
 
+  // Hash indexes of the functions and fields by name. They are built on
+  // first lookup in classes with many members and cleared when the members
+  // change. Returns null for classes that are searched linearly.
+  RawArray* FunctionsIndex() const;
+  RawArray* FieldsIndex() const;
+
   // Allocate an instance class which has a VM implementation.
   template <class FakeInstance> static RawClass* New(intptr_t id);
   template <class FakeInstance> static RawClass* New(const String& name,
@@ -1675,15 +1691,19 @@ class LiteralToken : public Object {
 };
 
 
+// The tokens of a script in a compact byte encoding. Every token is encoded
+// as its kind followed, for identifiers and literals, by the index of the
+// identifier symbol or LiteralToken in the literals array, both as varints.
+// Each distinct identifier or literal is stored once in the literals array.
+// The byte offset of every kCheckpointInterval-th token is recorded in front
+// of the encoded tokens, so that a token can be found by its index.
 class TokenStream : public Object {
  public:
-  inline intptr_t Length() const;
+  static const intptr_t kCheckpointInterval = 16;
 
-  inline Token::Kind KindAt(intptr_t index) const;
-
-  void SetTokenAt(intptr_t index, Token::Kind kind, const String& literal);
-  void SetTokenAt(intptr_t index, const Object& token);
+  inline intptr_t Length() const;
 
+  Token::Kind KindAt(intptr_t index) const;
   RawObject* TokenAt(intptr_t index) const;
   RawString* LiteralAt(intptr_t index) const;
   RawString* GenerateSource() const;
@@ -1692,26 +1712,69 @@ class TokenStream : public Object {
     ASSERT(sizeof(RawTokenStream) == OFFSET_OF(RawTokenStream, data_));
     return 0;
   }
-  static intptr_t InstanceSize(intptr_t len) {
-    return RoundedAllocationSize(sizeof(RawTokenStream) + (len * kWordSize));
-  }
-  static intptr_t StreamLength(intptr_t len) {
-    return len;
+  static intptr_t InstanceSize(intptr_t data_length) {
+    return RoundedAllocationSize(sizeof(RawTokenStream) + data_length);
   }
 
-  static RawTokenStream* New(intptr_t length);
+  static RawTokenStream* New(intptr_t data_length);
   static RawTokenStream* New(const Scanner::GrowableTokenStream& tokens);
 
+  // Iterates over the tokens of a stream. Moving to the following tokens
+  // decodes them in order, other tokens are found from the closest
+  // checkpoint.
+  class Iterator : public ValueObject {
+   public:
+    Iterator(const TokenStream& tokens, intptr_t token_index);
+
+    intptr_t CurrentIndex() const { return cur_index_; }
+    void SetCurrentIndex(intptr_t index);
+
+    Token::Kind CurrentTokenKind() const { return cur_kind_; }
+    Token::Kind LookaheadTokenKind(intptr_t num_tokens) const;
+
+    // Returns the Smi kind for tokens without literal, otherwise the
+    // identifier symbol or the LiteralToken.
+    RawObject* CurrentToken() const;
+    RawString* CurrentLiteral() const;
+
+    void Advance();
+
+   private:
+    // Decodes the token at 'offset' and returns the offset of the next one.
+    intptr_t ReadToken(intptr_t offset,
+                       Token::Kind* kind,
+                       intptr_t* literal_index) const;
+
+    const TokenStream& tokens_;
+    intptr_t cur_index_;
+    intptr_t cur_offset_;
+    intptr_t next_offset_;
+    Token::Kind cur_kind_;
+    intptr_t cur_literal_index_;  // -1 for tokens without literal.
+
+    DISALLOW_COPY_AND_ASSIGN(Iterator);
+  };
+
  private:
   void SetLength(intptr_t value) const;
 
-  RawObject** EntryAddr(intptr_t index) const {
-    ASSERT((index >=0) && (index < Length()));
-    return &raw_ptr()->data_[index];
+  RawArray* literals() const { return raw_ptr()->literals_; }
+  void set_literals(const Array& value) const;
+
+  intptr_t DataLength() const { return raw_ptr()->data_length_; }
+  uint8_t* DataAddr(intptr_t offset) const {
+    ASSERT((offset >= 0) && (offset < DataLength()));
+    return &raw_ptr()->data_[offset];
   }
 
-  RawSmi** SmiAddr(intptr_t index) const {
-    return reinterpret_cast<RawSmi**>(EntryAddr(index));
+  // Byte offset of the first token of each block of kCheckpointInterval
+  // tokens. The checkpoints are followed by the encoded tokens.
+  intptr_t NumCheckpoints() const {
+    return (Length() + kCheckpointInterval - 1) / kCheckpointInterval;
+  }
+  intptr_t CheckpointAt(intptr_t index) const {
+    ASSERT((index >= 0) && (index < NumCheckpoints()));
+    return reinterpret_cast<uint32_t*>(DataAddr(0))[index];
   }
 
   HEAP_OBJECT_IMPLEMENTATION(TokenStream, Object);
@@ -2375,22 +2438,6 @@ class Code : public Object {
       const GrowableObjectArray& ic_data_objs) const;
 
  private:
-  // An object finder visitor interface.
-  class FindRawCodeVisitor : public FindObjectVisitor {
-   public:
-    explicit FindRawCodeVisitor(uword pc)
-        : FindObjectVisitor(Isolate::Current()), pc_(pc) { }
-    virtual ~FindRawCodeVisitor() { }
-
-    // Check if object matches find condition.
-    virtual bool FindObject(RawObject* obj);
-
-   private:
-    const uword pc_;
-
-    DISALLOW_COPY_AND_ASSIGN(FindRawCodeVisitor);
-  };
-
   static const intptr_t kEntrySize = sizeof(int32_t);  // NOLINT
 
   void set_instructions(RawInstructions* instructions) {
@@ -2476,6 +2523,7 @@ class Context : public Object {
 
   HEAP_OBJECT_IMPLEMENTATION(Context, Object);
   friend class Class;
+  friend class HeapImage;
 };
 
 
@@ -2582,14 +2630,27 @@ class ICData : public Object {
     return OFFSET_OF(RawICData, function_);
   }
 
+  // Each test entry of the IC data array holds the class ids tested, the
+  // target function and the number of calls that matched the entry (Smi).
+  // The count is incremented by the inline cache stubs.
+  static intptr_t TestEntryLengthFor(intptr_t num_args_tested) {
+    return num_args_tested + 1 /* target function */ + 1 /* count */;
+  }
+
+  static intptr_t CountIndexFor(intptr_t num_args_tested) {
+    return num_args_tested + 1;
+  }
+
   // Adds one more class test to ICData. Length of 'classes' must be equal to
   // the number of arguments tested. Use only for number_of_checks > 1.
   void AddCheck(const GrowableArray<intptr_t>& class_ids,
-                const Function& target) const;
+                const Function& target,
+                intptr_t count = 1) const;
   // Adds sorted so that Smi is the first class-id. Use only for
   // number_of_checks == 1.
   void AddReceiverCheck(intptr_t receiver_class_id,
-                        const Function& target) const;
+                        const Function& target,
+                        intptr_t count = 1) const;
   void GetCheckAt(intptr_t index,
                   GrowableArray<intptr_t>* class_ids,
                   Function* target) const;
@@ -2598,6 +2659,8 @@ class ICData : public Object {
 
   intptr_t GetReceiverClassIdAt(intptr_t index) const;
   RawFunction* GetTargetAt(intptr_t index) const;
+  intptr_t GetCountAt(intptr_t index) const;
+  void SetCountAt(intptr_t index, intptr_t value) const;
 
   static RawICData* New(const Function& caller_function,
                         const String& target_name,
@@ -5052,21 +5115,6 @@ intptr_t TokenStream::Length() const {
 }
 
 
-Token::Kind TokenStream::KindAt(intptr_t index) const {
-  const Object& obj = Object::Handle(TokenAt(index));
-  if (obj.IsSmi()) {
-    return static_cast<Token::Kind>(
-        Smi::Value(reinterpret_cast<RawSmi*>(obj.raw())));
-  } else if (obj.IsLiteralToken()) {
-    LiteralToken& token = LiteralToken::Handle();
-    token ^= obj.raw();
-    return token.kind();
-  }
-  ASSERT(obj.IsString());  // Must be an identifier.
-  return Token::kIDENT;
-}
-
-
 void Context::SetAt(intptr_t index, const Instance& value) const {
   StorePointer(InstanceAddr(index), value.raw());
 }
@@ -587,6 +587,7 @@ class ObjectStore {
   RawArray* keyword_symbols_;
   RawObject** to() { return reinterpret_cast<RawObject**>(&keyword_symbols_); }
 
+  friend class HeapImage;
   friend class SnapshotReader;
 
   DISALLOW_COPY_AND_ASSIGN(ObjectStore);
@@ -112,6 +112,76 @@ TEST_CASE(Class) {
 }
 
 
+TEST_CASE(ClassMemberIndex) {
+  // Classes with many members are looked up through hash indexes.
+  String& class_name = String::Handle(String::NewSymbol("ManyMembers"));
+  Script& script = Script::Handle();
+  const Class& cls = Class::Handle(
+      Class::New(class_name, script, Scanner::kDummyTokenIndex));
+  const int kNumMembers = 40;
+  char name[64];
+  const Array& functions = Array::Handle(Array::New(kNumMembers + 2));
+  const Array& fields = Array::Handle(Array::New(kNumMembers));
+  Function& function = Function::Handle();
+  Field& field = Field::Handle();
+  String& member_name = String::Handle();
+  for (int i = 0; i < kNumMembers; i++) {
+    OS::SNPrint(name, sizeof(name), "m%d", i);
+    member_name = String::NewSymbol(name);
+    function = Function::New(
+        member_name, RawFunction::kFunction, false, false, 0);
+    functions.SetAt(i, function);
+    OS::SNPrint(name, sizeof(name), "_f%d@12345", i);
+    member_name = String::NewSymbol(name);
+    field = Field::New(member_name, false, false, 0);
+    fields.SetAt(i, field);
+  }
+  member_name = String::NewSymbol("get:g");
+  function = Function::New(
+      member_name, RawFunction::kGetterFunction, false, false, 0);
+  functions.SetAt(kNumMembers, function);
+  member_name = String::NewSymbol("_p@12345");
+  function = Function::New(
+      member_name, RawFunction::kFunction, false, false, 0);
+  functions.SetAt(kNumMembers + 1, function);
+  cls.SetFunctions(functions);
+  cls.SetFields(fields);
+
+  for (int i = 0; i < kNumMembers; i++) {
+    OS::SNPrint(name, sizeof(name), "m%d", i);
+    member_name = String::New(name);
+    EXPECT_EQ(functions.At(i), cls.LookupFunction(member_name));
+    OS::SNPrint(name, sizeof(name), "_f%d", i);
+    member_name = String::New(name);
+    EXPECT_EQ(fields.At(i), cls.LookupField(member_name));
+  }
+  member_name = String::New("m40");
+  EXPECT(cls.LookupFunction(member_name) == Function::null());
+  member_name = String::New("g");
+  EXPECT_EQ(functions.At(kNumMembers), cls.LookupGetterFunction(member_name));
+  EXPECT(cls.LookupSetterFunction(member_name) == Function::null());
+  EXPECT(cls.LookupFunction(member_name) == Function::null());
+  member_name = String::New("_p");
+  EXPECT_EQ(functions.At(kNumMembers + 1), cls.LookupFunction(member_name));
+  member_name = String::New("_p@12345");
+  EXPECT_EQ(functions.At(kNumMembers + 1), cls.LookupFunction(member_name));
+  member_name = String::New("_f0@12345");
+  EXPECT_EQ(fields.At(0), cls.LookupField(member_name));
+
+  // The index is rebuilt when the functions change.
+  const Array& new_functions = Array::Handle(Array::New(kNumMembers));
+  for (int i = 0; i < kNumMembers; i++) {
+    function ^= functions.At(kNumMembers - 1 - i);
+    new_functions.SetAt(i, function);
+  }
+  cls.SetFunctions(new_functions);
+  member_name = String::New("m0");
+  EXPECT_EQ(functions.At(0), cls.LookupFunction(member_name));
+  member_name = String::New("_p");
+  EXPECT(cls.LookupFunction(member_name) == Function::null());
+}
+
+
 TEST_CASE(TypeArguments) {
   const Type& type1 = Type::Handle(Type::DoubleInterface());
   const Type& type2 = Type::Handle(Type::StringInterface());
@@ -149,6 +219,65 @@ TEST_CASE(TokenStream) {
 }
 
 
+TEST_CASE(TokenStreamIterator) {
+  // Enough tokens for several checkpoints, repeating identifiers and
+  // literals.
+  String& source = String::Handle(String::New(
+      "foo(a, b) { return a + 42 + \"str\"; }\n"
+      "bar(a, b) { return b + 42 + \"str\" + 3.5; }\n"
+      "baz(c) { var d = c; return foo(d, bar(d, 1234567890123)); }\n"));
+  String& private_key = String::Handle(String::New(""));
+  Scanner scanner(source, private_key);
+  const Scanner::GrowableTokenStream& ts = scanner.GetStream();
+  const TokenStream& token_stream = TokenStream::Handle(TokenStream::New(ts));
+  const intptr_t len = ts.length();
+  EXPECT_EQ(len, token_stream.Length());
+  EXPECT(len > 3 * TokenStream::kCheckpointInterval);
+
+  // Random access in both directions.
+  String& literal = String::Handle();
+  for (intptr_t i = len - 1; i >= 0; i--) {
+    EXPECT_EQ(ts[i].kind, token_stream.KindAt(i));
+    if (ts[i].literal != NULL) {
+      literal = token_stream.LiteralAt(i);
+      EXPECT(literal.Equals(*ts[i].literal));
+    }
+  }
+
+  // Repeated identifiers and literals are stored once.
+  EXPECT_EQ(Token::kIDENT, token_stream.KindAt(2));  // a
+  EXPECT_EQ(Token::kIDENT, token_stream.KindAt(8));  // a
+  EXPECT_EQ(token_stream.TokenAt(2), token_stream.TokenAt(8));
+  EXPECT_EQ(Token::kINTEGER, token_stream.KindAt(10));  // 42
+  intptr_t num_integers = 0;
+  for (intptr_t i = 11; i < len; i++) {
+    if (ts[i].kind == Token::kINTEGER) {
+      literal = token_stream.LiteralAt(i);
+      if (literal.Equals("42")) {
+        EXPECT_EQ(token_stream.TokenAt(10), token_stream.TokenAt(i));
+        num_integers++;
+      }
+    }
+  }
+  EXPECT_EQ(1, num_integers);
+
+  // Sequential iteration with lookahead.
+  TokenStream::Iterator iterator(token_stream, 0);
+  for (intptr_t i = 0; i < len; i++) {
+    EXPECT_EQ(i, iterator.CurrentIndex());
+    EXPECT_EQ(ts[i].kind, iterator.CurrentTokenKind());
+    if (i + 2 < len) {
+      EXPECT_EQ(ts[i + 2].kind, iterator.LookaheadTokenKind(2));
+    }
+    iterator.Advance();
+  }
+  EXPECT_EQ(Token::kEOS, iterator.CurrentTokenKind());
+  iterator.SetCurrentIndex(TokenStream::kCheckpointInterval + 3);
+  EXPECT_EQ(ts[TokenStream::kCheckpointInterval + 3].kind,
+            iterator.CurrentTokenKind());
+}
+
+
 TEST_CASE(InstanceClass) {
   // Allocate the class first.
   String& class_name = String::Handle(String::NewSymbol("EmptyClass"));
@@ -2610,6 +2739,22 @@ TEST_CASE(ICData) {
   o1.GetOneClassCheckAt(1, &test_class_id, &test_target);
   EXPECT_EQ(kDouble, test_class_id);
   EXPECT_EQ(target2.raw(), test_target.raw());
+  EXPECT_EQ(1, o1.GetCountAt(0));
+  EXPECT_EQ(1, o1.GetCountAt(1));
+  o1.SetCountAt(1, 5);
+  EXPECT_EQ(1, o1.GetCountAt(0));
+  EXPECT_EQ(5, o1.GetCountAt(1));
+
+  // Adding a Smi check moves it to the front together with its count.
+  ICData& o3 = ICData::Handle();
+  o3 = ICData::New(function, target_name, id, num_args_tested);
+  o3.AddReceiverCheck(kDouble, target2, 3);
+  o3.AddReceiverCheck(kSmi, target1, 7);
+  EXPECT_EQ(2, o3.NumberOfChecks());
+  EXPECT_EQ(kSmi, o3.GetReceiverClassIdAt(0));
+  EXPECT_EQ(7, o3.GetCountAt(0));
+  EXPECT_EQ(kDouble, o3.GetReceiverClassIdAt(1));
+  EXPECT_EQ(3, o3.GetCountAt(1));
 
   ICData& o2 = ICData::Handle();
   o2 = ICData::New(function, target_name, 57, 2);
@@ -2627,6 +2772,7 @@ TEST_CASE(ICData) {
   EXPECT_EQ(kSmi, test_class_ids[0]);
   EXPECT_EQ(kSmi, test_class_ids[1]);
   EXPECT_EQ(target1.raw(), test_target.raw());
+  EXPECT_EQ(1, o2.GetCountAt(0));
 }
 
 
@@ -0,0 +1,150 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/optimization_queue.h"
+
+#include "vm/compiler.h"
+#include "vm/dart.h"
+#include "vm/debugger.h"
+#include "vm/exceptions.h"
+#include "vm/isolate.h"
+#include "vm/object.h"
+#include "vm/thread_pool.h"
+#include "vm/visitor.h"
+
+namespace dart {
+
+DEFINE_FLAG(bool, queue_optimizations, false,
+            "Queue hot functions and optimize them at later stack checks "
+            "instead of in the invocation reaching the threshold.");
+DEFINE_FLAG(int, optimization_interval, 1,
+            "Milliseconds between the optimizations of queued functions.");
+DECLARE_FLAG(bool, trace_compiler);
+
+
+class OptimizationPacerTask : public ThreadPool::Task {
+ public:
+  explicit OptimizationPacerTask(OptimizationQueue* queue) : queue_(queue) {}
+
+  virtual void Run() {
+    queue_->Pace();
+  }
+
+ private:
+  OptimizationQueue* queue_;
+
+  DISALLOW_COPY_AND_ASSIGN(OptimizationPacerTask);
+};
+
+
+OptimizationQueue::OptimizationQueue(Isolate* isolate)
+    : isolate_(isolate),
+      functions_(NULL),
+      length_(0),
+      capacity_(0),
+      pacer_running_(false),
+      shutting_down_(false) {
+}
+
+
+OptimizationQueue::~OptimizationQueue() {
+  monitor_.Enter();
+  shutting_down_ = true;
+  monitor_.NotifyAll();
+  while (pacer_running_) {
+    monitor_.Wait(Monitor::kNoTimeout);
+  }
+  monitor_.Exit();
+  delete[] functions_;
+}
+
+
+void OptimizationQueue::Add(const Function& function) {
+  monitor_.Enter();
+  for (intptr_t i = 0; i < length_; i++) {
+    if (functions_[i] == function.raw()) {
+      monitor_.Exit();
+      return;
+    }
+  }
+  if (length_ == capacity_) {
+    intptr_t new_capacity = (capacity_ == 0) ? 8 : (capacity_ * 2);
+    RawFunction** new_functions = new RawFunction*[new_capacity];
+    for (intptr_t i = 0; i < length_; i++) {
+      new_functions[i] = functions_[i];
+    }
+    delete[] functions_;
+    functions_ = new_functions;
+    capacity_ = new_capacity;
+  }
+  functions_[length_++] = function.raw();
+  if (!pacer_running_ && !shutting_down_) {
+    pacer_running_ = true;
+    Dart::thread_pool()->Run(new OptimizationPacerTask(this));
+  }
+  monitor_.Exit();
+}
+
+
+void OptimizationQueue::OptimizeNext() {
+  Function& function = Function::Handle();
+  monitor_.Enter();
+  if (length_ == 0) {
+    monitor_.Exit();
+    return;
+  }
+  function ^= functions_[0];
+  length_--;
+  for (intptr_t i = 0; i < length_; i++) {
+    functions_[i] = functions_[i + 1];
+  }
+  const intptr_t num_left = length_;
+  monitor_.Exit();
+
+  if (isolate_->debugger()->IsActive()) {
+    // We cannot set breakpoints in optimized code, the function has to start
+    // over once the debugger is done.
+    function.set_usage_counter(0);
+    return;
+  }
+  if (function.HasOptimizedCode() || !function.is_optimizable()) {
+    return;
+  }
+  if (FLAG_trace_compiler) {
+    OS::Print("Optimizing queued function '%s', %d left in queue\n",
+              function.ToFullyQualifiedCString(), num_left);
+  }
+  // Compilation patches the entry of unoptimized code.
+  const Error& error =
+      Error::Handle(Compiler::CompileOptimizedFunction(function));
+  if (!error.IsNull()) {
+    Exceptions::PropagateError(error);
+  }
+}
+
+
+void OptimizationQueue::Pace() {
+  const int64_t interval =
+      (FLAG_optimization_interval > 0) ? FLAG_optimization_interval : 1;
+  monitor_.Enter();
+  while (!shutting_down_ && (length_ > 0)) {
+    monitor_.Wait(interval);
+    if (!shutting_down_ && (length_ > 0)) {
+      isolate_->ScheduleInterrupts(Isolate::kOptimizeInterrupt);
+    }
+  }
+  pacer_running_ = false;
+  monitor_.NotifyAll();
+  monitor_.Exit();
+}
+
+
+void OptimizationQueue::VisitObjectPointers(ObjectPointerVisitor* visitor) {
+  if (length_ > 0) {
+    RawObject** first = reinterpret_cast<RawObject**>(&functions_[0]);
+    visitor->VisitPointers(first, first + length_ - 1);
+  }
+}
+
+}  // namespace dart
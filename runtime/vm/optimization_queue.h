@@ -0,0 +1,73 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_OPTIMIZATION_QUEUE_H_
+#define VM_OPTIMIZATION_QUEUE_H_
+
+#include "vm/allocation.h"
+#include "vm/flags.h"
+#include "vm/thread.h"
+
+namespace dart {
+
+// Forward declarations.
+class Function;
+class Isolate;
+class ObjectPointerVisitor;
+class RawFunction;
+
+DECLARE_FLAG(bool, queue_optimizations);
+
+// With --queue_optimizations the functions reaching the optimization
+// threshold are queued instead of being optimized by the invocation which
+// noticed it, and their unoptimized code keeps running.
+//
+// While functions are queued a task on the thread pool requests an interrupt
+// every --optimization_interval milliseconds. The mutator then optimizes the
+// function queued first at its next stack check, which spreads the work of
+// the optimizing compiler over time instead of stalling the isolate on a
+// burst of hot functions. Each compilation still runs on the mutator and
+// stalls it while it lasts. As before the optimized code is installed by
+// patching the entry of the unoptimized code.
+class OptimizationQueue {
+ public:
+  explicit OptimizationQueue(Isolate* isolate);
+
+  // Stops the pacing task, waiting for it to finish.
+  ~OptimizationQueue();
+
+  // Queues the function unless it is already queued.
+  void Add(const Function& function);
+
+  // Optimizes the function queued first, if any. Called by the mutator when
+  // handling the interrupt requested by the pacing task.
+  void OptimizeNext();
+
+  intptr_t length() const { return length_; }
+
+  void VisitObjectPointers(ObjectPointerVisitor* visitor);
+
+ private:
+  // Runs on the thread pool until the queue is empty or shut down.
+  void Pace();
+
+  Isolate* isolate_;
+
+  RawFunction** functions_;
+  intptr_t length_;
+  intptr_t capacity_;
+
+  // Protects the queued functions and the pacing state below.
+  Monitor monitor_;
+  bool pacer_running_;
+  bool shutting_down_;
+
+  friend class OptimizationPacerTask;
+
+  DISALLOW_COPY_AND_ASSIGN(OptimizationQueue);
+};
+
+}  // namespace dart
+
+#endif  // VM_OPTIMIZATION_QUEUE_H_
@@ -0,0 +1,61 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "platform/assert.h"
+#include "vm/class_finalizer.h"
+#include "vm/isolate.h"
+#include "vm/object.h"
+#include "vm/optimization_queue.h"
+#include "vm/os.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+// Compiler only implemented on IA32 and X64 now.
+#if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
+
+TEST_CASE(OptimizationQueue) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static foo() { return 42; }\n"
+      "}\n";
+  String& url = String::Handle(String::New("dart-test:OptimizationQueue"));
+  String& source = String::Handle(String::New(kScriptChars));
+  Script& script = Script::Handle(Script::New(url, source, RawScript::kSource));
+  Library& lib = Library::Handle(Library::CoreLibrary());
+  EXPECT(CompilerTest::TestCompileScript(lib, script));
+  EXPECT(ClassFinalizer::FinalizePendingClasses());
+  Class& cls = Class::Handle(
+      lib.LookupClass(String::Handle(String::NewSymbol("A"))));
+  EXPECT(!cls.IsNull());
+  Function& function_foo = Function::Handle(
+      cls.LookupStaticFunction(String::Handle(String::New("foo"))));
+  EXPECT(!function_foo.IsNull());
+  EXPECT(CompilerTest::TestCompileFunction(function_foo));
+  EXPECT(!function_foo.HasOptimizedCode());
+
+  Isolate* isolate = Isolate::Current();
+  OptimizationQueue* queue = isolate->optimization_queue();
+  queue->Add(function_foo);
+  queue->Add(function_foo);
+  EXPECT_EQ(1, queue->length());
+
+  // The pacing task requests an interrupt while the function is queued.
+  for (intptr_t i = 0; i < 100; i++) {
+    if (isolate->stack_limit() != isolate->saved_stack_limit()) {
+      break;
+    }
+    OS::Sleep(10);
+  }
+  uword interrupt_bits = isolate->GetAndClearInterrupts();
+  EXPECT((interrupt_bits & Isolate::kOptimizeInterrupt) != 0);
+
+  queue->OptimizeNext();
+  EXPECT_EQ(0, queue->length());
+  EXPECT(function_foo.HasOptimizedCode());
+}
+
+#endif  // TARGET_ARCH_IA32 || TARGET_ARCH_X64
+
+}  // namespace dart
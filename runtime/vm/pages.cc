@@ -5,19 +5,31 @@
 #include "vm/pages.h"
 
 #include "platform/assert.h"
+#include "vm/gc_compactor.h"
 #include "vm/gc_marker.h"
 #include "vm/gc_sweeper.h"
 #include "vm/object.h"
+#include "vm/store_buffer.h"
 #include "vm/virtual_memory.h"
 
 namespace dart {
 
+DECLARE_FLAG(bool, compact_old_space);
+
 DEFINE_FLAG(int, heap_growth_space_ratio, 10,
             "The desired maximum percentage of free space after GC");
 DEFINE_FLAG(int, heap_growth_time_ratio, 3,
             "The desired maximum percentage of time spent in GC");
 DEFINE_FLAG(int, heap_growth_rate, 4,
             "The size the heap is grown, in heap pages");
+DEFINE_FLAG(bool, incremental_marking, false,
+            "Mark the old generation in steps interleaved with the mutator "
+            "instead of in a single pause.");
+DEFINE_FLAG(int, marking_step_size, 256,
+            "Kilobytes of objects visited in each incremental marking step.");
+DEFINE_FLAG(bool, lazy_sweeping, true,
+            "Sweep the old generation pages on demand when allocating instead "
+            "of during the mark-sweep pause.");
 
 HeapPage* HeapPage::Initialize(VirtualMemory* memory, bool is_executable) {
   ASSERT(memory->size() > VirtualMemory::PageSize());
@@ -28,6 +40,12 @@ HeapPage* HeapPage::Initialize(VirtualMemory* memory, bool is_executable) {
   result->next_ = NULL;
   result->used_ = 0;
   result->top_ = result->first_object_start();
+  result->card_table_ = NULL;
+  result->marking_ = 0;
+  result->needs_sweeping_ = false;
+  result->object_starts_ = NULL;
+  result->object_starts_length_ = 0;
+  result->object_starts_capacity_ = 0;
   return result;
 }
 
@@ -40,17 +58,112 @@ HeapPage* HeapPage::Allocate(intptr_t size, bool is_executable) {
 
 
 void HeapPage::Deallocate() {
+  delete[] card_table_;
+  delete[] object_starts_;
   // The memory for this object will become unavailable after the delete below.
   delete memory_;
 }
 
 
+void HeapPage::AllocateCardTable() {
+  ASSERT(card_table_ == NULL);
+  card_table_ = new uint8_t[NumberOfCards()];
+  ClearCardTable();
+}
+
+
+void HeapPage::ClearCardTable() {
+  if (card_table_ != NULL) {
+    memset(card_table_, 0, NumberOfCards());
+  }
+}
+
+
+// Forwards the pointers located within [start, end) to the wrapped visitor
+// and marks the cards of the slots still referring to new space afterwards.
+class CardPointerVisitor : public ObjectPointerVisitor {
+ public:
+  CardPointerVisitor(HeapPage* page,
+                     ObjectPointerVisitor* visitor,
+                     uword start,
+                     uword end)
+      : ObjectPointerVisitor(visitor->isolate()),
+        page_(page),
+        visitor_(visitor),
+        start_(reinterpret_cast<RawObject**>(start)),
+        end_(reinterpret_cast<RawObject**>(end)) {}
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    if (first < start_) {
+      first = start_;
+    }
+    if (last >= end_) {
+      last = end_ - 1;
+    }
+    if (first > last) {
+      return;
+    }
+    visitor_->VisitPointers(first, last);
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* raw_obj = *current;
+      if (raw_obj->IsHeapObject() && raw_obj->IsNewObject()) {
+        page_->MarkCard(reinterpret_cast<uword>(current));
+      }
+    }
+  }
+
+ private:
+  HeapPage* page_;
+  ObjectPointerVisitor* visitor_;
+  RawObject** start_;
+  RawObject** end_;
+
+  DISALLOW_COPY_AND_ASSIGN(CardPointerVisitor);
+};
+
+
+void HeapPage::VisitMarkedCards(ObjectPointerVisitor* visitor) {
+  ASSERT(card_table_ != NULL);
+  intptr_t num_cards = NumberOfCards();
+  intptr_t card = 0;
+  while (card < num_cards) {
+    if (card_table_[card] == 0) {
+      card++;
+      continue;
+    }
+    // Clear and visit a run of consecutive marked cards at once.
+    intptr_t run_end = card;
+    while ((run_end < num_cards) && (card_table_[run_end] != 0)) {
+      card_table_[run_end] = 0;
+      run_end++;
+    }
+    uword run_start_addr = start() + (card << kCardSizeLog2);
+    uword run_end_addr = start() + (run_end << kCardSizeLog2);
+    CardPointerVisitor card_visitor(this, visitor,
+                                    run_start_addr, run_end_addr);
+    uword obj_addr = first_object_start();
+    uword end_addr = top();
+    while ((obj_addr < end_addr) && (obj_addr < run_end_addr)) {
+      RawObject* raw_obj = RawObject::FromAddr(obj_addr);
+      intptr_t size = raw_obj->Size();
+      if ((obj_addr + size) > run_start_addr) {
+        raw_obj->VisitPointers(&card_visitor);
+      }
+      obj_addr += size;
+    }
+    card = run_end;
+  }
+}
+
+
 void HeapPage::VisitObjects(ObjectVisitor* visitor) const {
   uword obj_addr = first_object_start();
   uword end_addr = top();
   while (obj_addr < end_addr) {
     RawObject* raw_obj = RawObject::FromAddr(obj_addr);
-    visitor->VisitObject(raw_obj);
+    if (!needs_sweeping_ || raw_obj->IsMarked()) {
+      visitor->VisitObject(raw_obj);
+    }
     obj_addr += raw_obj->Size();
   }
   ASSERT(obj_addr == end_addr);
@@ -62,7 +175,12 @@ void HeapPage::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
   uword end_addr = top();
   while (obj_addr < end_addr) {
     RawObject* raw_obj = RawObject::FromAddr(obj_addr);
-    obj_addr += raw_obj->VisitPointers(visitor);
+    if (!needs_sweeping_ || raw_obj->IsMarked()) {
+      obj_addr += raw_obj->VisitPointers(visitor);
+    } else {
+      // Unreachable objects may refer to freed memory.
+      obj_addr += raw_obj->Size();
+    }
   }
   ASSERT(obj_addr == end_addr);
 }
@@ -73,7 +191,8 @@ RawObject* HeapPage::FindObject(FindObjectVisitor* visitor) const {
   uword end_addr = top();
   while (obj_addr < end_addr) {
     RawObject* raw_obj = RawObject::FromAddr(obj_addr);
-    if (raw_obj->FindObject(visitor)) {
+    if ((!needs_sweeping_ || raw_obj->IsMarked()) &&
+        raw_obj->FindObject(visitor)) {
       return raw_obj;  // Found object, return it.
     }
     obj_addr += raw_obj->Size();
@@ -83,6 +202,52 @@ RawObject* HeapPage::FindObject(FindObjectVisitor* visitor) const {
 }
 
 
+void HeapPage::RecordObjectStart(uword addr) {
+  ASSERT((addr >= first_object_start()) && (addr < top()));
+  ASSERT((object_starts_length_ == 0) ||
+         ((addr - start()) > object_starts_[object_starts_length_ - 1]));
+  if (object_starts_length_ == object_starts_capacity_) {
+    intptr_t new_capacity =
+        (object_starts_capacity_ == 0) ? 64 : (object_starts_capacity_ * 2);
+    uint32_t* new_starts = new uint32_t[new_capacity];
+    for (intptr_t i = 0; i < object_starts_length_; i++) {
+      new_starts[i] = object_starts_[i];
+    }
+    delete[] object_starts_;
+    object_starts_ = new_starts;
+    object_starts_capacity_ = new_capacity;
+  }
+  object_starts_[object_starts_length_++] = addr - start();
+}
+
+
+RawObject* HeapPage::FindObjectContaining(uword addr) const {
+  if ((addr < first_object_start()) || (addr >= top())) {
+    return Object::null();
+  }
+  // Find the last object starting at or below addr.
+  uword offset = addr - start();
+  intptr_t low = 0;
+  intptr_t high = object_starts_length_;
+  while (low < high) {
+    intptr_t middle = low + (high - low) / 2;
+    if (object_starts_[middle] <= offset) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0) {
+    return Object::null();
+  }
+  RawObject* raw_obj = RawObject::FromAddr(start() + object_starts_[low - 1]);
+  if (addr >= (RawObject::ToAddr(raw_obj) + raw_obj->Size())) {
+    return Object::null();
+  }
+  return raw_obj;
+}
+
+
 PageSpace::PageSpace(Heap* heap, intptr_t max_capacity, bool is_executable)
     : freelist_(),
       heap_(heap),
@@ -95,7 +260,13 @@ PageSpace::PageSpace(Heap* heap, intptr_t max_capacity, bool is_executable)
       in_use_(0),
       count_(0),
       is_executable_(is_executable),
+      page_index_(NULL),
+      page_index_length_(0),
+      page_index_capacity_(0),
       sweeping_(false),
+      lazy_sweep_page_(NULL),
+      marker_(NULL),
+      allocated_since_marking_step_(0),
       page_space_controller_(FLAG_heap_growth_space_ratio,
                              FLAG_heap_growth_rate,
                              FLAG_heap_growth_time_ratio) {
@@ -103,13 +274,15 @@ PageSpace::PageSpace(Heap* heap, intptr_t max_capacity, bool is_executable)
 
 
 PageSpace::~PageSpace() {
+  delete marker_;
+  delete[] page_index_;
   FreePages(pages_);
   FreePages(large_pages_);
 }
 
 
 intptr_t PageSpace::LargePageSizeFor(intptr_t size) {
-  intptr_t page_size = Utils::RoundUp(size + sizeof(HeapPage),
+  intptr_t page_size = Utils::RoundUp(size + HeapPage::ObjectStartOffset(),
                                       VirtualMemory::PageSize());
   return page_size;
 }
@@ -117,6 +290,7 @@ intptr_t PageSpace::LargePageSizeFor(intptr_t size) {
 
 void PageSpace::AllocatePage() {
   HeapPage* page = HeapPage::Allocate(kPageSize, is_executable_);
+  page->set_is_marking(IsMarking());
   if (pages_ == NULL) {
     pages_ = page;
   } else {
@@ -125,15 +299,25 @@ void PageSpace::AllocatePage() {
   pages_tail_ = page;
   bump_page_ = NULL;  // Reenable scanning of pages for bump allocation.
   capacity_ += kPageSize;
+  if (is_executable_) {
+    AddToPageIndex(page);
+  }
 }
 
 
 HeapPage* PageSpace::AllocateLargePage(intptr_t size) {
   intptr_t page_size = LargePageSizeFor(size);
   HeapPage* page = HeapPage::Allocate(page_size, is_executable_);
+  if (!is_executable_) {
+    page->AllocateCardTable();
+  }
+  page->set_is_marking(IsMarking());
   page->set_next(large_pages_);
   large_pages_ = page;
   capacity_ += page_size;
+  if (is_executable_) {
+    AddToPageIndex(page);
+  }
   return page;
 }
 
@@ -149,6 +333,9 @@ void PageSpace::FreePage(HeapPage* page, HeapPage* previous_page) {
   if (page == pages_tail_) {
     pages_tail_ = previous_page;
   }
+  if (is_executable_) {
+    RemoveFromPageIndex(page);
+  }
   // TODO(iposva): Consider adding to a pool of empty pages.
   page->Deallocate();
 }
@@ -162,6 +349,9 @@ void PageSpace::FreeLargePage(HeapPage* page, HeapPage* previous_page) {
   } else {
     large_pages_ = page->next();
   }
+  if (is_executable_) {
+    RemoveFromPageIndex(page);
+  }
   page->Deallocate();
 }
 
@@ -176,13 +366,68 @@ void PageSpace::FreePages(HeapPage* pages) {
 }
 
 
+void PageSpace::AddToPageIndex(HeapPage* page) {
+  if (page_index_length_ == page_index_capacity_) {
+    intptr_t new_capacity =
+        (page_index_capacity_ == 0) ? 16 : (page_index_capacity_ * 2);
+    HeapPage** new_index = new HeapPage*[new_capacity];
+    for (intptr_t i = 0; i < page_index_length_; i++) {
+      new_index[i] = page_index_[i];
+    }
+    delete[] page_index_;
+    page_index_ = new_index;
+    page_index_capacity_ = new_capacity;
+  }
+  intptr_t i = page_index_length_;
+  while ((i > 0) && (page_index_[i - 1]->start() > page->start())) {
+    page_index_[i] = page_index_[i - 1];
+    i--;
+  }
+  page_index_[i] = page;
+  page_index_length_++;
+}
+
+
+void PageSpace::RemoveFromPageIndex(HeapPage* page) {
+  intptr_t i = 0;
+  while (page_index_[i] != page) {
+    i++;
+    ASSERT(i < page_index_length_);
+  }
+  page_index_length_--;
+  for (; i < page_index_length_; i++) {
+    page_index_[i] = page_index_[i + 1];
+  }
+}
+
+
+void PageSpace::SetPagesMarking(bool value) {
+  HeapPage* page = pages_;
+  while (page != NULL) {
+    page->set_is_marking(value);
+    page = page->next();
+  }
+
+  page = large_pages_;
+  while (page != NULL) {
+    page->set_is_marking(value);
+    page = page->next();
+  }
+}
+
+
 uword PageSpace::TryBumpAllocate(intptr_t size) {
   if (pages_tail_ == NULL) {
     return 0;
   }
-  uword result = pages_tail_->TryBumpAllocate(size);
-  if (result != 0) {
-    return result;
+  // Objects allocated on a page which still needs sweeping would be freed
+  // by the sweeper.
+  uword result = 0;
+  if (!pages_tail_->needs_sweeping()) {
+    result = pages_tail_->TryBumpAllocate(size);
+    if (result != 0) {
+      return result;
+    }
   }
   if (bump_page_ == NULL) {
     // The bump page has not yet been used: Start at the beginning of the list.
@@ -191,9 +436,11 @@ uword PageSpace::TryBumpAllocate(intptr_t size) {
   // The last page has already been attempted above.
   while (bump_page_ != pages_tail_) {
     ASSERT(bump_page_->next() != NULL);
-    result = bump_page_->TryBumpAllocate(size);
-    if (result != 0) {
-      return result;
+    if (!bump_page_->needs_sweeping()) {
+      result = bump_page_->TryBumpAllocate(size);
+      if (result != 0) {
+        return result;
+      }
     }
     bump_page_ = bump_page_->next();
   }
@@ -202,6 +449,28 @@ uword PageSpace::TryBumpAllocate(intptr_t size) {
 }
 
 
+uword PageSpace::AllocateBlock(intptr_t size, bool is_large) {
+  ASSERT(!is_executable_);
+  ASSERT(!IsMarking());
+  uword result = 0;
+  if (is_large) {
+    HeapPage* page = AllocateLargePage(size);
+    result = page->top();
+    page->set_top(result + size);
+  } else {
+    ASSERT(IsPageAllocatableSize(size));
+    result = TryBumpAllocate(size);
+    if (result == 0) {
+      AllocatePage();
+      result = TryBumpAllocate(size);
+    }
+  }
+  ASSERT(result != 0);
+  in_use_ += size;
+  return result;
+}
+
+
 uword PageSpace::TryAllocate(intptr_t size) {
   return TryAllocate(size, kControlGrowth);
 }
@@ -211,10 +480,13 @@ uword PageSpace::TryAllocate(intptr_t size, GrowthPolicy growth_policy) {
   ASSERT(size >= kObjectAlignment);
   ASSERT(Utils::IsAligned(size, kObjectAlignment));
   uword result = 0;
-  if (size < kAllocatablePageSize) {
+  if (size < AllocatablePageSize()) {
     result = TryBumpAllocate(size);
     if (result == 0) {
       result = freelist_.TryAllocate(size);
+      while ((result == 0) && SweepNextPage()) {
+        result = freelist_.TryAllocate(size);
+      }
       if ((result == 0) &&
           (page_space_controller_.CanGrowPageSpace(size) ||
            growth_policy == kForceGrowth) &&
@@ -241,6 +513,13 @@ uword PageSpace::TryAllocate(intptr_t size, GrowthPolicy growth_policy) {
   }
   if (result != 0) {
     in_use_ += size;
+    if (is_executable_) {
+      PageFor(RawObject::FromAddr(result))->RecordObjectStart(result);
+    }
+    if (marker_ != NULL) {
+      marker_->RecordAllocation(result, size);
+      allocated_since_marking_step_ += size;
+    }
   }
   return result;
 }
@@ -296,6 +575,27 @@ void PageSpace::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
 }
 
 
+void PageSpace::VisitMarkedCards(ObjectPointerVisitor* visitor) const {
+  // Only large pages have card tables.
+  HeapPage* page = large_pages_;
+  while (page != NULL) {
+    if (page->card_table() != NULL) {
+      page->VisitMarkedCards(visitor);
+    }
+    page = page->next();
+  }
+}
+
+
+void PageSpace::ClearCardTables() const {
+  HeapPage* page = large_pages_;
+  while (page != NULL) {
+    page->ClearCardTable();
+    page = page->next();
+  }
+}
+
+
 RawObject* PageSpace::FindObject(FindObjectVisitor* visitor) const {
   ASSERT(Isolate::Current()->no_gc_scope_depth() != 0);
   HeapPage* page = pages_;
@@ -319,6 +619,95 @@ RawObject* PageSpace::FindObject(FindObjectVisitor* visitor) const {
 }
 
 
+RawObject* PageSpace::FindObjectContaining(uword addr) const {
+  ASSERT(is_executable_);
+  // Find the last page starting at or below addr.
+  intptr_t low = 0;
+  intptr_t high = page_index_length_;
+  while (low < high) {
+    intptr_t middle = low + (high - low) / 2;
+    if (page_index_[middle]->start() <= addr) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if ((low == 0) || !page_index_[low - 1]->Contains(addr)) {
+    return Object::null();
+  }
+  return page_index_[low - 1]->FindObjectContaining(addr);
+}
+
+
+bool PageSpace::SweepNextPage() {
+  while ((lazy_sweep_page_ != NULL) && !lazy_sweep_page_->needs_sweeping()) {
+    lazy_sweep_page_ = lazy_sweep_page_->next();
+  }
+  if (lazy_sweep_page_ == NULL) {
+    return false;
+  }
+  HeapPage* page = lazy_sweep_page_;
+  // The live objects on this page have already been accounted for by
+  // MarkSweep, which also freed the pages without any.
+  GCSweeper sweeper(heap_);
+  sweeper.SweepPage(page, &freelist_);
+  page->set_needs_sweeping(false);
+  // Bump allocation may have passed over the page while it needed sweeping
+  // and does not come back to it before the next collection. Hand the free
+  // space at the end of the page to the freelist instead.
+  uword top = page->top();
+  if (top < page->end()) {
+    freelist_.Free(top, page->end() - top);
+    page->set_top(page->end());
+  }
+  lazy_sweep_page_ = page->next();
+  return true;
+}
+
+
+void PageSpace::CompleteSweep() {
+  while (SweepNextPage()) {
+  }
+}
+
+
+static int CompareSlots(const uword* a, const uword* b) {
+  if (*a < *b) {
+    return -1;
+  }
+  return (*a == *b) ? 0 : 1;
+}
+
+
+// Returns the slots recorded in the store buffer as a sorted array, which the
+// caller frees. The store buffer is empty afterwards.
+static uword* TakeRememberedSlots(StoreBuffer* store_buffer,
+                                  intptr_t* length) {
+  StoreBufferBlock* blocks = store_buffer->TakeBlocks();
+  intptr_t count = 0;
+  for (StoreBufferBlock* block = blocks;
+       block != NULL;
+       block = block->next()) {
+    count += block->Count();
+  }
+  uword* slots = new uword[count];
+  intptr_t index = 0;
+  for (StoreBufferBlock* block = blocks;
+       block != NULL;
+       block = block->next()) {
+    for (intptr_t i = 0; i < block->Count(); i++) {
+      slots[index++] = block->At(i);
+    }
+  }
+  StoreBuffer::DeleteBlocks(blocks);
+  typedef int (*CompareFunction)(const void*, const void*);
+  qsort(slots, count, sizeof(slots[0]),
+        reinterpret_cast<CompareFunction>(CompareSlots));
+  *length = count;
+  return slots;
+}
+
+
 void PageSpace::MarkSweep(bool invoke_api_callbacks) {
   // MarkSweep is not reentrant. Make sure that is the case.
   ASSERT(!sweeping_);
@@ -336,9 +725,29 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks) {
   timer.Start();
   int64_t start = OS::GetCurrentTimeMillis();
 
+  // The mark bits left on unswept pages by the previous collection need to be
+  // cleared before marking again.
+  CompleteSweep();
+
   // Mark all reachable old-gen objects.
-  GCMarker marker(heap_);
-  marker.MarkObjects(isolate, this, invoke_api_callbacks);
+  bool is_incremental = IsMarking();
+  if (is_incremental) {
+    marker_->Finish(isolate, invoke_api_callbacks);
+    delete marker_;
+    marker_ = NULL;
+    SetPagesMarking(false);
+  } else {
+    GCMarker marker(heap_);
+    marker.MarkObjects(isolate, this, invoke_api_callbacks);
+  }
+
+  // Move the live objects out of sparsely populated pages, the sweep below
+  // then releases these pages.
+  intptr_t num_evacuated_pages = 0;
+  if (FLAG_compact_old_space && !is_incremental) {
+    GCCompactor compactor(heap_, this);
+    num_evacuated_pages = compactor.CompactPages(isolate);
+  }
 
   // Reset the bump allocation page to unused.
   bump_page_ = NULL;
@@ -347,10 +756,29 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks) {
   GCSweeper sweeper(heap_);
   intptr_t in_use = 0;
 
+  // Incremental marking keeps the store buffer intact, drop the slots of
+  // unreachable objects while sweeping instead.
+  intptr_t num_remembered_slots = 0;
+  uword* remembered_slots = NULL;
+  if (is_incremental) {
+    remembered_slots = TakeRememberedSlots(isolate->store_buffer(),
+                                           &num_remembered_slots);
+    sweeper.set_remembered_slots(remembered_slots, num_remembered_slots);
+  }
+
   HeapPage* prev_page = NULL;
   HeapPage* page = pages_;
   while (page != NULL) {
-    intptr_t page_in_use = sweeper.SweepPage(page, &freelist_);
+    intptr_t page_in_use = page->used();
+    if ((page_in_use != 0) &&
+        FLAG_lazy_sweeping &&
+        !sweeper.HasRememberedSlots(page->start(), page->end())) {
+      // Leave the page to be swept once the freelist runs dry. Pages holding
+      // remembered slots are swept now to drop the slots of freed objects.
+      page->set_needs_sweeping(true);
+    } else {
+      page_in_use = sweeper.SweepPage(page, &freelist_);
+    }
     HeapPage* next_page = page->next();
     if (page_in_use == 0) {
       FreePage(page, prev_page);
@@ -361,6 +789,7 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks) {
     // Advance to the next page.
     page = next_page;
   }
+  lazy_sweep_page_ = pages_;
 
   prev_page = NULL;
   page = large_pages_;
@@ -377,6 +806,15 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks) {
     page = next_page;
   }
 
+  if (remembered_slots != NULL) {
+    for (intptr_t i = 0; i < num_remembered_slots; i++) {
+      if (remembered_slots[i] != 0) {
+        isolate->store_buffer()->AddPointer(remembered_slots[i]);
+      }
+    }
+    delete[] remembered_slots;
+  }
+
   // Record data and print if requested.
   intptr_t in_use_before = in_use_;
   in_use_ = in_use;
@@ -390,12 +828,17 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks) {
 
   if (FLAG_verbose_gc) {
     const intptr_t KB2 = KB / 2;
-    OS::PrintErr("Mark-Sweep[%d]: %lldus (%dK -> %dK, %dK)\n",
+    OS::PrintErr("Mark-Sweep[%d]: %lldus (%dK -> %dK, %dK)%s\n",
                  count_,
                  timer.TotalElapsedTime(),
                  (in_use_before + (KB2)) / KB,
                  (in_use + (KB2)) / KB,
-                 (capacity_ + KB2) / KB);
+                 (capacity_ + KB2) / KB,
+                 is_incremental ? " incremental" : "");
+    if (num_evacuated_pages > 0) {
+      OS::PrintErr("Compact[%d]: %d pages evacuated\n",
+                   count_, num_evacuated_pages);
+    }
   }
 
   if (FLAG_verify_after_gc) {
@@ -411,6 +854,61 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks) {
 }
 
 
+void PageSpace::StartMarking() {
+  ASSERT(!IsMarking());
+  ASSERT(!is_executable_);
+  Isolate* isolate = Isolate::Current();
+  NoHandleScope no_handles(isolate);
+  Timer timer(FLAG_verbose_gc, "StartMarking");
+  timer.Start();
+  CompleteSweep();
+  marker_ = new IncrementalMarker(heap_, this);
+  allocated_since_marking_step_ = 0;
+  // The write barrier needs to be active before the roots are visited.
+  SetPagesMarking(true);
+  marker_->Start(isolate);
+  timer.Stop();
+  if (FLAG_verbose_gc) {
+    OS::PrintErr("Mark-Start[%d]: %lldus\n", count_, timer.TotalElapsedTime());
+  }
+}
+
+
+void PageSpace::MarkingStep() {
+  ASSERT(IsMarking());
+  bool is_done = false;
+  {
+    NoHandleScope no_handles(Isolate::Current());
+    Timer timer(FLAG_verbose_gc, "MarkingStep");
+    timer.Start();
+    is_done = marker_->Step(FLAG_marking_step_size * KB);
+    allocated_since_marking_step_ = 0;
+    timer.Stop();
+    if (FLAG_verbose_gc) {
+      OS::PrintErr("Mark-Step[%d]: %lldus\n",
+                   count_, timer.TotalElapsedTime());
+    }
+  }
+  if (is_done) {
+    // Everything reachable has been marked, complete the collection.
+    MarkSweep(true);
+  }
+}
+
+
+bool PageSpace::NeedsMarkingStep() const {
+  // Marking visits objects at twice the rate of allocation.
+  return IsMarking() &&
+      (allocated_since_marking_step_ >= (FLAG_marking_step_size * KB / 2));
+}
+
+
+void PageSpace::MarkingBarrier(RawObject* raw_obj) {
+  ASSERT(IsMarking());
+  marker_->MarkObject(raw_obj);
+}
+
+
 PageSpaceController::PageSpaceController(int heap_growth_ratio,
                                          int heap_growth_rate,
                                          int garbage_collection_time_ratio)
@@ -13,6 +13,7 @@ namespace dart {
 
 // Forward declarations.
 class Heap;
+class IncrementalMarker;
 class ObjectPointerVisitor;
 
 // An aligned page containing old generation objects. Alignment is used to be
@@ -32,8 +33,13 @@ class HeapPage {
   uword top() const { return top_; }
   void set_top(uword top) { top_ = top; }
 
+  // The header is padded so that objects start at the object alignment.
+  static intptr_t ObjectStartOffset() {
+    return Utils::RoundUp(sizeof(HeapPage), kObjectAlignment);
+  }
+
   uword first_object_start() const {
-    return (reinterpret_cast<uword>(this) + sizeof(HeapPage));
+    return (reinterpret_cast<uword>(this) + ObjectStartOffset());
   }
 
   void set_used(uword used) { used_ = used; }
@@ -57,6 +63,51 @@ class HeapPage {
 
   RawObject* FindObject(FindObjectVisitor* visitor) const;
 
+  // Large pages holding pointer objects have a card table. Instead of adding
+  // each updated slot to the store buffer, the write barrier marks the card
+  // covering the slot and the scavenger only rescans the marked cards.
+  static const intptr_t kCardSizeLog2 = 9;
+  static const intptr_t kCardSize = 1 << kCardSizeLog2;
+
+  uint8_t* card_table() const { return card_table_; }
+  static intptr_t card_table_offset() {
+    return OFFSET_OF(HeapPage, card_table_);
+  }
+
+  void MarkCard(uword addr) {
+    ASSERT(card_table_ != NULL);
+    ASSERT((addr >= first_object_start()) && (addr < top()));
+    card_table_[(addr - start()) >> kCardSizeLog2] = 1;
+  }
+  bool IsCardMarked(uword addr) const {
+    ASSERT(card_table_ != NULL);
+    return card_table_[(addr - start()) >> kCardSizeLog2] != 0;
+  }
+  void ClearCardTable();
+
+  // Visit the pointers located in marked cards. The cards are cleared and
+  // only marked again if they still refer to new space objects afterwards.
+  void VisitMarkedCards(ObjectPointerVisitor* visitor);
+
+  // Set while the old generation is being marked incrementally. Storing an
+  // object located on such a page then goes through the marking barrier.
+  bool is_marking() const { return marking_ != 0; }
+  void set_is_marking(bool value) { marking_ = value ? 1 : 0; }
+  static intptr_t marking_offset() { return OFFSET_OF(HeapPage, marking_); }
+
+  // Set on pages which still hold the unreachable objects found by the last
+  // marking. Only the marked objects on such a page are live.
+  bool needs_sweeping() const { return needs_sweeping_; }
+  void set_needs_sweeping(bool value) { needs_sweeping_ = value; }
+
+  // Pages of executable spaces record the start of each object allocated on
+  // them. These objects are bump allocated and never moved or freed, so the
+  // starts are recorded in ascending order.
+  void RecordObjectStart(uword addr);
+  // Returns the object covering addr, or null if there is none. Only valid
+  // on pages recording their object starts.
+  RawObject* FindObjectContaining(uword addr) const;
+
  private:
   static HeapPage* Initialize(VirtualMemory* memory, bool is_executable);
   static HeapPage* Allocate(intptr_t size, bool is_executable);
@@ -65,10 +116,22 @@ class HeapPage {
   // page becomes immediately inaccessible.
   void Deallocate();
 
+  intptr_t NumberOfCards() const {
+    return (end() - start() + kCardSize - 1) >> kCardSizeLog2;
+  }
+  void AllocateCardTable();
+
   VirtualMemory* memory_;
   HeapPage* next_;
   uword used_;
   uword top_;
+  uint8_t* card_table_;
+  uword marking_;
+  bool needs_sweeping_;
+  // Offsets of the recorded object starts from the start of the page.
+  uint32_t* object_starts_;
+  intptr_t object_starts_length_;
+  intptr_t object_starts_capacity_;
 
   friend class PageSpace;
 
@@ -171,17 +234,37 @@ class PageSpace {
     return Contains(addr);
   }
   static bool IsPageAllocatableSize(intptr_t size) {
-    return size <= kAllocatablePageSize;
+    return size <= AllocatablePageSize();
   }
 
   void VisitObjects(ObjectVisitor* visitor) const;
   void VisitObjectPointers(ObjectPointerVisitor* visitor) const;
+  void VisitMarkedCards(ObjectPointerVisitor* visitor) const;
+  void ClearCardTables() const;
 
   RawObject* FindObject(FindObjectVisitor* visitor) const;
 
-  // Collect the garbage in the page space using mark-sweep.
+  // Returns the object covering addr, or null if there is none. Executable
+  // spaces index their pages and objects by address, the lookup takes two
+  // binary searches instead of a walk over all objects.
+  RawObject* FindObjectContaining(uword addr) const;
+
+  // Collect the garbage in the page space using mark-sweep. Completes the
+  // marking in this pause if incremental marking is in progress.
   void MarkSweep(bool invoke_api_callbacks);
 
+  // Incremental marking of the page space. The mutator runs between the
+  // marking steps, and the collection is completed by MarkSweep once all
+  // reachable objects have been marked.
+  bool IsMarking() const { return marker_ != NULL; }
+  void StartMarking();
+  void MarkingStep();
+  // Returns true if enough has been allocated since the last marking step
+  // to warrant another one.
+  bool NeedsMarkingStep() const;
+  // Marks an object stored into the heap while marking is in progress.
+  void MarkingBarrier(RawObject* raw_obj);
+
   static HeapPage* PageFor(RawObject* raw_obj) {
     return reinterpret_cast<HeapPage*>(
         RawObject::ToAddr(raw_obj) & ~(kPageSize -1));
@@ -192,13 +275,25 @@ class PageSpace {
   }
 
  private:
-  static const intptr_t kAllocatablePageSize = kPageSize - sizeof(HeapPage);
+  static intptr_t AllocatablePageSize() {
+    return kPageSize - HeapPage::ObjectStartOffset();
+  }
 
   void AllocatePage();
   void FreePage(HeapPage* page, HeapPage* previous_page);
   HeapPage* AllocateLargePage(intptr_t size);
   void FreeLargePage(HeapPage* page, HeapPage* previous_page);
   void FreePages(HeapPage* pages);
+  void SetPagesMarking(bool value);
+
+  void AddToPageIndex(HeapPage* page);
+  void RemoveFromPageIndex(HeapPage* page);
+
+  // Sweep the next page left unswept by the last MarkSweep, adding its free
+  // blocks to the freelist. Returns false if no such page is left.
+  bool SweepNextPage();
+  // Sweep all pages left unswept by the last MarkSweep.
+  void CompleteSweep();
 
   static intptr_t LargePageSizeFor(intptr_t size);
 
@@ -209,6 +304,10 @@ class PageSpace {
 
   uword TryBumpAllocate(intptr_t size);
 
+  // Allocates a block of size bytes to hold objects copied from a heap image.
+  // A block taken from a large page gets a large page of its own.
+  uword AllocateBlock(intptr_t size, bool is_large);
+
   FreeList freelist_;
 
   Heap* heap_;
@@ -234,11 +333,29 @@ class PageSpace {
 
   bool is_executable_;
 
+  // The pages of an executable space sorted by their start address.
+  HeapPage** page_index_;
+  intptr_t page_index_length_;
+  intptr_t page_index_capacity_;
+
   // Keep track whether a MarkSweep is currently running.
   bool sweeping_;
 
+  // The pages starting at this one may still need to be swept, NULL once
+  // all pages have been swept.
+  HeapPage* lazy_sweep_page_;
+
+  // The state of the incremental marking, NULL unless marking is in
+  // progress.
+  IncrementalMarker* marker_;
+  // Bytes allocated since the last incremental marking step.
+  intptr_t allocated_since_marking_step_;
+
   PageSpaceController page_space_controller_;
 
+  friend class GCCompactor;
+  friend class HeapImage;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(PageSpace);
 };
 
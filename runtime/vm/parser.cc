@@ -248,6 +248,7 @@ Parser::Parser(const Script& script,
                const Library& library)
     : script_(script),
       tokens_(TokenStream::Handle(script.tokens())),
+      tokens_iterator_(tokens_, 0),
       token_index_(0),
       current_block_(NULL),
       is_top_level_(false),
@@ -270,6 +271,7 @@ Parser::Parser(const Script& script,
                intptr_t token_index)
     : script_(script),
       tokens_(TokenStream::Handle(script.tokens())),
+      tokens_iterator_(tokens_, 0),
       token_index_(0),
       current_block_(NULL),
       is_top_level_(false),
@@ -334,7 +336,8 @@ void Parser::ParseCompilationUnit(const Library& library,
 
 Token::Kind Parser::CurrentToken() {
   if (token_kind_ == Token::kILLEGAL) {
-    token_kind_ = tokens_.KindAt(token_index_);
+    tokens_iterator_.SetCurrentIndex(token_index_);
+    token_kind_ = tokens_iterator_.CurrentTokenKind();
     if (token_kind_ == Token::kERROR) {
       ErrorMsg(token_index_, CurrentLiteral()->ToCString());
     }
@@ -347,20 +350,23 @@ Token::Kind Parser::CurrentToken() {
 Token::Kind Parser::LookaheadToken(int num_tokens) {
   CompilerStats::num_tokens_lookahead++;
   CompilerStats::num_token_checks++;
-  return tokens_.KindAt(token_index_ + num_tokens);
+  tokens_iterator_.SetCurrentIndex(token_index_);
+  return tokens_iterator_.LookaheadTokenKind(num_tokens);
 }
 
 
 String* Parser::CurrentLiteral() const {
   String& result = String::ZoneHandle();
-  result ^= tokens_.LiteralAt(token_index_);
+  tokens_iterator_.SetCurrentIndex(token_index_);
+  result ^= tokens_iterator_.CurrentLiteral();
   return &result;
 }
 
 
 RawDouble* Parser::CurrentDoubleLiteral() const {
   LiteralToken& token = LiteralToken::Handle();
-  token ^= tokens_.TokenAt(token_index_);
+  tokens_iterator_.SetCurrentIndex(token_index_);
+  token ^= tokens_iterator_.CurrentToken();
   ASSERT(token.kind() == Token::kDOUBLE);
   return reinterpret_cast<RawDouble*>(token.value());
 }
@@ -368,7 +374,8 @@ RawDouble* Parser::CurrentDoubleLiteral() const {
 
 RawInteger* Parser::CurrentIntegerLiteral() const {
   LiteralToken& token = LiteralToken::Handle();
-  token ^= tokens_.TokenAt(token_index_);
+  tokens_iterator_.SetCurrentIndex(token_index_);
+  token ^= tokens_iterator_.CurrentToken();
   ASSERT(token.kind() == Token::kINTEGER);
   return reinterpret_cast<RawInteger*>(token.value());
 }
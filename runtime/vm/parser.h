@@ -501,6 +501,9 @@ class Parser : ValueObject {
 
   const Script& script_;
   const TokenStream& tokens_;
+  // Decodes the tokens of tokens_, positioned by the accessors of the
+  // current token at token_index_.
+  mutable TokenStream::Iterator tokens_iterator_;
   intptr_t token_index_;
   Token::Kind token_kind_;  // Cached token kind for the token_index_.
   Block* current_block_;
@@ -5,9 +5,11 @@
 #include "vm/port.h"
 
 #include "platform/utils.h"
+#include "vm/atomic.h"
 #include "vm/dart_api_impl.h"
 #include "vm/isolate.h"
 #include "vm/message_handler.h"
+#include "vm/os.h"
 #include "vm/thread.h"
 
 namespace dart {
@@ -15,6 +17,8 @@ namespace dart {
 DECLARE_FLAG(bool, trace_isolates);
 
 Mutex* PortMap::mutex_ = NULL;
+intptr_t PortMap::readers_ = 0;
+intptr_t PortMap::writing_ = 0;
 PortMap::Entry* PortMap::map_ = NULL;
 MessageHandler* PortMap::deleted_entry_ = reinterpret_cast<MessageHandler*>(1);
 intptr_t PortMap::capacity_ = 0;
@@ -23,6 +27,60 @@ intptr_t PortMap::deleted_ = 0;
 Dart_Port PortMap::next_port_ = 7111;
 
 
+// Registers the current thread as a reader of the port map. Readers only
+// wait while the map is being modified.
+class PortMapReadScope : public ValueObject {
+ public:
+  PortMapReadScope() {
+    while (true) {
+      AtomicOperations::FetchAndAddWord(&PortMap::readers_, 1);
+      if (*reinterpret_cast<volatile intptr_t*>(&PortMap::writing_) == 0) {
+        break;
+      }
+      // Back off and wait for the writer to release the lock.
+      AtomicOperations::FetchAndAddWord(&PortMap::readers_, -1);
+      MutexLocker ml(PortMap::mutex_);
+    }
+  }
+
+  ~PortMapReadScope() {
+    AtomicOperations::FetchAndAddWord(&PortMap::readers_, -1);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(PortMapReadScope);
+};
+
+
+// Takes the port map lock and waits until there are no more readers.
+class PortMapWriteScope : public ValueObject {
+ public:
+  PortMapWriteScope() : locker_(PortMap::mutex_) {
+    AtomicOperations::FetchAndAddWord(&PortMap::writing_, 1);
+    intptr_t spins = 0;
+    while (*reinterpret_cast<volatile intptr_t*>(&PortMap::readers_) != 0) {
+      // Readers usually leave the map quickly, but may block in the
+      // PostMessage of a message handler. Give up the processor to them
+      // after a short spin.
+      if (++spins > kMaxSpins) {
+        OS::Sleep(0);
+      }
+    }
+  }
+
+  ~PortMapWriteScope() {
+    AtomicOperations::FetchAndAddWord(&PortMap::writing_, -1);
+  }
+
+ private:
+  static const intptr_t kMaxSpins = 1000;
+
+  MutexLocker locker_;
+
+  DISALLOW_COPY_AND_ASSIGN(PortMapWriteScope);
+};
+
+
 intptr_t PortMap::FindPort(Dart_Port port) {
   intptr_t index = port % capacity_;
   intptr_t start_index = index;
@@ -77,7 +135,7 @@ Dart_Port PortMap::AllocatePort() {
 
 
 void PortMap::SetLive(Dart_Port port) {
-  MutexLocker ml(mutex_);
+  PortMapWriteScope ws;
   intptr_t index = FindPort(port);
   ASSERT(index >= 0);
   map_[index].live = true;
@@ -100,7 +158,7 @@ void PortMap::MaintainInvariants() {
 
 Dart_Port PortMap::CreatePort(MessageHandler* handler) {
   ASSERT(handler != NULL);
-  MutexLocker ml(mutex_);
+  PortMapWriteScope ws;
 #if defined(DEBUG)
   handler->CheckAccess();
 #endif
@@ -144,7 +202,7 @@ Dart_Port PortMap::CreatePort(MessageHandler* handler) {
 bool PortMap::ClosePort(Dart_Port port) {
   MessageHandler* handler = NULL;
   {
-    MutexLocker ml(mutex_);
+    PortMapWriteScope ws;
     intptr_t index = FindPort(port);
     if (index < 0) {
       return false;
@@ -181,7 +239,7 @@ bool PortMap::ClosePort(Dart_Port port) {
 
 void PortMap::ClosePorts(MessageHandler* handler) {
   {
-    MutexLocker ml(mutex_);
+    PortMapWriteScope ws;
     for (intptr_t i = 0; i < capacity_; i++) {
       if (map_[i].handler == handler) {
         // Mark the slot as deleted.
@@ -201,7 +259,7 @@ void PortMap::ClosePorts(MessageHandler* handler) {
 
 
 bool PortMap::PostMessage(Message* message) {
-  MutexLocker ml(mutex_);
+  PortMapReadScope rs;
   intptr_t index = FindPort(message->dest_port());
   if (index < 0) {
     delete message;
@@ -218,7 +276,7 @@ bool PortMap::PostMessage(Message* message) {
 
 
 bool PortMap::IsLocalPort(Dart_Port id) {
-  MutexLocker ml(mutex_);
+  PortMapReadScope rs;
   intptr_t index = FindPort(id);
   if (index < 0) {
     // Port does not exist.
@@ -15,7 +15,9 @@ class Isolate;
 class Message;
 class MessageHandler;
 class Mutex;
+class PortMapReadScope;
 class PortMapTestPeer;
+class PortMapWriteScope;
 
 class PortMap: public AllStatic {
  public:
@@ -47,6 +49,8 @@ class PortMap: public AllStatic {
 
  private:
   friend class dart::PortMapTestPeer;
+  friend class PortMapReadScope;
+  friend class PortMapWriteScope;
 
   // Mapping between port numbers and handlers.
   //
@@ -69,8 +73,13 @@ class PortMap: public AllStatic {
 
   static void MaintainInvariants();
 
-  // Lock protecting access to the port map.
+  // Lock protecting access to the port map. Functions which only look up
+  // ports, like PostMessage, do not take the lock but register as readers
+  // instead, so that they do not block each other. Functions which modify
+  // the map take the lock and wait for the readers to finish.
   static Mutex* mutex_;
+  static intptr_t readers_;
+  static intptr_t writing_;
 
   // Hashmap of ports.
   static Entry* map_;
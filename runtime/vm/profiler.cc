@@ -0,0 +1,334 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/profiler.h"
+
+#include "platform/assert.h"
+#include "platform/utils.h"
+#include "vm/atomic.h"
+#include "vm/dart.h"
+#include "vm/growable_array.h"
+#include "vm/heap.h"
+#include "vm/isolate.h"
+#include "vm/object.h"
+#include "vm/os.h"
+#include "vm/stack_frame.h"
+#include "vm/stub_code.h"
+#include "vm/thread.h"
+#include "vm/zone.h"
+
+namespace dart {
+
+Mutex* Profiler::mutex_ = NULL;
+Profiler::Sample* Profiler::samples_ = NULL;
+intptr_t Profiler::period_micros_ = 0;
+uword Profiler::is_running_ = 0;
+intptr_t Profiler::num_running_handlers_ = 0;
+intptr_t Profiler::num_dropped_samples_ = 0;
+
+
+void Profiler::InitOnce() {
+  ASSERT(mutex_ == NULL);
+  mutex_ = new Mutex();
+}
+
+
+bool Profiler::Start(intptr_t period_micros) {
+  ASSERT(period_micros > 0);
+  MutexLocker ml(mutex_);
+  if (is_running_ != 0) {
+    return false;
+  }
+  if (samples_ == NULL) {
+    samples_ = new Sample[kNumSamples];
+  }
+  memset(samples_, 0, kNumSamples * sizeof(Sample));
+  num_dropped_samples_ = 0;
+  period_micros_ = period_micros;
+  AtomicOperations::CompareAndSwapWord(&is_running_, 0, 1);
+  if (!StartTimer(period_micros)) {
+    AtomicOperations::CompareAndSwapWord(&is_running_, 1, 0);
+    return false;
+  }
+  return true;
+}
+
+
+void Profiler::Stop() {
+  MutexLocker ml(mutex_);
+  if (is_running_ == 0) {
+    return;
+  }
+  AtomicOperations::CompareAndSwapWord(&is_running_, 1, 0);
+  StopTimer();
+  // A signal delivered before the timer was stopped may still be handled on
+  // another thread. Wait for it, so that the samples are not cleared under
+  // its feet by the next start.
+  while (num_running_handlers_ != 0) {
+    OS::Sleep(1);
+  }
+}
+
+
+bool Profiler::IsRunning() {
+  return is_running_ != 0;
+}
+
+
+intptr_t Profiler::num_samples() {
+  MutexLocker ml(mutex_);
+  intptr_t result = 0;
+  if (samples_ != NULL) {
+    for (intptr_t i = 0; i < kNumSamples; i++) {
+      if (samples_[i].key > kReservedKey) {
+        result += samples_[i].count;
+      }
+    }
+  }
+  return result;
+}
+
+
+// Returns true if fp may point to a frame below stack_upper whose saved
+// frame pointer and return address can be read.
+static bool IsFramePointer(uword fp, uword stack_lower, uword stack_upper) {
+  return (fp > stack_lower) && (fp < stack_upper - 2 * kWordSize) &&
+      Utils::IsAligned(fp, kWordSize);
+}
+
+
+// Returns true if pc is in code generated by the VM, which links its frames
+// by frame pointers. Only the interrupted thread changes the code pages of
+// its isolate, those of the VM isolate do not change after initialization.
+static bool IsDartCode(Isolate* isolate, uword pc) {
+  return isolate->heap()->CodeContains(pc) ||
+      Dart::vm_isolate()->heap()->CodeContains(pc);
+}
+
+
+void Profiler::RecordSample(uword pc, uword fp, uword sp) {
+  AtomicOperations::FetchAndAddWord(&num_running_handlers_, 1);
+  if (is_running_ != 0) {
+    Sample sample;
+    sample.key = 0;
+    sample.count = 1;
+    sample.isolate = Isolate::Current();
+    sample.depth = 1;
+    sample.pcs[0] = pc;
+    Isolate* isolate = sample.isolate;
+    uword stack_lower = 0;
+    uword stack_upper = 0;
+    // The frames of the interrupted code are between sp and the upper end of
+    // the stack of the thread.
+    if ((isolate != NULL) &&
+        Isolate::GetThreadStackBounds(&stack_lower, &stack_upper) &&
+        (sp >= stack_lower) && (sp < stack_upper)) {
+      uword exit_fp = isolate->top_exit_frame_info();
+      if (exit_fp != 0) {
+        // The VM was called from Dart code, the exit frame links to the Dart
+        // frames.
+        CollectFrames(exit_fp, sp, stack_upper, &sample);
+      } else if (IsDartCode(isolate, pc) && !StubCode::InInvocationStub(pc)) {
+        // Dart code is running and fp is the frame pointer of a Dart frame,
+        // or of its caller in a prologue. Without an exit frame, code outside
+        // of the code space has no Dart frames below it and its fp may not be
+        // a frame pointer at all.
+        if (!CollectFrames(fp, sp, stack_upper, &sample)) {
+          sample.depth = 1;
+        }
+      }
+    }
+    AddSample(sample);
+  }
+  AtomicOperations::FetchAndAddWord(&num_running_handlers_, -1);
+}
+
+
+bool Profiler::CollectFrames(uword fp,
+                             uword stack_lower,
+                             uword stack_upper,
+                             Sample* sample) {
+  // Only the stack is read, the interrupted code may be modifying the heap
+  // or be in the middle of setting up a frame. Every frame saves the frame
+  // pointer of its caller and the return address into it.
+  while (IsFramePointer(fp, stack_lower, stack_upper)) {
+    uword caller_fp = reinterpret_cast<uword*>(fp)[0];
+    uword caller_pc = reinterpret_cast<uword*>(fp)[1];
+    if (StubCode::InInvocationStub(caller_pc)) {
+      // The caller is an entry frame. It links to the exit frame of the Dart
+      // code which called into the VM, if any.
+      uword exit_link = caller_fp + EntryFrame::ExitLinkOffset();
+      if (!IsFramePointer(exit_link, fp, stack_upper)) {
+        return false;
+      }
+      uword exit_fp = *reinterpret_cast<uword*>(exit_link);
+      if (exit_fp == 0) {
+        return true;
+      }
+      stack_lower = caller_fp;
+      fp = exit_fp;
+      continue;
+    }
+    if (sample->depth < kMaxStackDepth) {
+      sample->pcs[sample->depth++] = caller_pc;
+    }
+    stack_lower = fp;
+    fp = caller_fp;
+  }
+  return false;
+}
+
+
+static uword HashStack(Isolate* isolate, intptr_t depth, const uword* pcs) {
+  uword hash = reinterpret_cast<uword>(isolate);
+  for (intptr_t i = 0; i < depth; i++) {
+    hash = (hash * 31) + pcs[i];
+    hash ^= hash >> 11;
+  }
+  return hash;
+}
+
+
+void Profiler::AddSample(const Sample& sample) {
+  uword hash = HashStack(sample.isolate, sample.depth, sample.pcs);
+  // Keys of filled in samples are larger than kReservedKey.
+  uword key = hash | (kReservedKey << 1);
+  for (intptr_t i = 0; i < kMaxProbes; i++) {
+    Sample* entry = &samples_[(hash + i) & (kNumSamples - 1)];
+    uword entry_key = entry->key;
+    if (entry_key == 0) {
+      entry_key = AtomicOperations::CompareAndSwapWord(&entry->key,
+                                                       0,
+                                                       kReservedKey);
+      if (entry_key == 0) {
+        entry->count = 1;
+        entry->isolate = sample.isolate;
+        entry->depth = sample.depth;
+        for (intptr_t j = 0; j < sample.depth; j++) {
+          entry->pcs[j] = sample.pcs[j];
+        }
+        AtomicOperations::CompareAndSwapWord(&entry->key, kReservedKey, key);
+        return;
+      }
+    }
+    // Samples which are being filled in by another handler are skipped, the
+    // same stack may then be counted in two entries.
+    if ((entry_key == key) &&
+        (entry->isolate == sample.isolate) &&
+        (entry->depth == sample.depth) &&
+        (memcmp(entry->pcs, sample.pcs, sample.depth * sizeof(uword)) == 0)) {
+      AtomicOperations::FetchAndAddWord(&entry->count, 1);
+      return;
+    }
+  }
+  AtomicOperations::FetchAndAddWord(&num_dropped_samples_, 1);
+}
+
+
+void Profiler::WritePprof(Dart_ProfileWriteCallback callback, void* stream) {
+  MutexLocker ml(mutex_);
+  // Header: header words, version, sampling period and padding.
+  const intptr_t header[] = { 0, 3, 0, period_micros_, 0 };
+  callback(header, sizeof(header), stream);
+  if (samples_ != NULL) {
+    for (intptr_t i = 0; i < kNumSamples; i++) {
+      const Sample& sample = samples_[i];
+      if (sample.key > kReservedKey) {
+        const intptr_t record[] = { sample.count, sample.depth };
+        callback(record, sizeof(record), stream);
+        callback(sample.pcs, sample.depth * sizeof(uword), stream);
+      }
+    }
+  }
+  const intptr_t trailer[] = { 0, 1, 0 };
+  callback(trailer, sizeof(trailer), stream);
+  WriteMappedRegions(callback, stream);
+}
+
+
+// Returns the name of the Dart function or stub containing pc.
+static const char* NameOfCode(Isolate* isolate, uword pc) {
+  const Code& code = Code::Handle(isolate, Code::LookupCode(pc));
+  uword entry_point = 0;
+  if (!code.IsNull()) {
+    const Function& function = Function::Handle(isolate, code.function());
+    if (!function.IsNull()) {
+      return function.ToFullyQualifiedCString();
+    }
+    entry_point = code.EntryPoint();
+  } else {
+    Heap* vm_heap = Dart::vm_isolate()->heap();
+    if (!vm_heap->CodeContains(pc)) {
+      return "[vm]";
+    }
+    NoGCScope no_gc;
+    RawInstructions* instr = vm_heap->FindInstructionsInCodeSpace(pc);
+    if (instr != Instructions::null()) {
+      entry_point = Instructions::Handle(isolate, instr).EntryPoint();
+    }
+  }
+  const char* name = StubCode::NameOfStub(entry_point);
+  if (name == NULL) {
+    return "[stub]";
+  }
+  return isolate->current_zone()->PrintToString("[%s]", name);
+}
+
+
+struct FlameGraphStack {
+  const char* frames;
+  intptr_t count;
+};
+
+
+static int CompareFlameGraphStacks(const FlameGraphStack* a,
+                                   const FlameGraphStack* b) {
+  return strcmp(a->frames, b->frames);
+}
+
+
+void Profiler::WriteFlameGraph(Dart_ProfileWriteCallback callback,
+                               void* stream) {
+  MutexLocker ml(mutex_);
+  Isolate* isolate = Isolate::Current();
+  ASSERT(isolate != NULL);
+  if (samples_ == NULL) {
+    return;
+  }
+  Zone* zone = isolate->current_zone();
+  GrowableArray<FlameGraphStack> stacks;
+  for (intptr_t i = 0; i < kNumSamples; i++) {
+    const Sample& sample = samples_[i];
+    if ((sample.key <= kReservedKey) || (sample.isolate != isolate)) {
+      continue;
+    }
+    FlameGraphStack stack;
+    stack.frames = NULL;
+    stack.count = sample.count;
+    for (intptr_t j = sample.depth - 1; j >= 0; j--) {
+      // Return addresses may follow the last instruction of the code.
+      uword pc = (j == 0) ? sample.pcs[j] : (sample.pcs[j] - 1);
+      const char* name = NameOfCode(isolate, pc);
+      stack.frames = (stack.frames == NULL) ?
+          name : zone->PrintToString("%s;%s", stack.frames, name);
+    }
+    stacks.Add(stack);
+  }
+  // Samples which differ only in their pcs have the same functions.
+  stacks.Sort(CompareFlameGraphStacks);
+  intptr_t i = 0;
+  while (i < stacks.length()) {
+    const char* frames = stacks[i].frames;
+    intptr_t count = 0;
+    while ((i < stacks.length()) && (strcmp(stacks[i].frames, frames) == 0)) {
+      count += stacks[i].count;
+      i++;
+    }
+    const char* line =
+        zone->PrintToString("%s %d\n", frames, static_cast<int>(count));
+    callback(line, strlen(line), stream);
+  }
+}
+
+}  // namespace dart
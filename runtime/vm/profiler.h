@@ -0,0 +1,95 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_PROFILER_H_
+#define VM_PROFILER_H_
+
+#include "include/dart_api.h"
+#include "vm/allocation.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Forward declarations.
+class Isolate;
+class Mutex;
+
+// A sampling CPU profiler. While it runs, a timer interrupts the process
+// with SIGPROF at a fixed period of CPU time. The signal handler records the
+// interrupted pc and the return addresses of the Dart frames of the current
+// isolate, which are found by following the frame pointers on the stack.
+// Identical stacks are counted in a fixed size table which the handler
+// updates with atomic operations only, as it cannot take locks.
+//
+// The addresses are resolved to Dart functions when the profile is written,
+// using the index of the code space. Code which has been collected in the
+// meantime cannot be resolved.
+class Profiler : public AllStatic {
+ public:
+  static const intptr_t kMaxStackDepth = 32;
+  static const intptr_t kNumSamples = 8 * KB;
+
+  static void InitOnce();
+
+  // Returns false if the profiler is already running or if it is not
+  // supported on this platform.
+  static bool Start(intptr_t period_micros);
+  static void Stop();
+  static bool IsRunning();
+
+  static void WritePprof(Dart_ProfileWriteCallback callback, void* stream);
+
+  // Only writes the samples of the current isolate.
+  static void WriteFlameGraph(Dart_ProfileWriteCallback callback,
+                              void* stream);
+
+  // Called by the signal handler with the registers of the interrupted
+  // thread.
+  static void RecordSample(uword pc, uword fp, uword sp);
+
+  // Number of samples taken and of samples which did not fit in the table.
+  static intptr_t num_samples();
+  static intptr_t num_dropped_samples() { return num_dropped_samples_; }
+
+ private:
+  // A distinct stack and the number of times it was sampled.
+  struct Sample {
+    // 0 if the sample is unused, kReservedKey while the handler fills it in,
+    // and the hash of the stack once it can be read.
+    uword key;
+    intptr_t count;
+    Isolate* isolate;
+    intptr_t depth;
+    uword pcs[kMaxStackDepth];  // Innermost frame first.
+  };
+
+  static const uword kReservedKey = 1;
+  static const intptr_t kMaxProbes = 64;
+
+  // Records the return addresses of the frames from fp up to the entry frame
+  // of the first invocation of Dart code. Returns false if the frames do not
+  // lead to an entry frame.
+  static bool CollectFrames(uword fp,
+                            uword stack_lower,
+                            uword stack_upper,
+                            Sample* sample);
+  static void AddSample(const Sample& sample);
+
+  // Implemented by the platform specific files.
+  static bool StartTimer(intptr_t period_micros);
+  static void StopTimer();
+  static void WriteMappedRegions(Dart_ProfileWriteCallback callback,
+                                 void* stream);
+
+  static Mutex* mutex_;  // Protects starting, stopping and writing.
+  static Sample* samples_;
+  static intptr_t period_micros_;
+  static uword is_running_;
+  static intptr_t num_running_handlers_;
+  static intptr_t num_dropped_samples_;
+};
+
+}  // namespace dart
+
+#endif  // VM_PROFILER_H_
@@ -0,0 +1,83 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/profiler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "platform/assert.h"
+
+namespace dart {
+
+static void ProfileSignalHandler(int signal, siginfo_t* info, void* context) {
+  // The interrupted code may depend on errno.
+  int saved_errno = errno;
+  mcontext_t mcontext = reinterpret_cast<ucontext_t*>(context)->uc_mcontext;
+#if defined(HOST_ARCH_IA32)
+  uword pc = static_cast<uword>(mcontext.gregs[REG_EIP]);
+  uword fp = static_cast<uword>(mcontext.gregs[REG_EBP]);
+  uword sp = static_cast<uword>(mcontext.gregs[REG_ESP]);
+#elif defined(HOST_ARCH_X64)
+  uword pc = static_cast<uword>(mcontext.gregs[REG_RIP]);
+  uword fp = static_cast<uword>(mcontext.gregs[REG_RBP]);
+  uword sp = static_cast<uword>(mcontext.gregs[REG_RSP]);
+#elif defined(HOST_ARCH_ARM)
+  uword pc = static_cast<uword>(mcontext.arm_pc);
+  uword fp = static_cast<uword>(mcontext.arm_fp);
+  uword sp = static_cast<uword>(mcontext.arm_sp);
+#else
+#error Unsupported architecture.
+#endif
+  Profiler::RecordSample(pc, fp, sp);
+  errno = saved_errno;
+}
+
+
+bool Profiler::StartTimer(intptr_t period_micros) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = ProfileSignalHandler;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, NULL) != 0) {
+    return false;
+  }
+  struct itimerval timer;
+  timer.it_interval.tv_sec = period_micros / kMicrosecondsPerSecond;
+  timer.it_interval.tv_usec = period_micros % kMicrosecondsPerSecond;
+  timer.it_value = timer.it_interval;
+  return setitimer(ITIMER_PROF, &timer, NULL) == 0;
+}
+
+
+void Profiler::StopTimer() {
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  // A signal which is still pending must not terminate the process.
+  signal(SIGPROF, SIG_IGN);
+}
+
+
+void Profiler::WriteMappedRegions(Dart_ProfileWriteCallback callback,
+                                  void* stream) {
+  // pprof maps the sampled addresses to the binaries and shared libraries.
+  int fd = TEMP_FAILURE_RETRY(open("/proc/self/maps", O_RDONLY));
+  if (fd < 0) {
+    return;
+  }
+  char buffer[4 * KB];
+  intptr_t length;
+  while ((length = TEMP_FAILURE_RETRY(read(fd, buffer, sizeof(buffer)))) > 0) {
+    callback(buffer, length, stream);
+  }
+  close(fd);
+}
+
+}  // namespace dart
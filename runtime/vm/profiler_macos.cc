@@ -0,0 +1,67 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/profiler.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/ucontext.h>
+
+#include "platform/assert.h"
+
+namespace dart {
+
+static void ProfileSignalHandler(int signal, siginfo_t* info, void* context) {
+  // The interrupted code may depend on errno.
+  int saved_errno = errno;
+  mcontext_t mcontext = reinterpret_cast<ucontext_t*>(context)->uc_mcontext;
+#if defined(HOST_ARCH_IA32)
+  uword pc = static_cast<uword>(mcontext->__ss.__eip);
+  uword fp = static_cast<uword>(mcontext->__ss.__ebp);
+  uword sp = static_cast<uword>(mcontext->__ss.__esp);
+#elif defined(HOST_ARCH_X64)
+  uword pc = static_cast<uword>(mcontext->__ss.__rip);
+  uword fp = static_cast<uword>(mcontext->__ss.__rbp);
+  uword sp = static_cast<uword>(mcontext->__ss.__rsp);
+#else
+#error Unsupported architecture.
+#endif
+  Profiler::RecordSample(pc, fp, sp);
+  errno = saved_errno;
+}
+
+
+bool Profiler::StartTimer(intptr_t period_micros) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = ProfileSignalHandler;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, NULL) != 0) {
+    return false;
+  }
+  struct itimerval timer;
+  timer.it_interval.tv_sec = period_micros / kMicrosecondsPerSecond;
+  timer.it_interval.tv_usec = period_micros % kMicrosecondsPerSecond;
+  timer.it_value = timer.it_interval;
+  return setitimer(ITIMER_PROF, &timer, NULL) == 0;
+}
+
+
+void Profiler::StopTimer() {
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  // A signal which is still pending must not terminate the process.
+  signal(SIGPROF, SIG_IGN);
+}
+
+
+void Profiler::WriteMappedRegions(Dart_ProfileWriteCallback callback,
+                                  void* stream) {
+  // Nothing to do as there is no /proc/self/maps on macos.
+}
+
+}  // namespace dart
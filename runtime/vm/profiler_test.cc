@@ -0,0 +1,184 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "platform/assert.h"
+#include "vm/growable_array.h"
+#include "vm/os.h"
+#include "vm/profiler.h"
+#include "vm/stack_frame.h"
+#include "vm/stub_code.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+static void ProfileWriteCallback(const void* data,
+                                 intptr_t length,
+                                 void* stream) {
+  GrowableArray<uint8_t>* array =
+      reinterpret_cast<GrowableArray<uint8_t>*>(stream);
+  for (intptr_t i = 0; i < length; ++i) {
+    array->Add(reinterpret_cast<const uint8_t*>(data)[i]);
+  }
+}
+
+
+static intptr_t ReadWord(GrowableArray<uint8_t>* array, intptr_t* i) {
+  EXPECT_LE(*i + kWordSize, array->length());
+  intptr_t result;
+  memmove(&result, &(*array)[*i], kWordSize);
+  *i += kWordSize;
+  return result;
+}
+
+
+TEST_CASE(Profiler_AggregateSamples) {
+  // The period is long enough for the timer to never fire during the test.
+  const intptr_t kPeriod = 100 * kMicrosecondsPerSecond;
+  EXPECT(Profiler::Start(kPeriod));
+  EXPECT(Profiler::IsRunning());
+  EXPECT(!Profiler::Start(kPeriod));
+  // There are no Dart frames, only the pcs are recorded.
+  Profiler::RecordSample(0x1000, 0, 0);
+  Profiler::RecordSample(0x2000, 0, 0);
+  Profiler::RecordSample(0x1000, 0, 0);
+  Profiler::Stop();
+  EXPECT(!Profiler::IsRunning());
+  // Samples are not recorded after stopping.
+  Profiler::RecordSample(0x1000, 0, 0);
+  EXPECT_EQ(3, Profiler::num_samples());
+  EXPECT_EQ(0, Profiler::num_dropped_samples());
+
+  GrowableArray<uint8_t> array;
+  Profiler::WritePprof(ProfileWriteCallback, &array);
+  intptr_t i = 0;
+  EXPECT_EQ(0, ReadWord(&array, &i));
+  EXPECT_EQ(3, ReadWord(&array, &i));
+  EXPECT_EQ(0, ReadWord(&array, &i));
+  EXPECT_EQ(kPeriod, ReadWord(&array, &i));
+  EXPECT_EQ(0, ReadWord(&array, &i));
+  intptr_t num_records = 0;
+  intptr_t count = ReadWord(&array, &i);
+  while (count != 0) {
+    EXPECT_EQ(1, ReadWord(&array, &i));
+    intptr_t pc = ReadWord(&array, &i);
+    if (pc == 0x1000) {
+      EXPECT_EQ(2, count);
+    } else {
+      EXPECT_EQ(0x2000, pc);
+      EXPECT_EQ(1, count);
+    }
+    num_records++;
+    count = ReadWord(&array, &i);
+  }
+  EXPECT_EQ(2, num_records);
+  EXPECT_EQ(1, ReadWord(&array, &i));
+  EXPECT_EQ(0, ReadWord(&array, &i));
+}
+
+
+TEST_CASE(Profiler_WalkFramePointers) {
+  // Frames laid out like two Dart frames called from the invocation stub. The
+  // walk reads only these words, none of them are code or heap addresses.
+  const intptr_t kEntryFrame = 24;
+  uword stack[32];
+  memset(stack, 0, sizeof(stack));
+  stack[2] = reinterpret_cast<uword>(&stack[4]);
+  stack[3] = 0x1000;
+  stack[4] = reinterpret_cast<uword>(&stack[kEntryFrame]);
+  stack[5] = StubCode::InvokeDartCodeEntryPoint() + 1;
+  // The entry frame links to no exit frame, there are no more Dart frames.
+  stack[kEntryFrame + EntryFrame::ExitLinkOffset() / kWordSize] = 0;
+  // A frame whose caller is not a frame.
+  stack[6] = 0x42;
+  stack[7] = 0x3000;
+  // Frames are only walked from pcs in generated code.
+  const uword kDartPc = StubCode::CallToRuntimeEntryPoint() + 1;
+  const uword kOtherDartPc = StubCode::AllocateArrayEntryPoint() + 1;
+  const uword kNativePc = 0x4000;
+
+  const intptr_t kPeriod = 100 * kMicrosecondsPerSecond;
+  EXPECT(Profiler::Start(kPeriod));
+  const uword sp = reinterpret_cast<uword>(&stack[0]);
+  Profiler::RecordSample(kDartPc, reinterpret_cast<uword>(&stack[2]), sp);
+  // Frames which do not lead to an entry frame are dropped.
+  Profiler::RecordSample(kOtherDartPc, reinterpret_cast<uword>(&stack[6]), sp);
+  // The frame pointer of native code is not trusted.
+  Profiler::RecordSample(kNativePc, reinterpret_cast<uword>(&stack[2]), sp);
+  Profiler::Stop();
+  EXPECT_EQ(3, Profiler::num_samples());
+
+  GrowableArray<uint8_t> array;
+  Profiler::WritePprof(ProfileWriteCallback, &array);
+  intptr_t i = 5 * kWordSize;  // Skip the header.
+  intptr_t num_records = 0;
+  intptr_t count = ReadWord(&array, &i);
+  while (count != 0) {
+    EXPECT_EQ(1, count);
+    intptr_t depth = ReadWord(&array, &i);
+    EXPECT_LE(1, depth);
+    uword pcs[2] = { 0, 0 };
+    for (intptr_t j = 0; j < depth; j++) {
+      uword pc = ReadWord(&array, &i);
+      if (j < 2) {
+        pcs[j] = pc;
+      }
+    }
+    if (pcs[0] == kDartPc) {
+      EXPECT_EQ(2, depth);
+      EXPECT_EQ(0x1000, pcs[1]);
+    } else {
+      EXPECT(pcs[0] == kOtherDartPc || pcs[0] == kNativePc);
+      EXPECT_EQ(1, depth);
+    }
+    num_records++;
+    count = ReadWord(&array, &i);
+  }
+  EXPECT_EQ(3, num_records);
+}
+
+
+// Only ia32 and x64 can run execution tests.
+#if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
+TEST_CASE(Profiler_FlameGraph) {
+  const char* kScriptChars =
+      "class ProfilerTest {\n"
+      "  static int fib(int n) {\n"
+      "    return (n < 2) ? n : fib(n - 1) + fib(n - 2);\n"
+      "  }\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle cls = Dart_GetClass(lib, Dart_NewString("ProfilerTest"));
+  EXPECT_VALID(cls);
+  Dart_Handle args[1];
+  args[0] = Dart_NewInteger(15);
+
+  if (!Dart_StartProfiling(1000)) {
+    return;  // Sampling is not supported on this platform.
+  }
+  const int64_t kMaxMillis = 10000;
+  int64_t start = OS::GetCurrentTimeMillis();
+  while ((Profiler::num_samples() < 50) &&
+         ((OS::GetCurrentTimeMillis() - start) < kMaxMillis)) {
+    EXPECT_VALID(Dart_Invoke(cls, Dart_NewString("fib"), 1, args));
+  }
+  Dart_StopProfiling();
+  EXPECT_LE(50, Profiler::num_samples());
+
+  GrowableArray<uint8_t> array;
+  EXPECT_VALID(Dart_WriteProfile(kFlameGraphProfileFormat,
+                                 ProfileWriteCallback,
+                                 &array));
+  array.Add('\0');
+  const char* profile = reinterpret_cast<const char*>(array.data());
+  // The recursive calls are walked, the callers of fib are fib.
+  const char* caller = strstr(profile, "ProfilerTest_fib;");
+  EXPECT(caller != NULL);
+  if (caller != NULL) {
+    const char* callee = caller + strlen("ProfilerTest_fib;");
+    EXPECT(strstr(callee, "ProfilerTest_fib") != NULL);
+  }
+}
+#endif  // TARGET_ARCH_IA32 || TARGET_ARCH_X64
+
+}  // namespace dart
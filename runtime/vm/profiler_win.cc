@@ -0,0 +1,23 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/profiler.h"
+
+namespace dart {
+
+bool Profiler::StartTimer(intptr_t period_micros) {
+  // There is no SIGPROF on win32, sampling is not supported.
+  return false;
+}
+
+
+void Profiler::StopTimer() {
+}
+
+
+void Profiler::WriteMappedRegions(Dart_ProfileWriteCallback callback,
+                                  void* stream) {
+}
+
+}  // namespace dart
@@ -33,12 +33,28 @@ void RawObject::Validate(Isolate* isolate) const {
 
 
 intptr_t RawObject::SizeFromClass() const {
-  NoHandleScope no_handles(Isolate::Current());
+  return SizeFromClassId(GetClassId());
+}
+
+
+intptr_t RawObject::SizeFromTags(uword tags) const {
+  intptr_t result = SizeTag::decode(tags);
+  if (result != 0) {
+    return result;
+  }
+  result = SizeFromClassId(ClassIdTag::decode(tags));
+  ASSERT(result > SizeTag::kMaxSizeTag);
+  return result;
+}
 
+
+// Does not allocate any handles. This is also called from the parallel
+// scavenger tasks, which must not touch the isolate's handle scope state.
+intptr_t RawObject::SizeFromClassId(intptr_t class_id) const {
   // Only reasonable to be called on heap objects.
   ASSERT(IsHeapObject());
 
-  RawClass* raw_class = Isolate::Current()->class_table()->At(GetClassId());
+  RawClass* raw_class = Isolate::Current()->class_table()->At(class_id);
   intptr_t instance_size = raw_class->ptr()->instance_size_;
   ObjectKind instance_kind = raw_class->ptr()->instance_kind_;
 
@@ -47,8 +63,8 @@ intptr_t RawObject::SizeFromClass() const {
       case kTokenStream: {
         const RawTokenStream* raw_tokens =
             reinterpret_cast<const RawTokenStream*>(this);
-        intptr_t tokens_length = Smi::Value(raw_tokens->ptr()->length_);
-        instance_size = TokenStream::InstanceSize(tokens_length);
+        intptr_t data_length = raw_tokens->ptr()->data_length_;
+        instance_size = TokenStream::InstanceSize(data_length);
         break;
       }
       case kCode: {
@@ -391,9 +407,8 @@ intptr_t RawLiteralToken::VisitLiteralTokenPointers(
 
 intptr_t RawTokenStream::VisitTokenStreamPointers(
     RawTokenStream* raw_obj, ObjectPointerVisitor* visitor) {
-  intptr_t length = Smi::Value(raw_obj->ptr()->length_);
-  visitor->VisitPointers(raw_obj->from(), raw_obj->to(length));
-  return TokenStream::InstanceSize(length);
+  visitor->VisitPointers(raw_obj->from(), raw_obj->to());
+  return TokenStream::InstanceSize(raw_obj->ptr()->data_length_);
 }
 
 
@@ -285,6 +285,11 @@ class RawObject {
     return result;
   }
 
+  // Returns the size of the object as described by the given header word
+  // instead of the one currently stored in the object. The parallel
+  // scavenger overwrites the header while it copies the object.
+  intptr_t SizeFromTags(uword tags) const;
+
   void Validate(Isolate* isolate) const;
   intptr_t VisitPointers(ObjectPointerVisitor* visitor);
   bool FindObject(FindObjectVisitor* visitor);
@@ -337,6 +342,7 @@ class RawObject {
   }
 
   intptr_t SizeFromClass() const;
+  intptr_t SizeFromClassId(intptr_t class_id) const;
 
   intptr_t GetClassId() const {
     uword tags = ptr()->tags_;
@@ -349,8 +355,10 @@ class RawObject {
   friend class Array;
   friend class FreeListElement;
   friend class Heap;
+  friend class HeapImage;
   friend class HeapProfiler;
   friend class HeapProfilerRootVisitor;
+  friend class IncrementalMarker;
   friend class MarkingVisitor;
   friend class Object;
   friend class RawInstructions;
@@ -390,6 +398,8 @@ class RawClass : public RawObject {
   RawArray* functions_cache_;  // See class FunctionsCache.
   RawArray* constants_;  // Canonicalized values of this class.
   RawArray* canonical_types_;  // Canonicalized types of this class.
+  RawArray* functions_index_;  // Hash index of functions_ or null.
+  RawArray* fields_index_;  // Hash index of fields_ or null.
   RawCode* allocation_stub_;  // Stub code for allocation of instances.
   RawObject** to() {
     return reinterpret_cast<RawObject**>(&ptr()->allocation_stub_);
@@ -627,12 +637,14 @@ class RawTokenStream : public RawObject {
   }
   RawString* private_key_;  // Key used for private identifiers.
   RawSmi* length_;  // Number of tokens.
-
-  // Variable length data follows here.
-  RawObject* data_[0];
-  RawObject** to(intptr_t length) {
-    return reinterpret_cast<RawObject**>(&ptr()->data_[length - 1]);
+  RawArray* literals_;  // Identifier symbols and LiteralTokens.
+  RawObject** to() {
+    return reinterpret_cast<RawObject**>(&ptr()->literals_);
   }
+  intptr_t data_length_;  // Number of bytes of data_.
+
+  // Variable length data follows here (checkpoints and encoded tokens).
+  uint8_t data_[0];
 
   friend class SnapshotReader;
 };
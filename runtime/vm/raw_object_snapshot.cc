@@ -3,6 +3,7 @@
 // BSD-style license that can be found in the LICENSE file.
 
 #include "vm/bigint_operations.h"
+#include "vm/message.h"
 #include "vm/object.h"
 #include "vm/object_store.h"
 #include "vm/snapshot.h"
@@ -65,7 +66,8 @@ RawClass* Class::ReadFrom(SnapshotReader* reader,
     // allocations may happen.
     intptr_t num_flds = (cls.raw()->to() - cls.raw()->from());
     for (intptr_t i = 0; i <= num_flds; i++) {
-      *(cls.raw()->from() + i) = reader->ReadObjectRef();
+      RawObject* value = reader->ReadObjectRef();
+      cls.StorePointer(cls.raw()->from() + i, value);
     }
   } else {
     cls ^= reader->ReadClassId(object_id);
@@ -100,9 +102,15 @@ void RawClass::WriteTo(SnapshotWriter* writer,
     writer->Write<bool>(ptr()->is_const_);
     writer->Write<bool>(ptr()->is_interface_);
 
-    // Write out all the object pointer fields.
+    // Write out all the object pointer fields. Code is not written to
+    // snapshots, so the functions cache is written as null and the class
+    // starts without one.
     SnapshotWriterVisitor visitor(writer);
-    visitor.VisitPointers(from(), to());
+    RawObject** functions_cache =
+        reinterpret_cast<RawObject**>(&ptr()->functions_cache_);
+    visitor.VisitPointers(from(), functions_cache - 1);
+    writer->WriteObjectRef(Object::null());
+    visitor.VisitPointers(functions_cache + 1, to());
   } else {
     writer->WriteClassId(this);
   }
@@ -132,7 +140,8 @@ RawUnresolvedClass* UnresolvedClass::ReadFrom(SnapshotReader* reader,
   intptr_t num_flds = (unresolved_class.raw()->to() -
                        unresolved_class.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(unresolved_class.raw()->from() + i) = reader->ReadObjectRef();
+    RawObject* value = reader->ReadObjectRef();
+    unresolved_class.StorePointer(unresolved_class.raw()->from() + i, value);
   }
   return unresolved_class.raw();
 }
@@ -199,7 +208,9 @@ RawType* Type::ReadFrom(SnapshotReader* reader,
   intptr_t num_flds = (parameterized_type.raw()->to() -
                        parameterized_type.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(parameterized_type.raw()->from() + i) = reader->ReadObjectImpl();
+    RawObject* value = reader->ReadObjectImpl();
+    parameterized_type.StorePointer(parameterized_type.raw()->from() + i,
+                                    value);
   }
 
   // If object needs to be a canonical object, Canonicalize it.
@@ -256,7 +267,8 @@ RawTypeParameter* TypeParameter::ReadFrom(SnapshotReader* reader,
   intptr_t num_flds = (type_parameter.raw()->to() -
                        type_parameter.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(type_parameter.raw()->from() + i) = reader->ReadObjectImpl();
+    RawObject* value = reader->ReadObjectImpl();
+    type_parameter.StorePointer(type_parameter.raw()->from() + i, value);
   }
 
   return type_parameter.raw();
@@ -381,7 +393,9 @@ RawInstantiatedTypeArguments* InstantiatedTypeArguments::ReadFrom(
   intptr_t num_flds = (instantiated_type_arguments.raw()->to() -
                        instantiated_type_arguments.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(instantiated_type_arguments.raw()->from() + i) = reader->ReadObjectImpl();
+    RawObject* value = reader->ReadObjectImpl();
+    instantiated_type_arguments.StorePointer(
+        instantiated_type_arguments.raw()->from() + i, value);
   }
   return instantiated_type_arguments.raw();
 }
@@ -439,7 +453,8 @@ RawFunction* Function::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (func.raw()->to() - func.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(func.raw()->from() + i) = reader->ReadObjectRef();
+    RawObject* value = reader->ReadObjectRef();
+    func.StorePointer(func.raw()->from() + i, value);
   }
 
   return func.raw();
@@ -504,7 +519,8 @@ RawField* Field::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (field.raw()->to() - field.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(field.raw()->from() + i) = reader->ReadObjectRef();
+    RawObject* value = reader->ReadObjectRef();
+    field.StorePointer(field.raw()->from() + i, value);
   }
 
   return field.raw();
@@ -592,22 +608,29 @@ RawTokenStream* TokenStream::ReadFrom(SnapshotReader* reader,
   ASSERT(reader != NULL);
   ASSERT(kind != Snapshot::kMessage && !RawObject::IsCreatedFromSnapshot(tags));
 
-  // Read the length so that we can determine number of tokens to read.
+  // Read the number of tokens and the length of the encoded data so that
+  // we can determine the instance size to allocate.
   intptr_t len = reader->ReadSmiValue();
+  intptr_t data_length = reader->Read<intptr_t>();
 
   // Create the token stream object.
   TokenStream& token_stream = TokenStream::ZoneHandle(
-      reader->isolate(), NEW_OBJECT_WITH_LEN(TokenStream, len));
+      reader->isolate(), NEW_OBJECT_WITH_LEN(TokenStream, data_length));
   reader->AddBackRef(object_id, &token_stream, kIsDeserialized);
 
   // Set the object tags.
   token_stream.set_tags(tags);
+  token_stream.SetLength(len);
 
-  // Read the token stream into the TokenStream.
-  for (intptr_t i = 0; i < len; i++) {
-    *reader->ObjectHandle() = reader->ReadObjectImpl();
-    token_stream.SetTokenAt(i, *reader->ObjectHandle());
+  // Read the checkpoints and encoded tokens.
+  if (data_length > 0) {
+    reader->ReadBytes(token_stream.DataAddr(0), data_length);
   }
+
+  // Read the identifiers and literals of the tokens.
+  Array& literals = Array::Handle(reader->isolate());
+  literals ^= reader->ReadObjectImpl();
+  token_stream.set_literals(literals);
   return token_stream.raw();
 }
 
@@ -626,14 +649,17 @@ void RawTokenStream::WriteTo(SnapshotWriter* writer,
   writer->WriteObjectHeader(Object::kTokenStreamClass,
                             writer->GetObjectTags(this));
 
-  // Write out the length field.
+  // Write out the length fields.
   writer->Write<RawObject*>(ptr()->length_);
+  writer->Write<intptr_t>(ptr()->data_length_);
 
-  // Write out the token stream (token kind and literal).
-  intptr_t len = Smi::Value(ptr()->length_);
-  for (intptr_t i = 0; i < TokenStream::StreamLength(len); i++) {
-    writer->WriteObjectImpl(ptr()->data_[i]);
+  // Write out the checkpoints and encoded tokens.
+  for (intptr_t i = 0; i < ptr()->data_length_; i++) {
+    writer->Write<uint8_t>(ptr()->data_[i]);
   }
+
+  // Write out the identifiers and literals of the tokens.
+  writer->WriteObjectImpl(ptr()->literals_);
 }
 
 
@@ -729,7 +755,8 @@ RawLibrary* Library::ReadFrom(SnapshotReader* reader,
     // allocations may happen.
     intptr_t num_flds = (library.raw()->to() - library.raw()->from());
     for (intptr_t i = 0; i <= num_flds; i++) {
-      *(library.raw()->from() + i) = reader->ReadObjectRef();
+      RawObject* value = reader->ReadObjectRef();
+      library.StorePointer(library.raw()->from() + i, value);
     }
     if (kind != Snapshot::kFull) {
       library.Register();
@@ -801,7 +828,8 @@ RawLibraryPrefix* LibraryPrefix::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (prefix.raw()->to() - prefix.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(prefix.raw()->from() + i) = reader->ReadObjectRef();
+    RawObject* value = reader->ReadObjectRef();
+    prefix.StorePointer(prefix.raw()->from() + i, value);
   }
 
   return prefix.raw();
@@ -956,7 +984,8 @@ RawContext* Context::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (context.raw()->to(num_vars) - context.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(context.raw()->from() + i) = reader->ReadObjectRef();
+    RawObject* value = reader->ReadObjectRef();
+    context.StorePointer(context.raw()->from() + i, value);
   }
 
   return context.raw();
@@ -1006,7 +1035,8 @@ RawContextScope* ContextScope::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (scope.raw()->to(num_vars) - scope.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(scope.raw()->from() + i) = reader->ReadObjectRef();
+    RawObject* value = reader->ReadObjectRef();
+    scope.StorePointer(scope.raw()->from() + i, value);
   }
 
   return scope.raw();
@@ -1811,10 +1841,49 @@ RawExternal##name##Array* External##name##Array::ReadFrom(                     \
 }                                                                              \
 
 
-BYTEARRAY_TYPE_LIST(EXTERNALARRAY_READ_FROM)
+EXTERNALARRAY_READ_FROM(Int8, int8_t)
+EXTERNALARRAY_READ_FROM(Int16, int16_t)
+EXTERNALARRAY_READ_FROM(Uint16, uint16_t)
+EXTERNALARRAY_READ_FROM(Int32, int32_t)
+EXTERNALARRAY_READ_FROM(Uint32, uint32_t)
+EXTERNALARRAY_READ_FROM(Int64, int64_t)
+EXTERNALARRAY_READ_FROM(Uint64, uint64_t)
+EXTERNALARRAY_READ_FROM(Float32, float)
+EXTERNALARRAY_READ_FROM(Float64, double)
 #undef EXTERNALARRAY_READ_FROM
 
 
+static void FreeMessageBuffer(void* peer) {
+  free(peer);
+}
+
+
+RawExternalUint8Array* ExternalUint8Array::ReadFrom(SnapshotReader* reader,
+                                                    intptr_t object_id,
+                                                    intptr_t tags,
+                                                    Snapshot::Kind kind) {
+  ASSERT(reader != NULL);
+  ASSERT(kind == Snapshot::kMessage);
+
+  // The contents of the array were sent as an out-of-band buffer of the
+  // message, the array takes ownership of the buffer instead of copying it.
+  MessageBuffers* buffers = reader->buffers();
+  ASSERT(buffers != NULL);
+  intptr_t len = reader->ReadSmiValue();
+  intptr_t index = reader->ReadIntptrValue();
+  ASSERT(buffers->SizeAt(index) == len);
+  uint8_t* data = buffers->Take(index);
+  ExternalUint8Array& result = ExternalUint8Array::ZoneHandle(
+      reader->isolate(),
+      ExternalUint8Array::New(data, len, data, FreeMessageBuffer));
+  reader->AddBackRef(object_id, &result, kIsDeserialized);
+
+  // Set the object tags.
+  result.set_tags(tags);
+  return result.raw();
+}
+
+
 static void ByteArrayWriteTo(SnapshotWriter* writer,
                              intptr_t object_id,
                              Snapshot::Kind kind,
@@ -1828,6 +1897,20 @@ static void ByteArrayWriteTo(SnapshotWriter* writer,
   // Write out the serialization header value for this object.
   writer->WriteSerializationMarker(kInlined, object_id);
 
+  // Large byte arrays are copied into an out-of-band buffer of the message
+  // which the receiver reads as an external array.
+  if ((writer->buffers() != NULL) &&
+      (byte_array_kind == ObjectStore::kUint8ArrayClass) &&
+      (len >= SnapshotWriter::kMinOutOfBandLength)) {
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(malloc(len));
+    memmove(buffer, data, len);
+    intptr_t index = writer->buffers()->Add(buffer, len);
+    writer->WriteObjectHeader(ObjectStore::kExternalUint8ArrayClass, tags);
+    writer->Write<RawObject*>(length);
+    writer->WriteIntptrValue(index);
+    return;
+  }
+
   // Write out the class and tags information.
   writer->WriteObjectHeader(byte_array_kind, tags);
 
@@ -4,16 +4,28 @@
 
 #include "vm/scavenger.h"
 
+#include "platform/thread.h"
+#include "vm/atomic.h"
 #include "vm/dart.h"
 #include "vm/dart_api_state.h"
+#include "vm/freelist.h"
 #include "vm/isolate.h"
 #include "vm/object.h"
+#include "vm/pages.h"
 #include "vm/stack_frame.h"
+#include "vm/store_buffer.h"
+#include "vm/thread_pool.h"
 #include "vm/verifier.h"
 #include "vm/visitor.h"
 
 namespace dart {
 
+DEFINE_FLAG(bool, parallel_scavenge, false,
+            "Copy surviving objects using multiple threads during a scavenge.");
+DEFINE_FLAG(int, scavenger_tasks, 0,
+            "Number of threads copying objects in a parallel scavenge, "
+            "0 uses one per available processor.");
+
 // Scavenger uses RawObject::kFreeBit to distinguish forwaded and non-forwarded
 // objects because scavenger can never encounter free list element during
 // evacuation and thus all objects scavenger encounters have
@@ -22,6 +34,9 @@ enum {
   kForwardingMask = 1,
   kNotForwarded = 0,
   kForwarded = 1,
+  // During a parallel scavenge the header of an object which is being copied
+  // holds a forwarding pointer to address 0 until the copy is complete.
+  kForwardingInProgress = kForwarded,
 };
 
 
@@ -45,13 +60,207 @@ static inline void ForwardTo(uword orignal, uword target) {
 }
 
 
+// A block of addresses of copied objects whose pointers still need to be
+// visited during a parallel scavenge.
+class ScavengerWorkBlock {
+ public:
+  static const intptr_t kSize = 256;
+
+  ScavengerWorkBlock() : next_(NULL), top_(0) {}
+
+  ScavengerWorkBlock* next() const { return next_; }
+  void set_next(ScavengerWorkBlock* next) { next_ = next; }
+
+  bool IsFull() const { return top_ == kSize; }
+  bool IsEmpty() const { return top_ == 0; }
+  intptr_t Count() const { return top_; }
+
+  void Push(uword addr) {
+    ASSERT(top_ < kSize);
+    addresses_[top_++] = addr;
+  }
+
+  uword Pop() {
+    ASSERT(top_ > 0);
+    return addresses_[--top_];
+  }
+
+ private:
+  ScavengerWorkBlock* next_;
+  intptr_t top_;
+  uword addresses_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ScavengerWorkBlock);
+};
+
+
+// The work blocks shared between the workers of a parallel scavenge. The
+// scavenge is complete once all workers are idle and no blocks are left.
+//
+// The helper tasks access the work list while the isolate is set as the
+// current isolate of their thread, so the monitor is entered directly
+// instead of through a MonitorLocker which would link itself into the
+// resource chain of the isolate.
+class ScavengerWorkList {
+ public:
+  explicit ScavengerWorkList(intptr_t num_workers)
+      : blocks_(NULL),
+        num_workers_(num_workers),
+        idle_workers_(0),
+        running_tasks_(0),
+        done_(false) {}
+
+  ~ScavengerWorkList() {
+    ASSERT(blocks_ == NULL);
+  }
+
+  void Publish(ScavengerWorkBlock* block) {
+    ASSERT(!block->IsEmpty());
+    monitor_.Enter();
+    ASSERT(!done_);
+    block->set_next(blocks_);
+    blocks_ = block;
+    monitor_.Notify();
+    monitor_.Exit();
+  }
+
+  // Returns the next block of work, waiting for other workers to publish
+  // more if needed. Returns NULL once all workers have run out of work.
+  ScavengerWorkBlock* Take() {
+    monitor_.Enter();
+    idle_workers_++;
+    while ((blocks_ == NULL) && !done_) {
+      if (idle_workers_ == num_workers_) {
+        done_ = true;
+        monitor_.NotifyAll();
+      } else {
+        monitor_.Wait(Monitor::kNoTimeout);
+      }
+    }
+    ScavengerWorkBlock* result = blocks_;
+    if (result != NULL) {
+      blocks_ = result->next();
+      result->set_next(NULL);
+      idle_workers_--;
+    }
+    monitor_.Exit();
+    return result;
+  }
+
+  // Read without holding the monitor, only used as a hint to share work.
+  bool HasIdleWorkers() const { return idle_workers_ > 0; }
+
+  void TaskStarted() {
+    monitor_.Enter();
+    running_tasks_++;
+    monitor_.Exit();
+  }
+
+  void TaskDone() {
+    monitor_.Enter();
+    running_tasks_--;
+    monitor_.NotifyAll();
+    monitor_.Exit();
+  }
+
+  void WaitForTasks() {
+    monitor_.Enter();
+    while (running_tasks_ > 0) {
+      monitor_.Wait(Monitor::kNoTimeout);
+    }
+    monitor_.Exit();
+  }
+
+ private:
+  Monitor monitor_;
+  ScavengerWorkBlock* blocks_;
+  intptr_t num_workers_;
+  volatile intptr_t idle_workers_;
+  intptr_t running_tasks_;
+  bool done_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScavengerWorkList);
+};
+
+
+// The per thread state of a parallel scavenge. Each worker copies objects
+// into its own allocation buffers in the to space and in old space, and
+// records the old to new pointers it creates in its own store buffer.
+class ScavengerWorker {
+ public:
+  ScavengerWorker(Scavenger* scavenger,
+                  ScavengerWorkList* work_list,
+                  Mutex* promotion_mutex);
+  ~ScavengerWorker();
+
+  ScavengerVisitor* visitor() const { return visitor_; }
+
+  // Returns the new address of the object at raw_addr in the from space,
+  // copying the object if no other worker has done so yet.
+  uword ForwardObject(uword raw_addr);
+
+  // Visit copied objects until all workers have run out of work.
+  void ProcessWork();
+
+  // Hand the locally pending work over to the other workers.
+  void PublishWork();
+
+  // Called on the mutator thread once all workers are done.
+  void Finish(Isolate* isolate);
+
+  intptr_t copied_bytes() const { return copied_bytes_; }
+  intptr_t promoted_bytes() const { return promoted_bytes_; }
+
+ private:
+  // Size of the buffers claimed from the to space and old space at a time.
+  static const intptr_t kLabSize = 8 * KB;
+
+  void PushWork(uword addr);
+  void ScanObject(uword addr);
+  uword TryAllocateInToSpace(intptr_t size);
+  uword TryPromote(intptr_t size);
+
+  Scavenger* scavenger_;
+  ScavengerWorkList* work_list_;
+  Mutex* promotion_mutex_;
+  StoreBuffer store_buffer_;
+  ScavengerVisitor* visitor_;
+  ScavengerWorkBlock* work_;
+
+  uword to_top_;
+  uword to_end_;
+  uword promotion_top_;
+  uword promotion_end_;
+
+  intptr_t copied_bytes_;
+  intptr_t promoted_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScavengerWorker);
+};
+
+
 class ScavengerVisitor : public ObjectPointerVisitor {
  public:
   explicit ScavengerVisitor(Isolate* isolate, Scavenger* scavenger)
       : ObjectPointerVisitor(isolate),
         scavenger_(scavenger),
         heap_(scavenger->heap_),
-        vm_heap_(Dart::vm_isolate()->heap()) {}
+        vm_heap_(Dart::vm_isolate()->heap()),
+        store_buffer_(isolate->store_buffer()),
+        worker_(NULL),
+        visiting_old_pointers_(false) {}
+
+  // Visitor of a parallel scavenge worker. It does not touch the isolate.
+  ScavengerVisitor(Scavenger* scavenger,
+                   ScavengerWorker* worker,
+                   StoreBuffer* store_buffer)
+      : ObjectPointerVisitor(NULL),
+        scavenger_(scavenger),
+        heap_(scavenger->heap_),
+        vm_heap_(Dart::vm_isolate()->heap()),
+        store_buffer_(store_buffer),
+        worker_(worker),
+        visiting_old_pointers_(false) {}
 
   void VisitPointers(RawObject** first, RawObject** last) {
     for (RawObject** current = first; current <= last; current++) {
@@ -59,9 +268,22 @@ class ScavengerVisitor : public ObjectPointerVisitor {
     }
   }
 
+  // Pointers visited while this is set are slots in old space objects, which
+  // need to be remembered if they still point into new space afterwards.
+  void VisitingOldPointers(bool value) { visiting_old_pointers_ = value; }
+
  private:
   void UpdateStoreBuffer(RawObject** p, RawObject* obj) {
-    // TODO(iposva): Implement store buffers.
+    if (visiting_old_pointers_ && obj->IsNewObject()) {
+      store_buffer_->AddPointer(reinterpret_cast<uword>(p));
+    }
+  }
+
+  void UpdatePointer(RawObject** p, uword new_addr) {
+    RawObject* new_obj = RawObject::FromAddr(new_addr);
+    *p = new_obj;
+    // Update the store buffer as needed.
+    UpdateStoreBuffer(p, new_obj);
   }
 
   void ScavengePointer(RawObject** p) {
@@ -79,6 +301,12 @@ class ScavengerVisitor : public ObjectPointerVisitor {
       return;
     }
 
+    if (worker_ != NULL) {
+      // Other workers may be copying the same object concurrently.
+      UpdatePointer(p, worker_->ForwardObject(raw_addr));
+      return;
+    }
+
     // Read the header word of the object and determine if the object has
     // already been copied.
     uword header = *reinterpret_cast<uword*>(raw_addr);
@@ -122,20 +350,324 @@ class ScavengerVisitor : public ObjectPointerVisitor {
       ForwardTo(raw_addr, new_addr);
     }
     // Update the reference.
-    RawObject* new_obj = RawObject::FromAddr(new_addr);
-    *p = new_obj;
-    // Update the store buffer as needed.
-    UpdateStoreBuffer(p, new_obj);
+    UpdatePointer(p, new_addr);
   }
 
   Scavenger* scavenger_;
   Heap* heap_;
   Heap* vm_heap_;
+  StoreBuffer* store_buffer_;
+  ScavengerWorker* worker_;
+  bool visiting_old_pointers_;
 
   DISALLOW_COPY_AND_ASSIGN(ScavengerVisitor);
 };
 
 
+// Turn the unused rest of an allocation buffer into a free list element so
+// that the heap stays iterable.
+static void AbandonLab(uword top, uword end) {
+  ASSERT(top <= end);
+  if (top < end) {
+    FreeListElement::AsElement(top, end - top);
+  }
+}
+
+
+ScavengerWorker::ScavengerWorker(Scavenger* scavenger,
+                                 ScavengerWorkList* work_list,
+                                 Mutex* promotion_mutex)
+    : scavenger_(scavenger),
+      work_list_(work_list),
+      promotion_mutex_(promotion_mutex),
+      store_buffer_(),
+      visitor_(NULL),
+      work_(new ScavengerWorkBlock()),
+      to_top_(0),
+      to_end_(0),
+      promotion_top_(0),
+      promotion_end_(0),
+      copied_bytes_(0),
+      promoted_bytes_(0) {
+  visitor_ = new ScavengerVisitor(scavenger, this, &store_buffer_);
+}
+
+
+ScavengerWorker::~ScavengerWorker() {
+  ASSERT(work_->IsEmpty());
+  delete work_;
+  delete visitor_;
+}
+
+
+uword ScavengerWorker::TryAllocateInToSpace(intptr_t size) {
+  if ((to_end_ - to_top_) >= static_cast<uword>(size)) {
+    uword result = to_top_;
+    to_top_ += size;
+    return result;
+  }
+  // Large objects are allocated directly in the shared to space instead of
+  // replacing the current buffer, which limits the space wasted at the end
+  // of the buffers.
+  bool refill = (size < (kLabSize / 4));
+  uword* top_addr = &scavenger_->top_;
+  uword top = *reinterpret_cast<volatile uword*>(top_addr);
+  uword end = 0;
+  while (true) {
+    intptr_t remaining = Utils::RoundDown(scavenger_->end_ - top,
+                                          kObjectAlignment);
+    if (remaining < size) {
+      return 0;
+    }
+    end = top + (refill ? Utils::Minimum(kLabSize, remaining) : size);
+    uword old_top = AtomicOperations::CompareAndSwapWord(top_addr, top, end);
+    if (old_top == top) {
+      break;
+    }
+    top = old_top;
+  }
+  if (refill) {
+    AbandonLab(to_top_, to_end_);
+    to_top_ = top + size;
+    to_end_ = end;
+  }
+  return top;
+}
+
+
+uword ScavengerWorker::TryPromote(intptr_t size) {
+  if ((promotion_end_ - promotion_top_) < static_cast<uword>(size)) {
+    AbandonLab(promotion_top_, promotion_end_);
+    promotion_top_ = 0;
+    promotion_end_ = 0;
+    Heap* heap = scavenger_->heap_;
+    promotion_mutex_->Lock();
+    intptr_t lab_size = Utils::Maximum(kLabSize, size);
+    uword lab = heap->TryAllocate(lab_size, Heap::kOld);
+    if ((lab == 0) && (lab_size > size)) {
+      lab_size = size;
+      lab = heap->TryAllocate(lab_size, Heap::kOld);
+    }
+    promotion_mutex_->Unlock();
+    if (lab == 0) {
+      return 0;
+    }
+    promotion_top_ = lab;
+    promotion_end_ = lab + lab_size;
+  }
+  uword result = promotion_top_;
+  promotion_top_ += size;
+  return result;
+}
+
+
+uword ScavengerWorker::ForwardObject(uword raw_addr) {
+  uword* header_addr = reinterpret_cast<uword*>(raw_addr);
+  uword header = *reinterpret_cast<volatile uword*>(header_addr);
+  // Claim the object by replacing its header, unless it is already forwarded.
+  while (true) {
+    if (IsForwarding(header)) {
+      uword new_addr = ForwardedAddr(header);
+      if (new_addr != 0) {
+        return new_addr;
+      }
+      // Another worker is still copying the object.
+      header = *reinterpret_cast<volatile uword*>(header_addr);
+      continue;
+    }
+    uword old_header = AtomicOperations::CompareAndSwapWord(
+        header_addr, header, kForwardingInProgress);
+    if (old_header == header) {
+      break;
+    }
+    header = old_header;
+  }
+
+  RawObject* raw_obj = RawObject::FromAddr(raw_addr);
+  intptr_t size = raw_obj->SizeFromTags(header);
+  uword new_addr = 0;
+  if (scavenger_->survivor_end_ <= raw_addr) {
+    // Not a survivor of a previous scavenge, copy it into the to space. The
+    // unused tails of the allocation buffers may leave too little room in the
+    // to space, in which case the object is promoted instead.
+    new_addr = TryAllocateInToSpace(size);
+    if (new_addr == 0) {
+      new_addr = TryPromote(size);
+    }
+  } else {
+    new_addr = TryPromote(size);
+    if (new_addr == 0) {
+      scavenger_->had_promotion_failure_ = true;
+      new_addr = TryAllocateInToSpace(size);
+    }
+  }
+  if (new_addr == 0) {
+    FATAL("Out of memory during a parallel scavenge.");
+  }
+  if (scavenger_->to_->Contains(new_addr)) {
+    copied_bytes_ += size;
+  } else {
+    promoted_bytes_ += size;
+  }
+  memmove(reinterpret_cast<void*>(new_addr),
+          reinterpret_cast<void*>(raw_addr),
+          size);
+  // The header in the from space has been overwritten by now.
+  *reinterpret_cast<uword*>(new_addr) = header;
+  PushWork(new_addr);
+  // Publish the forwarding address.
+  ASSERT((new_addr & kForwardingMask) == 0);
+  AtomicOperations::CompareAndSwapWord(header_addr,
+                                       kForwardingInProgress,
+                                       new_addr | kForwarded);
+  return new_addr;
+}
+
+
+void ScavengerWorker::PushWork(uword addr) {
+  if (work_->IsFull()) {
+    work_list_->Publish(work_);
+    work_ = new ScavengerWorkBlock();
+  }
+  work_->Push(addr);
+}
+
+
+void ScavengerWorker::PublishWork() {
+  if (!work_->IsEmpty()) {
+    work_list_->Publish(work_);
+    work_ = new ScavengerWorkBlock();
+  }
+}
+
+
+void ScavengerWorker::ScanObject(uword addr) {
+  // Slots of promoted objects are old to new pointers if they still point
+  // into new space afterwards.
+  visitor_->VisitingOldPointers(!scavenger_->to_->Contains(addr));
+  RawObject::FromAddr(addr)->VisitPointers(visitor_);
+}
+
+
+void ScavengerWorker::ProcessWork() {
+  while (true) {
+    while (!work_->IsEmpty()) {
+      if ((work_->Count() > 1) && work_list_->HasIdleWorkers()) {
+        PublishWork();
+        continue;
+      }
+      ScanObject(work_->Pop());
+    }
+    ScavengerWorkBlock* block = work_list_->Take();
+    if (block == NULL) {
+      break;
+    }
+    delete work_;
+    work_ = block;
+  }
+  visitor_->VisitingOldPointers(false);
+}
+
+
+void ScavengerWorker::Finish(Isolate* isolate) {
+  AbandonLab(to_top_, to_end_);
+  AbandonLab(promotion_top_, promotion_end_);
+  to_top_ = to_end_ = 0;
+  promotion_top_ = promotion_end_ = 0;
+  // Merge the recorded old to new pointers into the store buffer of the
+  // isolate.
+  StoreBuffer* isolate_buffer = isolate->store_buffer();
+  StoreBufferBlock* blocks = store_buffer_.TakeBlocks();
+  for (StoreBufferBlock* block = blocks;
+       block != NULL;
+       block = block->next()) {
+    for (intptr_t i = 0; i < block->Count(); i++) {
+      isolate_buffer->AddPointer(block->At(i));
+    }
+  }
+  StoreBuffer::DeleteBlocks(blocks);
+}
+
+
+class ScavengerTask : public ThreadPool::Task {
+ public:
+  ScavengerTask(Isolate* isolate,
+                ScavengerWorker* worker,
+                ScavengerWorkList* work_list)
+      : isolate_(isolate), worker_(worker), work_list_(work_list) {}
+
+  virtual void Run() {
+    // Visiting objects looks up their classes in the class table of the
+    // current isolate. The mutator thread is blocked in the scavenge.
+    Isolate::SetCurrent(isolate_);
+    worker_->ProcessWork();
+    Isolate::SetCurrent(NULL);
+    work_list_->TaskDone();
+  }
+
+ private:
+  Isolate* isolate_;
+  ScavengerWorker* worker_;
+  ScavengerWorkList* work_list_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScavengerTask);
+};
+
+
+#if defined(DEBUG)
+// Verifies that every pointer from old space into new space is recorded in
+// the store buffer, or in the card table of the page for large objects.
+class VerifyStoreBufferPointerVisitor : public ObjectPointerVisitor {
+ public:
+  VerifyStoreBufferPointerVisitor(Isolate* isolate, StoreBuffer* store_buffer)
+      : ObjectPointerVisitor(isolate),
+        store_buffer_(store_buffer),
+        card_page_(NULL) {}
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* obj = *current;
+      if (obj->IsHeapObject() && obj->IsNewObject()) {
+        uword addr = reinterpret_cast<uword>(current);
+        bool is_remembered = (card_page_ != NULL) ?
+            card_page_->IsCardMarked(addr) : store_buffer_->Contains(addr);
+        if (!is_remembered) {
+          FATAL1("Old to new pointer at 0x%" PRIxPTR " missing from the "
+                 "store buffer\n", addr);
+        }
+      }
+    }
+  }
+
+  void set_card_page(HeapPage* page) { card_page_ = page; }
+
+ private:
+  StoreBuffer* store_buffer_;
+  HeapPage* card_page_;
+
+  DISALLOW_COPY_AND_ASSIGN(VerifyStoreBufferPointerVisitor);
+};
+
+
+class VerifyStoreBufferObjectVisitor : public ObjectVisitor {
+ public:
+  explicit VerifyStoreBufferObjectVisitor(
+      VerifyStoreBufferPointerVisitor* visitor) : visitor_(visitor) {}
+
+  void VisitObject(RawObject* raw_obj) {
+    HeapPage* page = PageSpace::PageFor(raw_obj);
+    visitor_->set_card_page((page->card_table() != NULL) ? page : NULL);
+    raw_obj->VisitPointers(visitor_);
+  }
+
+ private:
+  VerifyStoreBufferPointerVisitor* visitor_;
+
+  DISALLOW_COPY_AND_ASSIGN(VerifyStoreBufferObjectVisitor);
+};
+#endif  // defined(DEBUG)
+
+
 class ScavengerWeakVisitor : public HandleVisitor {
  public:
   explicit ScavengerWeakVisitor(Scavenger* scavenger) : scavenger_(scavenger) {
@@ -236,12 +768,41 @@ void Scavenger::Epilogue(Isolate* isolate, bool invoke_api_callbacks) {
 
 
 void Scavenger::IterateRoots(Isolate* isolate,
-                             ObjectPointerVisitor* visitor,
+                             ScavengerVisitor* visitor,
                              bool visit_prologue_weak_persistent_handles) {
   isolate->VisitObjectPointers(visitor,
                                visit_prologue_weak_persistent_handles,
                                StackFrameIterator::kDontValidateFrames);
-  heap_->IterateOldPointers(visitor);
+  IterateStoreBuffers(isolate, visitor);
+  // Slots in large arrays are remembered by card marking instead.
+  heap_->IterateOldMarkedCards(visitor);
+}
+
+
+void Scavenger::IterateStoreBuffers(Isolate* isolate,
+                                    ScavengerVisitor* visitor) {
+  // Detach the recorded slots before visiting them. Slots which still point
+  // into new space after the scavenge are recorded again by the visitor.
+  StoreBufferBlock* pending = isolate->store_buffer()->TakeBlocks();
+  visitor->VisitingOldPointers(true);
+  for (StoreBufferBlock* block = pending;
+       block != NULL;
+       block = block->next()) {
+    for (intptr_t i = 0; i < block->Count(); i++) {
+      visitor->VisitPointer(reinterpret_cast<RawObject**>(block->At(i)));
+    }
+  }
+  visitor->VisitingOldPointers(false);
+  StoreBuffer::DeleteBlocks(pending);
+}
+
+
+void Scavenger::VerifyStoreBuffers(Isolate* isolate) {
+#if defined(DEBUG)
+  VerifyStoreBufferPointerVisitor verifier(isolate, isolate->store_buffer());
+  VerifyStoreBufferObjectVisitor object_verifier(&verifier);
+  heap_->IterateOldObjects(&object_verifier);
+#endif  // defined(DEBUG)
 }
 
 
@@ -268,7 +829,7 @@ bool Scavenger::IsUnreachable(RawObject** p) {
 
 
 void Scavenger::IterateWeakReferences(Isolate* isolate,
-                                      ObjectPointerVisitor* visitor) {
+                                      ScavengerVisitor* visitor) {
   ApiState* state = isolate->api_state();
   ASSERT(state != NULL);
   while (true) {
@@ -327,13 +888,14 @@ void Scavenger::IterateWeakRoots(Isolate* isolate,
 }
 
 
-void Scavenger::ProcessToSpace(ObjectPointerVisitor* visitor) {
+void Scavenger::ProcessToSpace(ScavengerVisitor* visitor) {
   // Iterate until all work has been drained.
   while ((resolved_top_ < top_) || PromotedStackHasMore()) {
     while (resolved_top_ < top_) {
       RawObject* raw_obj = RawObject::FromAddr(resolved_top_);
       resolved_top_ += raw_obj->VisitPointers(visitor);
     }
+    visitor->VisitingOldPointers(true);
     while (PromotedStackHasMore()) {
       RawObject* raw_object = RawObject::FromAddr(PopFromPromotedStack());
       // Resolve or copy all objects referred to by the current object. This
@@ -341,6 +903,56 @@ void Scavenger::ProcessToSpace(ObjectPointerVisitor* visitor) {
       // objects to be resolved in the to space.
       raw_object->VisitPointers(visitor);
     }
+    visitor->VisitingOldPointers(false);
+  }
+}
+
+
+void Scavenger::ParallelScavenge(Isolate* isolate,
+                                 bool visit_prologue_weak_persistent_handles) {
+  intptr_t num_workers = FLAG_scavenger_tasks;
+  if (num_workers <= 0) {
+    num_workers = OS::NumberOfAvailableProcessors();
+  }
+  ScavengerWorkList work_list(num_workers);
+  Mutex promotion_mutex;
+  ScavengerWorker** workers = new ScavengerWorker*[num_workers];
+  for (intptr_t i = 0; i < num_workers; i++) {
+    workers[i] = new ScavengerWorker(this, &work_list, &promotion_mutex);
+  }
+
+  // The roots are visited on this thread. The objects copied while doing so
+  // are then shared with the helper tasks.
+  ScavengerWorker* main_worker = workers[0];
+  IterateRoots(isolate,
+               main_worker->visitor(),
+               visit_prologue_weak_persistent_handles);
+  main_worker->PublishWork();
+  for (intptr_t i = 1; i < num_workers; i++) {
+    work_list.TaskStarted();
+    Dart::thread_pool()->Run(
+        new ScavengerTask(isolate, workers[i], &work_list));
+  }
+  main_worker->ProcessWork();
+  work_list.WaitForTasks();
+
+  intptr_t copied_bytes = 0;
+  intptr_t promoted_bytes = 0;
+  for (intptr_t i = 0; i < num_workers; i++) {
+    workers[i]->Finish(isolate);
+    copied_bytes += workers[i]->copied_bytes();
+    promoted_bytes += workers[i]->promoted_bytes();
+    delete workers[i];
+  }
+  delete[] workers;
+
+  // All objects in the to space have been visited.
+  ASSERT(!PromotedStackHasMore());
+  resolved_top_ = top_;
+  if (FLAG_verbose_gc) {
+    OS::PrintErr("Parallel scavenge[%d]: %d tasks, copied %dKB, "
+                 "promoted %dKB\n", count_, num_workers,
+                 copied_bytes / KB, promoted_bytes / KB);
   }
 }
 
@@ -382,6 +994,7 @@ void Scavenger::Scavenge(bool invoke_api_callbacks) {
   if (FLAG_verify_before_gc) {
     OS::PrintErr("Verifying before Scavenge... ");
     heap_->Verify();
+    VerifyStoreBuffers(isolate);
     OS::PrintErr(" done.\n");
   }
 
@@ -390,8 +1003,12 @@ void Scavenger::Scavenge(bool invoke_api_callbacks) {
   // Setup the visitor and run a scavenge.
   ScavengerVisitor visitor(isolate, this);
   Prologue(isolate, invoke_api_callbacks);
-  IterateRoots(isolate, &visitor, !invoke_api_callbacks);
-  ProcessToSpace(&visitor);
+  if (FLAG_parallel_scavenge) {
+    ParallelScavenge(isolate, !invoke_api_callbacks);
+  } else {
+    IterateRoots(isolate, &visitor, !invoke_api_callbacks);
+    ProcessToSpace(&visitor);
+  }
   IterateWeakReferences(isolate, &visitor);
   ScavengerWeakVisitor weak_visitor(this);
   IterateWeakRoots(isolate, &weak_visitor, invoke_api_callbacks);
@@ -18,6 +18,7 @@ namespace dart {
 // Forward declarations.
 class Heap;
 class Isolate;
+class ScavengerVisitor;
 
 DECLARE_FLAG(bool, gc_at_alloc);
 
@@ -83,13 +84,18 @@ class Scavenger {
   uword FirstObjectStart() const { return to_->start() | object_alignment_; }
   void Prologue(Isolate* isolate, bool invoke_api_callbacks);
   void IterateRoots(Isolate* isolate,
-                    ObjectPointerVisitor* visitor,
+                    ScavengerVisitor* visitor,
                     bool visit_prologue_weak_persistent_handles);
-  void IterateWeakReferences(Isolate* isolate, ObjectPointerVisitor* visitor);
+  void IterateStoreBuffers(Isolate* isolate, ScavengerVisitor* visitor);
+  void IterateWeakReferences(Isolate* isolate, ScavengerVisitor* visitor);
   void IterateWeakRoots(Isolate* isolate,
                         HandleVisitor* visitor,
                         bool visit_prologue_weak_persistent_handles);
-  void ProcessToSpace(ObjectPointerVisitor* visitor);
+  void ProcessToSpace(ScavengerVisitor* visitor);
+  // Copy the objects reachable from the roots using multiple threads.
+  void ParallelScavenge(Isolate* isolate,
+                        bool visit_prologue_weak_persistent_handles);
+  void VerifyStoreBuffers(Isolate* isolate);
   void Epilogue(Isolate* isolate, bool invoke_api_callbacks);
 
   bool IsUnreachable(RawObject** p);
@@ -143,6 +149,7 @@ class Scavenger {
 
   friend class ScavengerVisitor;
   friend class ScavengerWeakVisitor;
+  friend class ScavengerWorker;
 
   DISALLOW_COPY_AND_ASSIGN(Scavenger);
 };
@@ -72,10 +72,13 @@ intptr_t BaseReader::ReadSmiValue() {
 }
 
 
-SnapshotReader::SnapshotReader(const Snapshot* snapshot, Isolate* isolate)
+SnapshotReader::SnapshotReader(const Snapshot* snapshot,
+                               Isolate* isolate,
+                               MessageBuffers* buffers)
     : BaseReader(snapshot->content(), snapshot->length()),
       kind_(snapshot->kind()),
       isolate_(isolate),
+      buffers_(buffers),
       cls_(Class::Handle()),
       obj_(Object::Handle()),
       str_(String::Handle()),
@@ -328,10 +331,14 @@ RawTypeArguments* SnapshotReader::NewTypeArguments(intptr_t len) {
 }
 
 
-RawTokenStream* SnapshotReader::NewTokenStream(intptr_t len) {
-  ALLOC_NEW_OBJECT_WITH_LEN(TokenStream,
-                            Object::token_stream_class(),
-                            len);
+RawTokenStream* SnapshotReader::NewTokenStream(intptr_t data_length) {
+  ASSERT(kind_ == Snapshot::kFull);
+  ASSERT(isolate()->no_gc_scope_depth() != 0);
+  cls_ = Object::token_stream_class();
+  RawTokenStream* obj = reinterpret_cast<RawTokenStream*>(
+      AllocateUninitialized(cls_, TokenStream::InstanceSize(data_length)));
+  obj->ptr()->data_length_ = data_length;
+  return obj;
 }
 
 
@@ -22,6 +22,7 @@ class Array;
 class Class;
 class Heap;
 class Library;
+class MessageBuffers;
 class Object;
 class ObjectStore;
 class RawAbstractTypeArguments;
@@ -355,10 +356,14 @@ class BaseReader {
 // Reads a snapshot into objects.
 class SnapshotReader : public BaseReader {
  public:
-  SnapshotReader(const Snapshot* snapshot, Isolate* isolate);
+  SnapshotReader(const Snapshot* snapshot,
+                 Isolate* isolate,
+                 MessageBuffers* buffers = NULL);
   ~SnapshotReader() { }
 
   Isolate* isolate() const { return isolate_; }
+  // Out-of-band buffers of the message being read, or NULL.
+  MessageBuffers* buffers() const { return buffers_; }
   Heap* heap() const { return isolate_->heap(); }
   ObjectStore* object_store() const { return isolate_->object_store(); }
   Object* ObjectHandle() { return &obj_; }
@@ -387,7 +392,7 @@ class SnapshotReader : public BaseReader {
   RawTwoByteString* NewTwoByteString(intptr_t len);
   RawFourByteString* NewFourByteString(intptr_t len);
   RawTypeArguments* NewTypeArguments(intptr_t len);
-  RawTokenStream* NewTokenStream(intptr_t len);
+  RawTokenStream* NewTokenStream(intptr_t data_length);
   RawContext* NewContext(intptr_t num_variables);
   RawClass* NewClass(int value);
   RawMint* NewMint(int64_t value);
@@ -442,6 +447,7 @@ class SnapshotReader : public BaseReader {
 
   Snapshot::Kind kind_;  // Indicates type of snapshot(full, script, message).
   Isolate* isolate_;  // Current isolate.
+  MessageBuffers* buffers_;  // Out-of-band buffers of a message.
   Class& cls_;  // Temporary Class handle.
   Object& obj_;  // Temporary Object handle.
   String& str_;  // Temporary String handle.
@@ -538,18 +544,30 @@ class BaseWriter {
 
 class SnapshotWriter : public BaseWriter {
  public:
-  SnapshotWriter(Snapshot::Kind kind, uint8_t** buffer, ReAlloc alloc)
+  // Byte arrays of at least this length are not copied into a message
+  // snapshot but added to its out-of-band buffers, if there are any.
+  static const intptr_t kMinOutOfBandLength = 1 * KB;
+
+  SnapshotWriter(Snapshot::Kind kind,
+                 uint8_t** buffer,
+                 ReAlloc alloc,
+                 MessageBuffers* buffers = NULL)
       : BaseWriter(buffer, alloc),
         kind_(kind),
+        buffers_(buffers),
         object_store_(Isolate::Current()->object_store()),
         class_table_(Isolate::Current()->class_table()),
         forward_list_() {
+    ASSERT((buffers == NULL) || (kind == Snapshot::kMessage));
   }
   ~SnapshotWriter() { }
 
   // Snapshot kind.
   Snapshot::Kind kind() const { return kind_; }
 
+  // Out-of-band buffers of the message being written, or NULL.
+  MessageBuffers* buffers() const { return buffers_; }
+
   // Finalize the serialized buffer by filling in the header information
   // which comprises of a flag(full/partial snaphot) and the length of
   // serialzed bytes.
@@ -604,6 +622,7 @@ class SnapshotWriter : public BaseWriter {
   ObjectStore* object_store() const { return object_store_; }
 
   Snapshot::Kind kind_;
+  MessageBuffers* buffers_;  // Out-of-band buffers of a message.
   ObjectStore* object_store_;  // Object store for common classes.
   ClassTable* class_table_;  // Class table for the class index to class lookup.
   GrowableArray<ForwardObjectNode*> forward_list_;
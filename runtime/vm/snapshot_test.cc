@@ -9,11 +9,14 @@
 #include "vm/dart_api_impl.h"
 #include "vm/dart_api_message.h"
 #include "vm/dart_api_state.h"
+#include "vm/message.h"
 #include "vm/snapshot.h"
 #include "vm/unit_test.h"
 
 namespace dart {
 
+DECLARE_FLAG(bool, verify_before_gc);
+
 // Check if serialized and deserialized objects are equal.
 static bool Equals(const Object& expected, const Object& actual) {
   if (expected.IsNull()) {
@@ -715,6 +718,65 @@ TEST_CASE(SerializeEmptyByteArray) {
 }
 
 
+TEST_CASE(SerializeOutOfBandByteArray) {
+  Zone zone(Isolate::Current());
+
+  // Write snapshot with object content, the contents of the byte array
+  // are added to the out-of-band buffers.
+  uint8_t* buffer;
+  MessageBuffers buffers;
+  SnapshotWriter writer(
+      Snapshot::kMessage, &buffer, &zone_allocator, &buffers);
+  const int kByteArrayLength = 4 * SnapshotWriter::kMinOutOfBandLength;
+  Uint8Array& byte_array =
+      Uint8Array::Handle(Uint8Array::New(kByteArrayLength));
+  for (int i = 0; i < kByteArrayLength; i++) {
+    byte_array.SetAt(i, i & 0xff);
+  }
+  const Array& array = Array::Handle(Array::New(2));
+  array.SetAt(0, byte_array);
+  array.SetAt(1, byte_array);
+  writer.WriteObject(array.raw());
+  writer.FinalizeBuffer();
+  EXPECT_EQ(1, buffers.length());
+  EXPECT_EQ(kByteArrayLength, buffers.SizeAt(0));
+  EXPECT(writer.BytesWritten() < kByteArrayLength);
+
+  // Read object back from the snapshot into a C structure, the buffer is
+  // used in place.
+  {
+    ApiNativeScope scope;
+    Dart_CObject* root = ApiMessageReader(buffer + Snapshot::kHeaderSize,
+                                          writer.BytesWritten(),
+                                          &zone_allocator,
+                                          &buffers).ReadMessage();
+    EXPECT_EQ(Dart_CObject::kArray, root->type);
+    EXPECT_EQ(2, root->value.as_array.length);
+    Dart_CObject* element = root->value.as_array.values[0];
+    EXPECT_EQ(Dart_CObject::kUint8Array, element->type);
+    EXPECT_EQ(kByteArrayLength, element->value.as_byte_array.length);
+    EXPECT(element->value.as_byte_array.values == buffers.DataAt(0));
+    EXPECT(root->value.as_array.values[1] == element);
+  }
+
+  // Read object back from the snapshot, the external byte array takes
+  // ownership of the buffer.
+  const Snapshot* snapshot = Snapshot::SetupFromBuffer(buffer);
+  SnapshotReader reader(snapshot, Isolate::Current(), &buffers);
+  Array& serialized_array = Array::Handle();
+  serialized_array ^= reader.ReadObject();
+  EXPECT(buffers.DataAt(0) == NULL);
+  ExternalUint8Array& serialized_byte_array = ExternalUint8Array::Handle();
+  serialized_byte_array ^= serialized_array.At(0);
+  EXPECT(serialized_byte_array.IsExternalUint8Array());
+  EXPECT_EQ(kByteArrayLength, serialized_byte_array.Length());
+  for (int i = 0; i < kByteArrayLength; i++) {
+    EXPECT_EQ(i & 0xff, serialized_byte_array.At(i));
+  }
+  EXPECT(serialized_array.At(1) == serialized_byte_array.raw());
+}
+
+
 TEST_CASE(SerializeScript) {
   const char* kScriptChars =
       "class A {\n"
@@ -1009,6 +1071,17 @@ UNIT_TEST_CASE(ScriptSnapshot) {
     result = Dart_LoadScriptFromSnapshot(script_snapshot);
     EXPECT_VALID(result);
 
+    // The old space objects read from the script snapshot refer to new
+    // space objects, these pointers must be in the store buffer.
+    {
+      Zone zone(Isolate::Current());
+      HandleScope scope(Isolate::Current());
+      bool saved_flag = FLAG_verify_before_gc;
+      FLAG_verify_before_gc = true;
+      Isolate::Current()->heap()->CollectGarbage(Heap::kNew);
+      FLAG_verify_before_gc = saved_flag;
+    }
+
     // Get list of library URLs loaded and compare with expected count.
     Dart_Handle libs = Dart_GetLibraryURLs();
     EXPECT(Dart_IsList(libs));
@@ -1542,6 +1615,38 @@ UNIT_TEST_CASE(PostCObject) {
   Dart_ExitScope();
 }
 
+
+UNIT_TEST_CASE(SendLargeByteArray) {
+  TestIsolateScope __test_isolate__;
+  const char* kScriptChars =
+      "#import('dart:isolate');\n"
+      "void main() {\n"
+      "  var bytes = new Uint8List(65536);\n"
+      "  bytes[1000] = 42;\n"
+      "  var port = new ReceivePort();\n"
+      "  port.receive((message, replyTo) {\n"
+      "    port.close();\n"
+      "    bytes[1000] = 0;\n"
+      "    message[2000] = 7;\n"
+      "    throw new Exception(\n"
+      "        '${message.length} ${message[1000]} ${message[2000]}');\n"
+      "  });\n"
+      "  port.toSendPort().send(bytes, null);\n"
+      "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_EnterScope();
+
+  // The received array is a copy of the sent one.
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+  result = Dart_RunLoop();
+  EXPECT(Dart_IsError(result));
+  EXPECT(Dart_ErrorHasException(result));
+  EXPECT_SUBSTRING("Exception: 65536 42 7\n", Dart_GetError(result));
+
+  Dart_ExitScope();
+}
+
 #endif  // defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64).
 
 }  // namespace dart
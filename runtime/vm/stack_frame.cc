@@ -171,6 +171,12 @@ StackFrameIterator::StackFrameIterator(bool validate)
 }
 
 
+StackFrameIterator::StackFrameIterator(uword fp, bool validate)
+    : validate_(validate), entry_(), exit_(), current_frame_(NULL) {
+  frames_.fp_ = fp;
+}
+
+
 StackFrame* StackFrameIterator::NextFrame() {
   // When we are at the start of iteration after having created an
   // iterator object current_frame_ will be NULL as we haven't seen
@@ -118,12 +118,14 @@ class EntryFrame : public StackFrame {
   // Visit objects in the frame.
   virtual void VisitObjectPointers(ObjectPointerVisitor* visitor);
 
+  // Offset from the frame pointer of the saved top exit frame info.
+  static intptr_t ExitLinkOffset();
+
  protected:
   virtual const char* GetName() const { return "entry"; }
 
  private:
   EntryFrame() { }
-  intptr_t ExitLinkOffset();
 
   friend class StackFrameIterator;
   DISALLOW_COPY_AND_ASSIGN(EntryFrame);
@@ -139,6 +141,11 @@ class StackFrameIterator : public ValueObject {
 
   explicit StackFrameIterator(bool validate);
 
+  // Iterates over the frames starting at the frame pointer fp, which is
+  // treated like an exit frame, e.g. that of Dart code interrupted by a
+  // signal.
+  StackFrameIterator(uword fp, bool validate);
+
   // Checks if a next frame exists.
   bool HasNextFrame() const { return frames_.fp_ != 0; }
 
@@ -5,12 +5,137 @@
 #include "vm/store_buffer.h"
 
 #include "platform/assert.h"
+#include "platform/utils.h"
 
 namespace dart {
 
-void StoreBufferBlock::ProcessBuffer() {
-  // TODO(iposva): Do the right thing for store buffer overflow.
-  top_ = 0;  // Currently just reset back to the beginning.
+DedupSet::DedupSet()
+    : addresses_(new uword[kInitialCapacity]),
+      capacity_(kInitialCapacity),
+      count_(0) {
+  memset(addresses_, 0, capacity_ * sizeof(addresses_[0]));
+}
+
+
+DedupSet::~DedupSet() {
+  delete[] addresses_;
+}
+
+
+intptr_t DedupSet::IndexFor(uword address) const {
+  ASSERT(address != 0);
+  ASSERT(Utils::IsPowerOfTwo(capacity_));
+  // Slot addresses are word aligned, drop the alignment bits before hashing.
+  uword hash = (address >> kWordSizeLog2) * 2654435761U;
+  intptr_t mask = capacity_ - 1;
+  intptr_t index = (hash ^ (hash >> 16)) & mask;
+  while ((addresses_[index] != 0) && (addresses_[index] != address)) {
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+
+bool DedupSet::Add(uword address) {
+  intptr_t index = IndexFor(address);
+  if (addresses_[index] == address) {
+    return false;
+  }
+  addresses_[index] = address;
+  count_++;
+  // Keep the load factor at or below one half.
+  if ((2 * count_) > capacity_) {
+    Grow();
+  }
+  return true;
+}
+
+
+bool DedupSet::Contains(uword address) const {
+  return addresses_[IndexFor(address)] == address;
+}
+
+
+void DedupSet::Grow() {
+  uword* old_addresses = addresses_;
+  intptr_t old_capacity = capacity_;
+  capacity_ = old_capacity * 2;
+  addresses_ = new uword[capacity_];
+  memset(addresses_, 0, capacity_ * sizeof(addresses_[0]));
+  for (intptr_t i = 0; i < old_capacity; i++) {
+    if (old_addresses[i] != 0) {
+      addresses_[IndexFor(old_addresses[i])] = old_addresses[i];
+    }
+  }
+  delete[] old_addresses;
+}
+
+
+void DedupSet::Clear() {
+  // Shrink back to the initial capacity so that one large burst of stores
+  // does not keep a large set alive forever.
+  if (capacity_ != kInitialCapacity) {
+    delete[] addresses_;
+    addresses_ = new uword[kInitialCapacity];
+    capacity_ = kInitialCapacity;
+  }
+  memset(addresses_, 0, capacity_ * sizeof(addresses_[0]));
+  count_ = 0;
+}
+
+
+StoreBuffer::StoreBuffer() : current_(), blocks_(NULL), dedup_set_() {
+}
+
+
+StoreBuffer::~StoreBuffer() {
+  DeleteBlocks(blocks_);
+}
+
+
+void StoreBuffer::ProcessBuffer() {
+  for (intptr_t i = 0; i < current_.Count(); i++) {
+    uword address = current_.At(i);
+    if (dedup_set_.Add(address)) {
+      if ((blocks_ == NULL) || blocks_->IsFull()) {
+        blocks_ = new StoreBufferBlock(blocks_);
+      }
+      blocks_->Add(address);
+    }
+  }
+  current_.Reset();
+}
+
+
+bool StoreBuffer::Contains(uword address) {
+  ProcessBuffer();
+  return dedup_set_.Contains(address);
+}
+
+
+StoreBufferBlock* StoreBuffer::TakeBlocks() {
+  ProcessBuffer();
+  StoreBufferBlock* result = blocks_;
+  blocks_ = NULL;
+  dedup_set_.Clear();
+  return result;
+}
+
+
+void StoreBuffer::DeleteBlocks(StoreBufferBlock* blocks) {
+  while (blocks != NULL) {
+    StoreBufferBlock* next = blocks->next();
+    delete blocks;
+    blocks = next;
+  }
+}
+
+
+void StoreBuffer::Reset() {
+  current_.Reset();
+  DeleteBlocks(blocks_);
+  blocks_ = NULL;
+  dedup_set_.Clear();
 }
 
 }  // namespace dart
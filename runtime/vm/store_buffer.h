@@ -15,29 +15,116 @@ class StoreBufferBlock {
   // Each block contains kSize pointers.
   static const int32_t kSize = 1024;
 
-  StoreBufferBlock() : top_(0) {}
+  explicit StoreBufferBlock(StoreBufferBlock* next = NULL)
+      : next_(next), top_(0) {}
 
   static int top_offset() { return OFFSET_OF(StoreBufferBlock, top_); }
   static int pointers_offset() {
     return OFFSET_OF(StoreBufferBlock, pointers_);
   }
 
-  // Add a pointer to the block of pointers. The buffer will be processed if it
-  // has been filled by this operation.
-  void AddPointer(uword pointer) {
+  StoreBufferBlock* next() const { return next_; }
+  void set_next(StoreBufferBlock* next) { next_ = next; }
+
+  bool IsFull() const { return top_ == kSize; }
+  bool IsEmpty() const { return top_ == 0; }
+  intptr_t Count() const { return top_; }
+
+  uword At(intptr_t i) const {
+    ASSERT((i >= 0) && (i < top_));
+    return pointers_[i];
+  }
+
+  void Add(uword pointer) {
     ASSERT(top_ < kSize);
     pointers_[top_++] = pointer;
-    if (top_ == kSize) {
+  }
+
+  void Reset() { top_ = 0; }
+
+ private:
+  StoreBufferBlock* next_;
+  int32_t top_;
+  uword pointers_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(StoreBufferBlock);
+};
+
+
+// An open addressing hash set of addresses, used to filter duplicate entries
+// out of the store buffer.
+class DedupSet {
+ public:
+  DedupSet();
+  ~DedupSet();
+
+  // Returns true if the address was not already a member of the set.
+  bool Add(uword address);
+  bool Contains(uword address) const;
+
+  void Clear();
+
+  intptr_t Count() const { return count_; }
+
+ private:
+  static const intptr_t kInitialCapacity = 1024;
+
+  intptr_t IndexFor(uword address) const;
+  void Grow();
+
+  uword* addresses_;
+  intptr_t capacity_;
+  intptr_t count_;
+
+  DISALLOW_COPY_AND_ASSIGN(DedupSet);
+};
+
+
+// The store buffer is the remembered set of the generational garbage
+// collector. It records the addresses of slots in old space objects that have
+// been updated to point to a new space object, so that the scavenger only
+// needs to visit these slots instead of all of old space.
+//
+// The write barrier appends to the current block without any filtering.
+// Once the current block fills up it is processed: duplicate addresses are
+// dropped and the unique ones are moved onto a chain of full blocks.
+class StoreBuffer {
+ public:
+  StoreBuffer();
+  ~StoreBuffer();
+
+  void AddPointer(uword address) {
+    current_.Add(address);
+    if (current_.IsFull()) {
       ProcessBuffer();
     }
   }
 
-  // Process this store buffer and remember its contents in the heap.
+  // Move the contents of the current block onto the chain of processed
+  // blocks, dropping addresses that have already been recorded.
   void ProcessBuffer();
 
+  // Returns true if the address has been recorded since the last reset.
+  bool Contains(uword address);
+
+  // Detach all recorded addresses from the store buffer and return them as a
+  // chain of blocks. The caller takes ownership of the returned blocks and
+  // frees them with DeleteBlocks. The store buffer is empty afterwards.
+  StoreBufferBlock* TakeBlocks();
+  static void DeleteBlocks(StoreBufferBlock* blocks);
+
+  // Discard all recorded addresses.
+  void Reset();
+
+  // Number of unique addresses recorded, not counting the current block.
+  intptr_t Count() const { return dedup_set_.Count(); }
+
  private:
-  int32_t top_;
-  uword pointers_[kSize];
+  StoreBufferBlock current_;
+  StoreBufferBlock* blocks_;
+  DedupSet dedup_set_;
+
+  DISALLOW_COPY_AND_ASSIGN(StoreBuffer);
 };
 
 }  // namespace dart
@@ -24,6 +24,7 @@ DEFINE_FLAG(bool, inline_alloc, true, "Inline allocation of objects.");
 DEFINE_FLAG(bool, use_slow_path, false,
     "Set to true for debugging & verifying the slow paths.");
 DECLARE_FLAG(int, optimization_counter_threshold);
+DECLARE_FLAG(int, max_polymorphic_checks);
 
 // Input parameters:
 //   ESP : points to return address.
@@ -130,6 +131,76 @@ void StubCode::GeneratePrintStopMessageStub(Assembler* assembler) {
 }
 
 
+// Called by the write barrier in Assembler::StoreIntoObject when an old
+// object has been updated to point to a new object, or to an old object on a
+// page which is being marked incrementally.
+// Input parameters:
+//   ESP : points to return address.
+//   ESP + 4 : address of the slot that was stored into.
+//   ESP + 8 : object that was stored into.
+// Must preserve all registers.
+void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
+  Label new_value, call_runtime;
+  __ pushl(EAX);
+  __ pushl(ECX);
+  __ movl(ECX, Address(ESP, 3 * kWordSize));  // Slot address.
+  __ movl(ECX, Address(ECX, 0));  // Value.
+  __ testl(ECX, Immediate(kNewObjectAlignmentOffset));
+  __ j(NOT_ZERO, &new_value, Assembler::kNearJump);
+  // An old value is stored while the old generation is being marked, mark
+  // it unless that already happened.
+  __ movl(ECX, FieldAddress(ECX, Object::tags_offset()));
+  __ testl(ECX, Immediate(1 << RawObject::kMarkBit));
+  __ j(ZERO, &call_runtime, Assembler::kNearJump);
+  __ popl(ECX);
+  __ popl(EAX);
+  __ ret();
+
+  // Objects on pages with a card table are remembered by marking the card
+  // covering the slot.
+  __ Bind(&new_value);
+  __ movl(ECX, Address(ESP, 4 * kWordSize));  // Object.
+  __ andl(ECX, Immediate(~(PageSpace::kPageAlignment - 1)));
+  __ movl(EAX, Address(ECX, HeapPage::card_table_offset()));
+  __ cmpl(EAX, Immediate(0));
+  __ j(EQUAL, &call_runtime, Assembler::kNearJump);
+  __ negl(ECX);
+  __ addl(ECX, Address(ESP, 3 * kWordSize));  // Slot address - page start.
+  __ shrl(ECX, Immediate(HeapPage::kCardSizeLog2));
+  __ movb(Address(EAX, ECX, TIMES_1, 0), Immediate(1));
+  __ popl(ECX);
+  __ popl(EAX);
+  __ ret();
+
+  __ Bind(&call_runtime);
+  __ popl(ECX);
+  __ popl(EAX);
+  // Preserve all cpu registers and the caller-saved xmm registers.
+  __ pushal();
+  const intptr_t kNumSavedRegisters = 8;
+  __ subl(ESP, Immediate(kNumberOfXmmRegisters * sizeof(double)));
+  for (intptr_t i = 0; i < kNumberOfXmmRegisters; i++) {
+    __ movsd(Address(ESP, i * sizeof(double)), static_cast<XmmRegister>(i));
+  }
+  const intptr_t slot_offset = (kNumberOfXmmRegisters * sizeof(double)) +
+      ((kNumSavedRegisters + 1) * kWordSize);
+  __ movl(EAX, Address(ESP, slot_offset));
+
+  __ movl(EBP, ESP);
+  __ ReserveAlignedFrameSpace(kWordSize);
+  __ movl(Address(ESP, 0), EAX);  // Pass the slot address.
+  __ CallRuntime(kStoreBufferRuntimeEntry);
+  __ movl(ESP, EBP);
+
+  for (intptr_t i = 0; i < kNumberOfXmmRegisters; i++) {
+    __ movsd(static_cast<XmmRegister>(i), Address(ESP, i * sizeof(double)));
+  }
+  __ addl(ESP, Immediate(kNumberOfXmmRegisters * sizeof(double)));
+  __ popal();
+  __ ret();
+}
+
+
 // Input parameters:
 //   ESP : points to return address.
 //   ESP + 4 : address of return value.
@@ -274,7 +345,8 @@ void StubCode::GenerateFixCallersTargetStub(Assembler* assembler) {
 }
 
 
-// Lookup for [function-name, arg count] in 'functions_map_'.
+// Lookup for [function-name, arg count] in the functions cache of the
+// receiver's class.
 // Input parameters (to be treated as read only, unless calling to target!):
 //   ECX: ic-data.
 //   EDX: arguments descriptor array (num_args is first Smi element).
@@ -312,45 +384,61 @@ static void MegamorphicLookup(Assembler* assembler) {
   __ Bind(&class_in_eax);
   // Class is in EAX.
 
-  Label loop, next_iteration;
-  // Get functions_cache, since it is allocated lazily it maybe null.
+  // Probe the hash table of the functions cache linearly, starting at the
+  // hash of the target name. An uncomputed hash of zero is just a miss.
+  // Classes read from a snapshot have no functions cache yet.
+  const intptr_t kEntrySize = FunctionsCache::kNumEntries * kWordSize;
   __ movl(EAX, FieldAddress(EAX, Class::functions_cache_offset()));
-  // Iterate and search for identical name.
-  __ leal(EBX, FieldAddress(EAX, Array::data_offset()));
+  __ cmpl(EAX, raw_null);
+  __ j(EQUAL, &not_found);
+  __ movl(EDI, FieldAddress(ECX, ICData::target_name_offset()));
+  __ movl(EBX, FieldAddress(EDI, String::hash_offset()));
+  // Scale the hash (Smi) to the offset of its entry.
+  __ shll(EBX,
+          Immediate(Utils::ShiftForPowerOfTwo(kEntrySize) - kSmiTagShift));
 
-  // EBX is  pointing into content of functions_map_ array.
+  Label loop, next_iteration;
   __ Bind(&loop);
-  __ movl(EDI, Address(EBX, FunctionsCache::kFunctionName * kWordSize));
+  // Wrap around the offset: the capacity is a power of two, so the offset of
+  // the last entry is a mask for the offsets of all entries.
+  __ movl(EDI, FieldAddress(EAX, Array::length_offset()));
+  __ shll(EDI, Immediate(kWordSizeLog2 - kSmiTagShift));
+  __ subl(EDI, Immediate(kEntrySize));
+  __ andl(EBX, EDI);
+  // EBX: offset of the entry in the functions_cache_ array.
+  __ movl(EDI, FieldAddress(EAX, EBX, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kFunctionName * kWordSize));
 
   __ cmpl(EDI, raw_null);
-  __ j(EQUAL, &not_found, Assembler::kNearJump);
+  __ j(EQUAL, &not_found);
 
   __ cmpl(EDI, FieldAddress(ECX, ICData::target_name_offset()));
-  __ j(NOT_EQUAL, &next_iteration, Assembler::kNearJump);
+  __ j(NOT_EQUAL, &next_iteration);
 
   // Name found, check total argument count and named argument count.
-  __ movl(EAX, FieldAddress(EDX, Array::data_offset()));
-  // EAX is total argument count as Smi.
-  __ movl(EDI, Address(EBX, FunctionsCache::kArgCount * kWordSize));
-  __ cmpl(EAX, EDI);  // Compare total argument counts.
-  __ j(NOT_EQUAL, &next_iteration, Assembler::kNearJump);
-  __ subl(EAX, FieldAddress(EDX, Array::data_offset() + kWordSize));
-  // EAX is named argument count as Smi.
-  __ movl(EDI, Address(EBX, FunctionsCache::kNamedArgCount * kWordSize));
-  __ cmpl(EAX, EDI);  // Compare named argument counts.
-  __ j(NOT_EQUAL, &next_iteration, Assembler::kNearJump);
+  __ movl(EDI, FieldAddress(EDX, Array::data_offset()));
+  // EDI is total argument count as Smi.
+  __ cmpl(EDI, FieldAddress(EAX, EBX, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kArgCount * kWordSize));
+  __ j(NOT_EQUAL, &next_iteration);
+  __ subl(EDI, FieldAddress(EDX, Array::data_offset() + kWordSize));
+  // EDI is named argument count as Smi.
+  __ cmpl(EDI, FieldAddress(EAX, EBX, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kNamedArgCount * kWordSize));
+  __ j(NOT_EQUAL, &next_iteration);
 
   // Argument count matches, jump to target.
   // EDX: arguments descriptor array.
-  __ movl(ECX, Address(EBX, FunctionsCache::kFunction * kWordSize));
+  __ movl(ECX, FieldAddress(EAX, EBX, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kFunction * kWordSize));
   __ movl(ECX, FieldAddress(ECX, Function::code_offset()));
   __ movl(ECX, FieldAddress(ECX, Code::instructions_offset()));
   __ addl(ECX, Immediate(Instructions::HeaderSize() - kHeapObjectTag));
   __ jmp(ECX);
 
   __ Bind(&next_iteration);
-  __ AddImmediate(EBX, Immediate(FunctionsCache::kNumEntries * kWordSize));
-  __ jmp(&loop, Assembler::kNearJump);
+  __ addl(EBX, Immediate(kEntrySize));
+  __ jmp(&loop);
 
   __ Bind(&not_found);
 }
@@ -1570,8 +1658,9 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
     __ Bind(&loop);
     __ movl(EDI, Address(EBX, 0));  // Get class id (Smi) to check.
     __ cmpl(EAX, EDI);  // Class id match?
-    __ j(EQUAL, &found, Assembler::kNearJump);
-    __ addl(EBX, Immediate(kWordSize * 2));  // Next element (class + target).
+    __ j(EQUAL, &found);
+    // Next element (class + target + count).
+    __ addl(EBX, Immediate(kWordSize * ICData::TestEntryLengthFor(num_args)));
     __ cmpl(EDI, raw_null);   // Done?
     __ j(NOT_EQUAL, &loop, Assembler::kNearJump);
   } else if (num_args == 2) {
@@ -1595,15 +1684,26 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
     __ call(&get_class_id_as_smi);
     __ movl(EDI, Address(EBX, kWordSize));
     __ cmpl(EAX, EDI);  // Class id match?
-    __ j(EQUAL, &found, Assembler::kNearJump);
+    __ j(EQUAL, &found);
     __ Bind(&no_match);
-    // Each test entry has (1 + num_args) array elements.
-    __ addl(EBX, Immediate(kWordSize * (1 + num_args)));  // Next element.
+    // Next element (classes + target + count).
+    __ addl(EBX, Immediate(kWordSize * ICData::TestEntryLengthFor(num_args)));
     __ cmpl(EDI, raw_null);   // Done?
     __ j(NOT_EQUAL, &loop, Assembler::kNearJump);
   }
 
   __ Bind(&ic_miss);
+  // Megamorphic calls do not record more receivers, they continue with the
+  // lookup in the functions cache of the receiver's class.
+  Label not_megamorphic;
+  __ movl(EBX, FieldAddress(ECX, ICData::ic_data_offset()));
+  __ cmpl(FieldAddress(EBX, Array::length_offset()),
+          Immediate(Smi::RawValue(
+              (FLAG_max_polymorphic_checks + 1) *
+              ICData::TestEntryLengthFor(num_args))));
+  __ j(LESS, &not_megamorphic, Assembler::kNearJump);
+  __ jmp(&StubCode::MegamorphicLookupLabel());
+  __ Bind(&not_megamorphic);
   // Compute address of arguments (first read number of arguments from argument
   // descriptor array and then compute address on the stack).
   __ movl(EAX, FieldAddress(EDX, Array::data_offset()));
@@ -1641,7 +1741,16 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
   __ jmp(&StubCode::MegamorphicLookupLabel());
 
   __ Bind(&found);
-  // EBX: Pointer to an IC data check group (classes + target)
+  // EBX: Pointer to an IC data check group (classes + target + count)
+  // Count the call, the Smi count saturates instead of overflowing.
+  { Label no_overflow;
+    const Address count_address(
+        EBX, kWordSize * ICData::CountIndexFor(num_args));
+    __ addl(count_address, Immediate(Smi::RawValue(1)));
+    __ j(NO_OVERFLOW, &no_overflow, Assembler::kNearJump);
+    __ movl(count_address, Immediate(Smi::RawValue(Smi::kMaxValue)));
+    __ Bind(&no_overflow);
+  }
   __ movl(EAX, Address(EBX, kWordSize * num_args));  // Target function.
 
   __ Bind(&call_target_function);
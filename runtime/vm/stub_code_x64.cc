@@ -24,6 +24,7 @@ DEFINE_FLAG(bool, inline_alloc, true, "Inline allocation of objects.");
 DEFINE_FLAG(bool, use_slow_path, false,
     "Set to true for debugging & verifying the slow paths.");
 DECLARE_FLAG(int, optimization_counter_threshold);
+DECLARE_FLAG(int, max_polymorphic_checks);
 
 
 // Input parameters:
@@ -136,6 +137,89 @@ void StubCode::GeneratePrintStopMessageStub(Assembler* assembler) {
 }
 
 
+// Called by the write barrier in Assembler::StoreIntoObject when an old
+// object has been updated to point to a new object, or to an old object on a
+// page which is being marked incrementally.
+// Input parameters:
+//   RSP : points to return address.
+//   RSP + 8 : address of the slot that was stored into.
+//   RSP + 16 : object that was stored into.
+// Must preserve all registers, except TMP.
+void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
+  Label new_value, call_runtime;
+  __ pushq(RAX);
+  __ movq(TMP, Address(RSP, 2 * kWordSize));  // Slot address.
+  __ movq(TMP, Address(TMP, 0));  // Value.
+  __ testq(TMP, Immediate(kNewObjectAlignmentOffset));
+  __ j(NOT_ZERO, &new_value, Assembler::kNearJump);
+  // An old value is stored while the old generation is being marked, mark
+  // it unless that already happened.
+  __ movq(TMP, FieldAddress(TMP, Object::tags_offset()));
+  __ testq(TMP, Immediate(1 << RawObject::kMarkBit));
+  __ j(ZERO, &call_runtime, Assembler::kNearJump);
+  __ popq(RAX);
+  __ ret();
+
+  // Objects on pages with a card table are remembered by marking the card
+  // covering the slot.
+  __ Bind(&new_value);
+  __ movq(TMP, Address(RSP, 3 * kWordSize));  // Object.
+  __ andq(TMP, Immediate(~(PageSpace::kPageAlignment - 1)));
+  __ movq(RAX, Address(TMP, HeapPage::card_table_offset()));
+  __ cmpq(RAX, Immediate(0));
+  __ j(EQUAL, &call_runtime, Assembler::kNearJump);
+  __ subq(TMP, Address(RSP, 2 * kWordSize));  // Page start - slot address.
+  __ negq(TMP);
+  __ shrq(TMP, Immediate(HeapPage::kCardSizeLog2));
+  __ movb(Address(RAX, TMP, TIMES_1, 0), Immediate(1));
+  __ popq(RAX);
+  __ ret();
+
+  __ Bind(&call_runtime);
+  __ popq(RAX);
+  // Preserve caller-saved registers.
+  __ pushq(RAX);
+  __ pushq(RCX);
+  __ pushq(RDX);
+  __ pushq(RSI);
+  __ pushq(RDI);
+  __ pushq(R8);
+  __ pushq(R9);
+  __ pushq(R10);
+  const intptr_t kNumSavedRegisters = 8;
+  __ subq(RSP, Immediate(kNumberOfXmmRegisters * sizeof(double)));
+  for (intptr_t i = 0; i < kNumberOfXmmRegisters; i++) {
+    __ movsd(Address(RSP, i * sizeof(double)), static_cast<XmmRegister>(i));
+  }
+  const intptr_t slot_offset = (kNumberOfXmmRegisters * sizeof(double)) +
+      ((kNumSavedRegisters + 1) * kWordSize);
+  __ movq(RDI, Address(RSP, slot_offset));
+
+  __ pushq(RBP);
+  __ movq(RBP, RSP);
+  __ ReserveAlignedFrameSpace(0);
+  __ CallRuntime(kStoreBufferRuntimeEntry);
+  __ movq(RSP, RBP);
+  __ popq(RBP);
+
+  // Restore caller-saved registers.
+  for (intptr_t i = 0; i < kNumberOfXmmRegisters; i++) {
+    __ movsd(static_cast<XmmRegister>(i), Address(RSP, i * sizeof(double)));
+  }
+  __ addq(RSP, Immediate(kNumberOfXmmRegisters * sizeof(double)));
+  __ popq(R10);
+  __ popq(R9);
+  __ popq(R8);
+  __ popq(RDI);
+  __ popq(RSI);
+  __ popq(RDX);
+  __ popq(RCX);
+  __ popq(RAX);
+
+  __ ret();
+}
+
+
 // Input parameters:
 //   RSP : points to return address.
 //   RSP + 8 : address of return value.
@@ -273,7 +357,8 @@ void StubCode::GenerateFixCallersTargetStub(Assembler* assembler) {
 }
 
 
-// Lookup for [function-name, arg count] in 'functions_map_'.
+// Lookup for [function-name, arg count] in the functions cache of the
+// receiver's class.
 // Input parameters (to be treated as read only, unless calling to target!):
 //   RBX: ic-data.
 //   R10: arguments descriptor array (num_args is first Smi element).
@@ -311,45 +396,61 @@ static void MegamorphicLookup(Assembler* assembler) {
   __ Bind(&class_in_rax);
   // Class is in RAX.
 
-  Label loop, next_iteration;
-  // Get functions_cache, since it is allocated lazily it maybe null.
+  // Probe the hash table of the functions cache linearly, starting at the
+  // hash of the target name. An uncomputed hash of zero is just a miss.
+  // Classes read from a snapshot have no functions cache yet.
+  const intptr_t kEntrySize = FunctionsCache::kNumEntries * kWordSize;
   __ movq(RAX, FieldAddress(RAX, Class::functions_cache_offset()));
-  // Iterate and search for identical name.
-  __ leaq(R12, FieldAddress(RAX, Array::data_offset()));
+  __ cmpq(RAX, raw_null);
+  __ j(EQUAL, &not_found);
+  __ movq(R13, FieldAddress(RBX, ICData::target_name_offset()));
+  __ movq(R12, FieldAddress(R13, String::hash_offset()));
+  // Scale the hash (Smi) to the offset of its entry.
+  __ shlq(R12,
+          Immediate(Utils::ShiftForPowerOfTwo(kEntrySize) - kSmiTagShift));
 
-  // R12 is  pointing into content of functions_map_ array.
+  Label loop, next_iteration;
   __ Bind(&loop);
-  __ movq(R13, Address(R12, FunctionsCache::kFunctionName * kWordSize));
+  // Wrap around the offset: the capacity is a power of two, so the offset of
+  // the last entry is a mask for the offsets of all entries.
+  __ movq(R13, FieldAddress(RAX, Array::length_offset()));
+  __ shlq(R13, Immediate(kWordSizeLog2 - kSmiTagShift));
+  __ subq(R13, Immediate(kEntrySize));
+  __ andq(R12, R13);
+  // R12: offset of the entry in the functions_cache_ array.
+  __ movq(R13, FieldAddress(RAX, R12, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kFunctionName * kWordSize));
 
   __ cmpq(R13, raw_null);
-  __ j(EQUAL, &not_found, Assembler::kNearJump);
+  __ j(EQUAL, &not_found);
 
   __ cmpq(R13, FieldAddress(RBX, ICData::target_name_offset()));
-  __ j(NOT_EQUAL, &next_iteration, Assembler::kNearJump);
+  __ j(NOT_EQUAL, &next_iteration);
 
   // Name found, check total argument count and named argument count.
-  __ movq(RAX, FieldAddress(R10, Array::data_offset()));
-  // RAX is total argument count as Smi.
-  __ movq(R13, Address(R12, FunctionsCache::kArgCount * kWordSize));
-  __ cmpq(RAX, R13);  // Compare total argument counts.
-  __ j(NOT_EQUAL, &next_iteration, Assembler::kNearJump);
-  __ subq(RAX, FieldAddress(R10, Array::data_offset() + kWordSize));
-  // RAX is named argument count as Smi.
-  __ movq(R13, Address(R12, FunctionsCache::kNamedArgCount * kWordSize));
-  __ cmpq(RAX, R13);  // Compare named argument counts.
-  __ j(NOT_EQUAL, &next_iteration, Assembler::kNearJump);
+  __ movq(R13, FieldAddress(R10, Array::data_offset()));
+  // R13 is total argument count as Smi.
+  __ cmpq(R13, FieldAddress(RAX, R12, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kArgCount * kWordSize));
+  __ j(NOT_EQUAL, &next_iteration);
+  __ subq(R13, FieldAddress(R10, Array::data_offset() + kWordSize));
+  // R13 is named argument count as Smi.
+  __ cmpq(R13, FieldAddress(RAX, R12, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kNamedArgCount * kWordSize));
+  __ j(NOT_EQUAL, &next_iteration);
 
   // Argument count matches, jump to target.
   // R10: arguments descriptor array.
-  __ movq(RBX, Address(R12, FunctionsCache::kFunction * kWordSize));
+  __ movq(RBX, FieldAddress(RAX, R12, TIMES_1, Array::data_offset() +
+                            FunctionsCache::kFunction * kWordSize));
   __ movq(RBX, FieldAddress(RBX, Function::code_offset()));
   __ movq(RBX, FieldAddress(RBX, Code::instructions_offset()));
   __ addq(RBX, Immediate(Instructions::HeaderSize() - kHeapObjectTag));
   __ jmp(RBX);
 
   __ Bind(&next_iteration);
-  __ AddImmediate(R12, Immediate(FunctionsCache::kNumEntries * kWordSize));
-  __ jmp(&loop, Assembler::kNearJump);
+  __ addq(R12, Immediate(kEntrySize));
+  __ jmp(&loop);
 
   __ Bind(&not_found);
 }
@@ -1552,8 +1653,9 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
     __ Bind(&loop);
     __ movq(R13, Address(R12, 0));  // Get class if (Smi) to check.
     __ cmpq(RAX, R13);  // Match?
-    __ j(EQUAL, &found, Assembler::kNearJump);
-    __ addq(R12, Immediate(kWordSize * 2));  // Next element (class + target).
+    __ j(EQUAL, &found);
+    // Next element (class + target + count).
+    __ addq(R12, Immediate(kWordSize * ICData::TestEntryLengthFor(num_args)));
     __ cmpq(R13, raw_null);   // Done?
     __ j(NOT_EQUAL, &loop, Assembler::kNearJump);
   } else if (num_args == 2) {
@@ -1575,12 +1677,24 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
     __ cmpq(RAX, R13);  //  Class id match?
     __ j(EQUAL, &found);
     __ Bind(&no_match);
-    __ addq(R12, Immediate(kWordSize * (1 + num_args)));  // Next element.
+    // Next element (classes + target + count).
+    __ addq(R12, Immediate(kWordSize * ICData::TestEntryLengthFor(num_args)));
     __ cmpq(R13, raw_null);   // Done?
     __ j(NOT_EQUAL, &loop, Assembler::kNearJump);
   }
 
   __ Bind(&ic_miss);
+  // Megamorphic calls do not record more receivers, they continue with the
+  // lookup in the functions cache of the receiver's class.
+  Label not_megamorphic;
+  __ movq(R12, FieldAddress(RBX, ICData::ic_data_offset()));
+  __ cmpq(FieldAddress(R12, Array::length_offset()),
+          Immediate(Smi::RawValue(
+              (FLAG_max_polymorphic_checks + 1) *
+              ICData::TestEntryLengthFor(num_args))));
+  __ j(LESS, &not_megamorphic, Assembler::kNearJump);
+  __ jmp(&StubCode::MegamorphicLookupLabel());
+  __ Bind(&not_megamorphic);
   // Compute address of arguments (first read number of arguments from argument
   // descriptor array and then compute address on the stack).
   __ movq(RAX, FieldAddress(R10, Array::data_offset()));
@@ -1616,7 +1730,10 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
   __ jmp(&StubCode::MegamorphicLookupLabel());
 
   __ Bind(&found);
-  // R12: Pointer to an IC data check group (classes + target)
+  // R12: Pointer to an IC data check group (classes + target + count)
+  // Count the call, a Smi count does not overflow in 64 bits in practice.
+  __ addq(Address(R12, kWordSize * ICData::CountIndexFor(num_args)),
+          Immediate(Smi::RawValue(1)));
   __ movq(RAX, Address(R12, kWordSize * num_args));  // Target function.
 
   __ Bind(&call_target_function);